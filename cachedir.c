@@ -0,0 +1,220 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cachedir.h"
+
+#include <apr_file_info.h>
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+** Types
+*/
+
+struct CacheDir
+{
+    apr_thread_mutex_t *mutex;
+    char *dir;              /* NULL if unset */
+    apr_off_t maxBytes;     /* 0 disables the cache */
+    apr_off_t totalBytes;   /* estimated size of all files */
+};
+
+typedef struct CacheFile
+{
+    const char *path;
+    apr_time_t mtime;
+    apr_off_t size;
+} CacheFile;
+
+/*
+** Prototypes
+*/
+
+/** Deletes the least recently modified files until the total size is at
+    most @a target bytes and updates totalBytes. The mutex must be locked. */
+static void trimFiles(CacheDir *cache, apr_off_t target);
+
+/** qsort comparison of CacheFiles by modification time. */
+static int compareCacheFiles(const void *a, const void *b);
+
+/*--------------------------------------------------------------------------*/
+CacheDir *cachedir_create(apr_pool_t *pool)
+{
+    CacheDir *cache = apr_pcalloc(pool, sizeof(*cache));
+    apr_thread_mutex_create(&cache->mutex, APR_THREAD_MUTEX_DEFAULT, pool);
+    return cache;
+}
+
+/*--------------------------------------------------------------------------*/
+void cachedir_configure(CacheDir *cache, const char *dir, apr_off_t maxBytes)
+{
+    apr_thread_mutex_lock(cache->mutex);
+    free(cache->dir);
+    cache->dir = strdup(dir);
+    cache->maxBytes = maxBytes;
+    if (maxBytes)
+    {
+        apr_pool_t *pool;
+        apr_pool_create(&pool, NULL);
+        apr_dir_make_recursive(dir, APR_OS_DEFAULT, pool);
+        apr_pool_destroy(pool);
+        trimFiles(cache, maxBytes);
+    }
+    apr_thread_mutex_unlock(cache->mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+apr_off_t cachedir_limit(CacheDir *cache)
+{
+    apr_off_t maxBytes;
+    apr_thread_mutex_lock(cache->mutex);
+    maxBytes = cache->maxBytes;
+    apr_thread_mutex_unlock(cache->mutex);
+    return maxBytes;
+}
+
+/*--------------------------------------------------------------------------*/
+char *cachedir_path(CacheDir *cache, const char *key, const char *suffix, apr_pool_t *pool)
+{
+    /* two independent 32 bit hashes, FNV-1a and djb2 */
+    const apr_uint32_t fnv = cachedir_hash(CACHEDIR_HASH_INIT, key, strlen(key));
+    apr_uint32_t djb = 5381;
+    const unsigned char *p;
+    char *path = NULL;
+
+    for (p = (const unsigned char*) key; *p; ++p)
+    {
+        djb = djb * 33 + *p;
+    }
+    apr_thread_mutex_lock(cache->mutex);
+    if (cache->maxBytes)
+    {
+        path = apr_psprintf(pool, "%s/%08x%08x%s", cache->dir, fnv, djb, suffix);
+    }
+    apr_thread_mutex_unlock(cache->mutex);
+    return path;
+}
+
+/*--------------------------------------------------------------------------*/
+apr_status_t cachedir_mktemp(CacheDir *cache, apr_file_t **file, char **tempPath, apr_int32_t flags, apr_pool_t *pool)
+{
+    apr_thread_mutex_lock(cache->mutex);
+    *tempPath = cache->maxBytes ? apr_pstrcat(pool, cache->dir, "/tmpXXXXXX", NULL) : NULL;
+    apr_thread_mutex_unlock(cache->mutex);
+    if (!*tempPath)
+    {
+        return APR_EINVAL;
+    }
+    return apr_file_mktemp(file, *tempPath, flags | APR_CREATE | APR_READ | APR_WRITE | APR_EXCL, pool);
+}
+
+/*--------------------------------------------------------------------------*/
+int cachedir_commit(CacheDir *cache, const char *tempPath, const char *path, apr_off_t size, apr_pool_t *pool)
+{
+    if (apr_file_rename(tempPath, path, pool) != APR_SUCCESS)
+    {
+        /* e.g. the old file is still mapped or being copied */
+        apr_file_remove(tempPath, pool);
+        return 0;
+    }
+    apr_thread_mutex_lock(cache->mutex);
+    cache->totalBytes += size;
+    if (cache->maxBytes && cache->totalBytes > cache->maxBytes)
+    {
+        /* leave some room, so not every commit rescans the directory */
+        trimFiles(cache, cache->maxBytes / 4 * 3);
+    }
+    apr_thread_mutex_unlock(cache->mutex);
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+apr_uint32_t cachedir_hash(apr_uint32_t hash, const void *data, apr_size_t len)
+{
+    const unsigned char *p = data;
+    const unsigned char *end = p + len;
+    while (p < end)
+    {
+        hash ^= *p++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*--------------------------------------------------------------------------*/
+static void trimFiles(CacheDir *cache, apr_off_t target)
+{
+    apr_pool_t *pool;
+    apr_dir_t *dir;
+    apr_finfo_t finfo;
+    CacheFile *files = NULL;
+    size_t count = 0, capacity = 0, i;
+    apr_off_t total = 0;
+    apr_status_t status;
+
+    apr_pool_create(&pool, NULL);
+    if (apr_dir_open(&dir, cache->dir, pool) == APR_SUCCESS)
+    {
+        while ((status = apr_dir_read(&finfo, APR_FINFO_NAME | APR_FINFO_TYPE | APR_FINFO_SIZE | APR_FINFO_MTIME, dir)) == APR_SUCCESS
+               || status == APR_INCOMPLETE)
+        {
+            /* everything in the directory is ours, including temporary files left by a crash */
+            if (finfo.filetype == APR_REG)
+            {
+                if (count == capacity)
+                {
+                    capacity = capacity ? capacity * 2 : 64;
+                    files = realloc(files, capacity * sizeof(*files));
+                }
+                files[count].path = apr_pstrcat(pool, cache->dir, "/", finfo.name, NULL);
+                files[count].mtime = finfo.mtime;
+                files[count].size = finfo.size;
+                total += finfo.size;
+                ++count;
+            }
+        }
+        apr_dir_close(dir);
+    }
+
+    if (total > target)
+    {
+        qsort(files, count, sizeof(*files), &compareCacheFiles);
+        for (i = 0; i < count && total > target; ++i)
+        {
+            /* fails for files that are still mapped or being copied, they go next time */
+            if (apr_file_remove(files[i].path, pool) == APR_SUCCESS)
+            {
+                total -= files[i].size;
+            }
+        }
+    }
+    cache->totalBytes = total;
+    free(files);
+    apr_pool_destroy(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static int compareCacheFiles(const void *a, const void *b)
+{
+    const apr_time_t x = ((const CacheFile*) a)->mtime;
+    const apr_time_t y = ((const CacheFile*) b)->mtime;
+    return x < y ? -1 : x > y;
+}
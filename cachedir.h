@@ -0,0 +1,86 @@
+#ifndef SVN_WFX_CACHEDIR_H_INCLUDED
+#define SVN_WFX_CACHEDIR_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <apr_file_io.h>
+
+/** A directory of cache files with a size limit. Files are named after a
+    hash of their key and evicted least recently modified first. Files are
+    written to a temporary name and renamed into place, so readers never see
+    a partial file. All cachedir functions are thread-safe. */
+typedef struct CacheDir CacheDir;
+
+/** Initial value of cachedir_hash. */
+#define CACHEDIR_HASH_INIT 2166136261u
+
+/** Creates a disabled cache directory, see cachedir_configure.
+    @param pool The pool to allocate the cache directory from.
+    @return The new cache directory. */
+extern CacheDir *cachedir_create(apr_pool_t *pool);
+
+/** Sets the directory and size limit, evicting the least recently modified
+    files if necessary.
+    @param cache The cache directory.
+    @param dir The zero-terminated directory. Created on demand.
+    @param maxBytes The maximum total size of all files. Zero disables the cache. */
+extern void cachedir_configure(CacheDir *cache, const char *dir, apr_off_t maxBytes);
+
+/** @return The size limit of @a cache, zero if it is disabled. */
+extern apr_off_t cachedir_limit(CacheDir *cache);
+
+/** Names the file of a key. Different keys may share a file, so the
+    contents must allow to tell them apart.
+    @param cache The cache directory.
+    @param key The zero-terminated key.
+    @param suffix The zero-terminated file name suffix.
+    @param pool The pool to allocate the path from.
+    @return The path of the file, or NULL if @a cache is disabled. */
+extern char *cachedir_path(CacheDir *cache, const char *key, const char *suffix, apr_pool_t *pool);
+
+/** Creates a temporary file in the directory, to be moved into place with
+    cachedir_commit.
+    @param cache The cache directory.
+    @param file Receives the open file.
+    @param tempPath Receives the path of the file, allocated from @a pool.
+    @param flags The apr_file_open flags, APR_CREATE, APR_EXCL, APR_READ and
+                 APR_WRITE are always added.
+    @param pool The pool to allocate the file from.
+    @return APR_SUCCESS, or the error status. */
+extern apr_status_t cachedir_mktemp(CacheDir *cache, apr_file_t **file, char **tempPath, apr_int32_t flags, apr_pool_t *pool);
+
+/** Renames a complete, closed temporary file to its final path and evicts
+    the least recently modified files if the directory has grown beyond its
+    limit. The temporary file is removed if it cannot be renamed.
+    @param cache The cache directory.
+    @param tempPath The path returned by cachedir_mktemp.
+    @param path The path returned by cachedir_path.
+    @param size The size of the file.
+    @param pool The pool for temporary allocations.
+    @return Non-zero on success. */
+extern int cachedir_commit(CacheDir *cache, const char *tempPath, const char *path, apr_off_t size, apr_pool_t *pool);
+
+/** Continues an FNV-1a hash, e.g. to checksum the contents of a cache file.
+    @param hash CACHEDIR_HASH_INIT, or the result of a previous call.
+    @param data The bytes to hash.
+    @param len The number of bytes.
+    @return The updated hash. */
+extern apr_uint32_t cachedir_hash(apr_uint32_t hash, const void *data, apr_size_t len);
+
+#endif /* !SVN_WFX_CACHEDIR_H_INCLUDED */
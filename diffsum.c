@@ -0,0 +1,175 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "diffsum.h"
+
+#include <apr_hash.h>
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+** Prototypes
+*/
+
+/** Drops the comparison. Global.mutex must be locked. */
+static void clearComparison(void);
+
+/** @return The recorded status of @a path, DIFF_UNCOMPARED if there is none.
+    Global.mutex must be locked. */
+static DiffStatus lookup(const char *path, size_t len);
+
+/*
+** Globals
+*/
+static struct
+{
+    apr_thread_mutex_t *mutex;
+    apr_pool_t *parent;
+    apr_pool_t *pool;                   /* owns paths, NULL without a comparison */
+    const struct Location *location;    /* the compared directory */
+    char *subPath;
+    size_t subPathLen;
+    apr_hash_t *paths;                  /* relative path -> DiffStatus, as a pointer into Statuses */
+} Global = { 0 };
+
+/* values of Global.paths */
+static const DiffStatus Statuses[DIFF_MAX] =
+{
+    DIFF_UNCOMPARED, DIFF_EQUAL, DIFF_ADDED, DIFF_DELETED, DIFF_MODIFIED, DIFF_PROPS, DIFF_INSIDE
+};
+
+/*--------------------------------------------------------------------------*/
+void diffsum_init(apr_pool_t *pool)
+{
+    apr_thread_mutex_create(&Global.mutex, APR_THREAD_MUTEX_DEFAULT, pool);
+    Global.parent = pool;
+}
+
+/*--------------------------------------------------------------------------*/
+void diffsum_begin(const struct Location *location, const char *subPath, size_t subPathLen)
+{
+    apr_thread_mutex_lock(Global.mutex);
+    clearComparison();
+    apr_pool_create(&Global.pool, Global.parent);
+    Global.location = location;
+    Global.subPath = apr_pstrmemdup(Global.pool, subPath, subPathLen);
+    Global.subPathLen = subPathLen;
+    Global.paths = apr_hash_make(Global.pool);
+    apr_thread_mutex_unlock(Global.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+void diffsum_add(const char *path, DiffStatus status)
+{
+    size_t len = strlen(path);
+
+    apr_thread_mutex_lock(Global.mutex);
+    if (Global.pool && len)
+    {
+        apr_hash_set(Global.paths, apr_pstrmemdup(Global.pool, path, len), len, &Statuses[status]);
+        /* mark the parents, stopping at the first one that is marked already */
+        while (len--)
+        {
+            if (path[len] == '/')
+            {
+                if (lookup(path, len) != DIFF_UNCOMPARED)
+                {
+                    break;
+                }
+                apr_hash_set(Global.paths, apr_pstrmemdup(Global.pool, path, len), len, &Statuses[DIFF_INSIDE]);
+            }
+        }
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+DiffStatus diffsum_status(const struct Location *location, const char *subPath, size_t subPathLen, const char *name)
+{
+    DiffStatus status = DIFF_UNCOMPARED;
+
+    apr_thread_mutex_lock(Global.mutex);
+    if (Global.pool && location == Global.location && subPathLen >= Global.subPathLen
+        && !memcmp(subPath, Global.subPath, Global.subPathLen)
+        && (subPathLen == Global.subPathLen || subPath[Global.subPathLen] == '/'))
+    {
+        /* relative to the compared directory, without leading slash */
+        const char *rel = subPath + Global.subPathLen + (subPathLen > Global.subPathLen);
+        const size_t relLen = subPath + subPathLen - rel;
+        const size_t nameLen = strlen(name);
+        const size_t len = relLen + (relLen > 0) + nameLen;
+        char *path = malloc(len + 1);
+        size_t i;
+
+        memcpy(path, rel, relLen);
+        if (relLen)
+        {
+            path[relLen] = '/';
+        }
+        memcpy(path + len - nameLen, name, nameLen + 1);
+        status = lookup(path, len);
+        /* added directories may be reported without their contents */
+        for (i = len; status == DIFF_UNCOMPARED && i--; )
+        {
+            if (path[i] == '/' && lookup(path, i) == DIFF_ADDED)
+            {
+                status = DIFF_ADDED;
+            }
+        }
+        if (status == DIFF_UNCOMPARED)
+        {
+            status = DIFF_EQUAL;
+        }
+        free(path);
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+    return status;
+}
+
+/*--------------------------------------------------------------------------*/
+void diffsum_clear(const struct Location *location)
+{
+    apr_thread_mutex_lock(Global.mutex);
+    if (!location || location == Global.location)
+    {
+        clearComparison();
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+static void clearComparison(void)
+{
+    if (Global.pool)
+    {
+        apr_pool_destroy(Global.pool);
+        Global.pool = NULL;
+        Global.location = NULL;
+        Global.paths = NULL;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static DiffStatus lookup(const char *path, size_t len)
+{
+    const DiffStatus *status = apr_hash_get(Global.paths, path, len);
+    return status ? *status : DIFF_UNCOMPARED;
+}
@@ -0,0 +1,72 @@
+#ifndef SVN_WFX_DIFFSUM_H_INCLUDED
+#define SVN_WFX_DIFFSUM_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <apr_pools.h>
+
+struct Location;
+
+/** How an entry differs from the base of the comparison, see diffsum_status. */
+typedef enum DiffStatus
+{
+    DIFF_UNCOMPARED = 0,  /* not below the compared directory */
+    DIFF_EQUAL,           /* same contents and properties as in the base */
+    DIFF_ADDED,           /* not in the base */
+    DIFF_DELETED,         /* only in the base */
+    DIFF_MODIFIED,        /* different contents, maybe different properties as well */
+    DIFF_PROPS,           /* different properties only */
+    DIFF_INSIDE,          /* a directory with differences below it */
+    DIFF_MAX
+} DiffStatus;
+
+/** Initializes the comparison store, which holds the outcome of the latest
+    comparison of a directory with a base directory, as reported by a diff
+    summary. Must be called before any other diffsum function. All diffsum
+    functions are thread-safe.
+    @param pool The pool to allocate global state from. */
+extern void diffsum_init(apr_pool_t *pool);
+
+/** Drops the previous comparison and starts recording a new one.
+    @param location The location of the compared directory.
+    @param subPath The normalized sub path of the compared directory. Need not be zero-terminated.
+    @param subPathLen The length of @a subPath. */
+extern void diffsum_begin(const struct Location *location, const char *subPath, size_t subPathLen);
+
+/** Records a difference of the comparison started by diffsum_begin. Its
+    parent directories become DIFF_INSIDE unless they differ themselves.
+    @param path The zero-terminated, '/'-separated path relative to the
+                compared directory. Empty paths are ignored.
+    @param status The difference, neither DIFF_UNCOMPARED nor DIFF_EQUAL. */
+extern void diffsum_add(const char *path, DiffStatus status);
+
+/** Looks up how an entry differs from the base.
+    @param location The location.
+    @param subPath The normalized sub path of the entry's directory. Need not be zero-terminated.
+    @param subPathLen The length of @a subPath.
+    @param name The zero-terminated entry name.
+    @return The difference, DIFF_EQUAL if none was recorded, or DIFF_UNCOMPARED
+            if the entry is not below the compared directory. */
+extern DiffStatus diffsum_status(const struct Location *location, const char *subPath, size_t subPathLen, const char *name);
+
+/** Drops the comparison.
+    @param location Drop it only if it compared a directory of this location, NULL to drop it in any case. */
+extern void diffsum_clear(const struct Location *location);
+
+#endif /* !SVN_WFX_DIFFSUM_H_INCLUDED */
@@ -0,0 +1,320 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "diskcache.h"
+#include "intern.h"
+#include "cachedir.h"
+
+#include <apr_file_info.h>
+#include <apr_file_io.h>
+#include <apr_mmap.h>
+#include <apr_strings.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+** Types
+*/
+
+/** Cache file header. It is followed by the zero-terminated URL of the
+    directory padded to a multiple of 8 bytes, the SVNObject records, the
+    name index, the name strings and the zero-terminated author names. All
+    values are stored in host byte order. */
+typedef struct DiskHeader
+{
+    char magic[8];
+    apr_int64_t timestamp;      /* time of the listing */
+    apr_uint32_t version;
+    apr_uint32_t entrySize;     /* sizeof(SVNObject) */
+    apr_uint32_t checksum;      /* FNV-1a of everything following the header */
+    apr_uint32_t urlLen;
+    apr_uint32_t count;
+    apr_uint32_t indexSize;     /* a power of two */
+    apr_uint32_t stringsLen;
+    apr_uint32_t authorCount;
+    apr_uint32_t authorsLen;
+    apr_int32_t createdRev;     /* created revision of the directory itself */
+    apr_int32_t revision;       /* youngest revision the listing was confirmed at */
+} DiskHeader;
+
+/*
+** Prototypes
+*/
+
+/** Validates a mapped cache file and creates a snapshot using it in place.
+    @return The snapshot, or NULL if the file is damaged or does not belong to @a url. */
+static Snapshot *mapSnapshot(const char *data, apr_size_t size, const struct Location *location, const char *subPath, size_t subPathLen, const char *url);
+
+/** Writes @a len bytes to @a file and adds them to @a checksum.
+    @return Non-zero on success. */
+static int writePart(apr_file_t *file, const void *data, apr_size_t len, apr_uint32_t *checksum);
+
+/*
+** Globals
+*/
+static const char Magic[8] = { 's', 'v', 'n', 'w', 'f', 'x', '\r', '\n' };
+static const apr_uint32_t Version = 2;
+
+static struct
+{
+    CacheDir *files;
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+void diskcache_init(apr_pool_t *pool)
+{
+    Global.files = cachedir_create(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+void diskcache_configure(const char *dir, apr_off_t maxBytes)
+{
+    cachedir_configure(Global.files, dir, maxBytes);
+}
+
+/*--------------------------------------------------------------------------*/
+Snapshot *diskcache_load(const struct Location *location, const char *subPath, size_t subPathLen, const char *url)
+{
+    Snapshot *snapshot = NULL;
+    apr_pool_t *pool;
+    apr_file_t *file;
+    apr_finfo_t finfo;
+    apr_mmap_t *map;
+    const char *path;
+    int damaged = 0;
+
+    apr_pool_create(&pool, NULL);
+    if (!(path = cachedir_path(Global.files, url, ".snap", pool)))
+    {
+        apr_pool_destroy(pool);
+        return NULL;
+    }
+
+    if (apr_file_open(&file, path, APR_READ | APR_BINARY, APR_OS_DEFAULT, pool) == APR_SUCCESS)
+    {
+        damaged = 1;
+        if (apr_file_info_get(&finfo, APR_FINFO_SIZE, file) == APR_SUCCESS
+            && finfo.size >= (apr_off_t) sizeof(DiskHeader) && finfo.size <= 0x7FFFFFFF
+            && apr_mmap_create(&map, file, 0, (apr_size_t) finfo.size, APR_MMAP_READ, pool) == APR_SUCCESS)
+        {
+            /* the mapping and the file stay open until the pool is destroyed */
+            snapshot = mapSnapshot(map->mm, map->size, location, subPath, subPathLen, url);
+            damaged = !snapshot;
+        }
+    }
+
+    if (snapshot)
+    {
+        snapshot->mapPool = pool;
+    }
+    else
+    {
+        apr_pool_destroy(pool);
+        if (damaged)
+        {
+            /* truncated, from an older version or overwritten by garbage */
+            apr_pool_create(&pool, NULL);
+            apr_file_remove(path, pool);
+            apr_pool_destroy(pool);
+        }
+    }
+    return snapshot;
+}
+
+/*--------------------------------------------------------------------------*/
+void diskcache_store(const Snapshot *snapshot, const char *url)
+{
+    static const char padding[8] = { 0 };
+    DiskHeader header;
+    apr_pool_t *pool;
+    apr_file_t *file;
+    apr_finfo_t finfo;
+    apr_off_t offset = 0;
+    char *path, *tempPath;
+    apr_uint32_t checksum = CACHEDIR_HASH_INIT;
+    apr_uint32_t i;
+    int ok;
+
+    apr_pool_create(&pool, NULL);
+    if (!(path = cachedir_path(Global.files, url, ".snap", pool)))
+    {
+        apr_pool_destroy(pool);
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.entrySize = sizeof(SVNObject);
+    header.urlLen = (apr_uint32_t) strlen(url);
+    header.count = (apr_uint32_t) snapshot->count;
+    header.indexSize = (apr_uint32_t) snapshot->indexMask + 1;
+    header.stringsLen = (apr_uint32_t) snapshot->stringsLen;
+    header.authorCount = snapshot->authorCount;
+    header.createdRev = snapshot->createdRev;
+    header.revision = (apr_int32_t) snapshot->revision;
+    header.timestamp = snapshot->timestamp;
+    for (i = 0; i < snapshot->authorCount; ++i)
+    {
+        header.authorsLen += (apr_uint32_t) strlen(snapshot->authors[i]) + 1;
+    }
+
+    if (cachedir_mktemp(Global.files, &file, &tempPath, APR_BINARY | APR_BUFFERED, pool) != APR_SUCCESS)
+    {
+        apr_pool_destroy(pool);
+        return;
+    }
+    ok = writePart(file, &header, sizeof(header), NULL)
+         && writePart(file, url, header.urlLen + 1, &checksum)
+         && writePart(file, padding, (8 - (header.urlLen + 1) % 8) % 8, &checksum)
+         && writePart(file, snapshot->entries, snapshot->count * sizeof(SVNObject), &checksum)
+         && writePart(file, snapshot->index, header.indexSize * sizeof(apr_uint32_t), &checksum)
+         && writePart(file, snapshot->strings, snapshot->stringsLen, &checksum);
+    for (i = 0; ok && i < snapshot->authorCount; ++i)
+    {
+        ok = writePart(file, snapshot->authors[i], strlen(snapshot->authors[i]) + 1, &checksum);
+    }
+    header.checksum = checksum;
+    ok = ok && apr_file_info_get(&finfo, APR_FINFO_SIZE, file) == APR_SUCCESS
+            && apr_file_seek(file, APR_SET, &offset) == APR_SUCCESS
+            && writePart(file, &header, sizeof(header), NULL);
+    ok = (apr_file_close(file) == APR_SUCCESS) && ok;
+
+    if (ok)
+    {
+        cachedir_commit(Global.files, tempPath, path, finfo.size, pool);
+    }
+    else
+    {
+        apr_file_remove(tempPath, pool);
+    }
+    apr_pool_destroy(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static Snapshot *mapSnapshot(const char *data, apr_size_t size, const struct Location *location, const char *subPath, size_t subPathLen, const char *url)
+{
+    const DiskHeader *header = (const DiskHeader*) data;
+    const char *p = data + sizeof(*header);
+    const char *end = data + size;
+    const SVNObject *entries;
+    const apr_uint32_t *index;
+    const char *strings, *authors;
+    Snapshot *snapshot;
+    apr_uint32_t i, used = 0;
+
+    if (memcmp(header->magic, Magic, sizeof(Magic)) || header->version != Version || header->entrySize != sizeof(SVNObject)
+        || cachedir_hash(CACHEDIR_HASH_INIT, p, end - p) != header->checksum)
+    {
+        return NULL;
+    }
+
+    /* check each section against the remaining size before using it */
+    if ((apr_size_t) (end - p) <= header->urlLen || p[header->urlLen] || strlen(url) != header->urlLen || memcmp(p, url, header->urlLen))
+    {
+        return NULL;
+    }
+    p += (header->urlLen + 8) & ~7;
+    if (p > end || (apr_size_t) (end - p) / sizeof(SVNObject) < header->count)
+    {
+        return NULL;
+    }
+    entries = (const SVNObject*) p;
+    p += header->count * sizeof(SVNObject);
+    if (header->indexSize < 16 || (header->indexSize & (header->indexSize - 1)) || header->indexSize <= header->count
+        || (apr_size_t) (end - p) / sizeof(apr_uint32_t) < header->indexSize)
+    {
+        return NULL;
+    }
+    index = (const apr_uint32_t*) p;
+    p += header->indexSize * sizeof(apr_uint32_t);
+    if ((apr_size_t) (end - p) < header->stringsLen || (header->stringsLen && p[header->stringsLen - 1]))
+    {
+        return NULL;
+    }
+    strings = p;
+    p += header->stringsLen;
+    if ((apr_size_t) (end - p) != header->authorsLen || (header->authorsLen && end[-1]))
+    {
+        return NULL;
+    }
+    authors = p;
+
+    for (i = 0; i < header->count; ++i)
+    {
+        if (entries[i].nameOffset >= header->stringsLen
+            || (entries[i].author >= header->authorCount && entries[i].author != SNAPSHOT_NO_AUTHOR))
+        {
+            return NULL;
+        }
+    }
+    for (i = 0; i < header->indexSize; ++i)
+    {
+        if (index[i] > header->count)
+        {
+            return NULL;
+        }
+        used += index[i] != 0;
+    }
+    if (used > header->count)
+    {
+        /* lookups rely on an empty slot to terminate */
+        return NULL;
+    }
+    for (i = 0, p = authors; p < end; ++i)
+    {
+        p += strlen(p) + 1;
+    }
+    if (i != header->authorCount)
+    {
+        return NULL;
+    }
+
+    snapshot = snapshot_create(location, subPath, subPathLen);
+    snapshot->entries = (SVNObject*) entries;
+    snapshot->count = header->count;
+    snapshot->capacity = header->count;
+    snapshot->index = (apr_uint32_t*) index;
+    snapshot->indexMask = header->indexSize - 1;
+    snapshot->strings = (char*) strings;
+    snapshot->stringsLen = header->stringsLen;
+    snapshot->stringsCapacity = header->stringsLen;
+    snapshot->timestamp = header->timestamp;
+    snapshot->createdRev = header->createdRev;
+    snapshot->revision = (apr_uint32_t) header->revision;
+    snapshot->checkedAt = (apr_uint32_t) apr_time_sec(header->timestamp);
+    snapshot->authorCount = header->authorCount;
+    snapshot->authors = malloc(header->authorCount * sizeof(*snapshot->authors) + 1);
+    for (i = 0, p = authors; i < header->authorCount; ++i)
+    {
+        snapshot->authors[i] = intern_acquire(p);
+        p += strlen(p) + 1;
+    }
+    return snapshot;
+}
+
+/*--------------------------------------------------------------------------*/
+static int writePart(apr_file_t *file, const void *data, apr_size_t len, apr_uint32_t *checksum)
+{
+    if (checksum)
+    {
+        *checksum = cachedir_hash(*checksum, data, len);
+    }
+    return !len || apr_file_write_full(file, data, len, NULL) == APR_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#ifndef SVN_WFX_DISKCACHE_H_INCLUDED
+#define SVN_WFX_DISKCACHE_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "snapshot.h"
+
+#include <apr_pools.h>
+
+/** Sets up the on-disk listing cache. Finished snapshots are stored as one
+    file per directory, in a format that is mapped into memory and used in
+    place when loaded again. All diskcache functions are thread-safe.
+    @param pool The pool to allocate global state from. */
+extern void diskcache_init(apr_pool_t *pool);
+
+/** Sets the cache directory and size limit, evicting the least recently
+    written files if necessary.
+    @param dir The zero-terminated cache directory. Created on demand.
+    @param maxBytes The maximum total size of all cache files. Zero disables
+                    the disk cache. */
+extern void diskcache_configure(const char *dir, apr_off_t maxBytes);
+
+/** Maps the stored listing of a directory.
+    @param location The location the snapshot will belong to.
+    @param subPath The normalized sub path inside @a location. Need not be zero-terminated.
+    @param subPathLen The length of @a subPath.
+    @param url The zero-terminated, unescaped URL of the directory.
+    @return A finished snapshot with a reference count of one and the
+            timestamp of the original listing, or NULL if there is no
+            valid cache file. */
+extern Snapshot *diskcache_load(const struct Location *location, const char *subPath, size_t subPathLen, const char *url);
+
+/** Writes a finished snapshot to the cache, replacing any older file for
+    the same directory. Failures are ignored.
+    @param snapshot The finished snapshot.
+    @param url The zero-terminated, unescaped URL of the directory. */
+extern void diskcache_store(const Snapshot *snapshot, const char *url);
+
+#endif /* !SVN_WFX_DISKCACHE_H_INCLUDED */
@@ -0,0 +1,198 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filestore.h"
+#include "cachedir.h"
+
+#include <apr_file_info.h>
+#include <apr_file_io.h>
+#include <apr_md5.h>
+#include <apr_strings.h>
+
+#include <string.h>
+
+/*
+** Types
+*/
+
+/** Precedes the contents of a stored file, followed by the URL. Different
+    URLs may share a stored file name, see cachedir_path. */
+typedef struct StoreHeader
+{
+    char magic[8];
+    apr_int64_t size;           /* of the contents */
+    apr_uint32_t urlLen;
+    apr_uint32_t reserved;
+} StoreHeader;
+
+/*
+** Prototypes
+*/
+
+/** Copies @a size bytes from @a in to @a out, optionally hashing them.
+    @param md5 Receives the MD5 digest of the copied bytes if not NULL.
+    @return APR_SUCCESS or the error of the first failed read or write. */
+static apr_status_t copyContents(apr_file_t *in, apr_file_t *out, apr_off_t size, unsigned char *md5);
+
+/*
+** Globals
+*/
+static struct
+{
+    CacheDir *files;
+} Global = { 0 };
+
+static const char Magic[8] = { 's', 'v', 'n', 'f', 'i', 'l', 'e', '\n' };
+
+/*--------------------------------------------------------------------------*/
+void filestore_init(apr_pool_t *pool)
+{
+    Global.files = cachedir_create(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+void filestore_configure(const char *dir, apr_off_t maxBytes)
+{
+    cachedir_configure(Global.files, dir, maxBytes);
+}
+
+/*--------------------------------------------------------------------------*/
+int filestore_fetch(const char *url, svn_revnum_t revision, apr_off_t size, const unsigned char *checksum, const char *localPath)
+{
+    const size_t urlLen = strlen(url);
+    apr_pool_t *pool;
+    apr_file_t *in, *out;
+    StoreHeader header;
+    const char *path;
+    char *storedUrl;
+    unsigned char digest[APR_MD5_DIGESTSIZE];
+    int copied = 0;
+
+    apr_pool_create(&pool, NULL);
+    if (!(path = cachedir_path(Global.files, url, apr_psprintf(pool, ".r%ld", revision), pool))
+        || apr_file_open(&in, path, APR_READ | APR_BINARY, APR_OS_DEFAULT, pool) != APR_SUCCESS)
+    {
+        apr_pool_destroy(pool);
+        return 0;
+    }
+
+    /* the URL tells apart files whose URLs hash alike */
+    storedUrl = apr_palloc(pool, urlLen);
+    if (apr_file_read_full(in, &header, sizeof(header), NULL) == APR_SUCCESS
+        && !memcmp(header.magic, Magic, sizeof(Magic)) && header.size == size && header.urlLen == urlLen
+        && apr_file_read_full(in, storedUrl, urlLen, NULL) == APR_SUCCESS && !memcmp(storedUrl, url, urlLen)
+        && apr_file_open(&out, localPath, APR_WRITE | APR_CREATE | APR_TRUNCATE | APR_BINARY, APR_OS_DEFAULT, pool) == APR_SUCCESS)
+    {
+        copied = copyContents(in, out, size, checksum ? digest : NULL) == APR_SUCCESS
+                 && (!checksum || !memcmp(digest, checksum, APR_MD5_DIGESTSIZE));
+        apr_file_close(out);
+        if (!copied)
+        {
+            apr_file_remove(localPath, pool);
+        }
+    }
+    apr_file_close(in);
+    if (copied)
+    {
+        /* eviction goes by modification time */
+        apr_file_mtime_set(path, apr_time_now(), pool);
+    }
+    apr_pool_destroy(pool);
+    return copied;
+}
+
+/*--------------------------------------------------------------------------*/
+void filestore_store(const char *url, svn_revnum_t revision, const char *localPath)
+{
+    apr_pool_t *pool;
+    apr_file_t *in, *out;
+    apr_finfo_t finfo;
+    StoreHeader header;
+    char *path, *tempPath;
+    apr_status_t status;
+
+    apr_pool_create(&pool, NULL);
+    /* a single huge file would evict everything else */
+    if (!(path = cachedir_path(Global.files, url, apr_psprintf(pool, ".r%ld", revision), pool))
+        || apr_stat(&finfo, localPath, APR_FINFO_SIZE, pool) != APR_SUCCESS || finfo.size > cachedir_limit(Global.files) / 4
+        || apr_stat(&finfo, path, APR_FINFO_SIZE, pool) == APR_SUCCESS
+        || apr_file_open(&in, localPath, APR_READ | APR_BINARY, APR_OS_DEFAULT, pool) != APR_SUCCESS)
+    {
+        apr_pool_destroy(pool);
+        return;
+    }
+
+    if (cachedir_mktemp(Global.files, &out, &tempPath, APR_BINARY, pool) != APR_SUCCESS)
+    {
+        apr_pool_destroy(pool);
+        return;
+    }
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.urlLen = (apr_uint32_t) strlen(url);
+    header.reserved = 0;
+    /* the size of the open file, in case it has changed since apr_stat */
+    if ((status = apr_file_info_get(&finfo, APR_FINFO_SIZE, in)) == APR_SUCCESS)
+    {
+        header.size = finfo.size;
+        status = apr_file_write_full(out, &header, sizeof(header), NULL);
+    }
+    if (status == APR_SUCCESS)
+    {
+        status = apr_file_write_full(out, url, header.urlLen, NULL);
+    }
+    if (status == APR_SUCCESS)
+    {
+        status = copyContents(in, out, finfo.size, NULL);
+    }
+    apr_file_close(out);
+    apr_file_close(in);
+    if (status == APR_SUCCESS)
+    {
+        cachedir_commit(Global.files, tempPath, path, sizeof(header) + header.urlLen + finfo.size, pool);
+    }
+    else
+    {
+        apr_file_remove(tempPath, pool);
+    }
+    apr_pool_destroy(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static apr_status_t copyContents(apr_file_t *in, apr_file_t *out, apr_off_t size, unsigned char *md5)
+{
+    char buf[65536];
+    apr_md5_ctx_t ctx;
+    apr_status_t status = APR_SUCCESS;
+
+    apr_md5_init(&ctx);
+    while (size > 0 && status == APR_SUCCESS)
+    {
+        const apr_size_t len = size < (apr_off_t) sizeof(buf) ? (apr_size_t) size : sizeof(buf);
+        if ((status = apr_file_read_full(in, buf, len, NULL)) == APR_SUCCESS
+            && (status = apr_file_write_full(out, buf, len, NULL)) == APR_SUCCESS)
+        {
+            apr_md5_update(&ctx, buf, len);
+            size -= len;
+        }
+    }
+    if (md5)
+    {
+        apr_md5_final(md5, &ctx);
+    }
+    return status;
+}
@@ -0,0 +1,55 @@
+#ifndef SVN_WFX_FILESTORE_H_INCLUDED
+#define SVN_WFX_FILESTORE_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <svn_types.h>
+#include <apr_pools.h>
+
+/** Sets up the local file store. Downloaded files are kept as one file per
+    URL and revision, so a file that has not been committed to since it was
+    last downloaded is copied from disk instead of being fetched again. All
+    filestore functions are thread-safe.
+    @param pool The pool to allocate global state from. */
+extern void filestore_init(apr_pool_t *pool);
+
+/** Sets the store directory and size limit, evicting the least recently
+    used files if necessary.
+    @param dir The zero-terminated store directory. Created on demand.
+    @param maxBytes The maximum total size of all stored files. Zero disables
+                    the store. */
+extern void filestore_configure(const char *dir, apr_off_t maxBytes);
+
+/** Copies a stored file. The stored URL and size must match, and the
+    copied contents @a checksum if given; a mismatching copy is removed.
+    @param url The zero-terminated, unescaped URL of the file.
+    @param revision The created revision of the requested contents.
+    @param size The expected size of the file.
+    @param checksum The expected MD5 digest of the file, NULL if unknown.
+    @param localPath The zero-terminated destination path. An existing file is overwritten.
+    @return Non-zero if the file was copied, zero if it is not stored. */
+extern int filestore_fetch(const char *url, svn_revnum_t revision, apr_off_t size, const unsigned char *checksum, const char *localPath);
+
+/** Adds a copy of a downloaded file to the store. Failures are ignored.
+    @param url The zero-terminated, unescaped URL of the file.
+    @param revision The created revision of the downloaded contents.
+    @param localPath The zero-terminated path of the downloaded file. */
+extern void filestore_store(const char *url, svn_revnum_t revision, const char *localPath);
+
+#endif /* !SVN_WFX_FILESTORE_H_INCLUDED */
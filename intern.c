@@ -0,0 +1,88 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "intern.h"
+
+#include <apr_hash.h>
+#include <apr_thread_mutex.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+** Types
+*/
+typedef struct InternEntry
+{
+    unsigned int refCount;
+    char data[1];  /* zero-terminated, allocated past the end of the struct */
+} InternEntry;
+
+/*
+** Globals
+*/
+static struct
+{
+    apr_thread_mutex_t *mutex;
+    apr_hash_t *strings;  /* data -> InternEntry */
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+void intern_init(apr_pool_t *pool)
+{
+    apr_thread_mutex_create(&Global.mutex, APR_THREAD_MUTEX_DEFAULT, pool);
+    Global.strings = apr_hash_make(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+const char *intern_acquire(const char *str)
+{
+    const size_t len = strlen(str);
+    InternEntry *entry;
+
+    apr_thread_mutex_lock(Global.mutex);
+    entry = apr_hash_get(Global.strings, str, len);
+    if (!entry)
+    {
+        entry = malloc(offsetof(InternEntry, data) + len + 1);
+        entry->refCount = 0;
+        memcpy(entry->data, str, len + 1);
+        apr_hash_set(Global.strings, entry->data, len, entry);
+    }
+    ++entry->refCount;
+    apr_thread_mutex_unlock(Global.mutex);
+    return entry->data;
+}
+
+/*--------------------------------------------------------------------------*/
+void intern_release(const char *str)
+{
+    if (str)
+    {
+        InternEntry *entry = (InternEntry*) (str - offsetof(InternEntry, data));
+        apr_thread_mutex_lock(Global.mutex);
+        if (!--entry->refCount)
+        {
+            apr_hash_set(Global.strings, entry->data, strlen(entry->data), NULL);
+            free(entry);
+        }
+        apr_thread_mutex_unlock(Global.mutex);
+    }
+}
+
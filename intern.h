@@ -0,0 +1,41 @@
+#ifndef SVN_WFX_INTERN_H_INCLUDED
+#define SVN_WFX_INTERN_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <apr_pools.h>
+
+/** Initializes the intern table. Must be called before any other intern
+    function. All intern functions are thread-safe.
+    @param pool The pool to allocate the table from. */
+extern void intern_init(apr_pool_t *pool);
+
+/** Returns the process-wide copy of @a str, creating it if necessary, and
+    increments its reference count. Equal strings yield the same pointer,
+    so interned strings may be compared by address.
+    @param str The zero-terminated string.
+    @return The interned string. Release it with intern_release. */
+extern const char *intern_acquire(const char *str);
+
+/** Decrements the reference count of an interned string and frees it when
+    it drops to zero.
+    @param str A string returned by intern_acquire, may be NULL. */
+extern void intern_release(const char *str);
+
+#endif /* !SVN_WFX_INTERN_H_INCLUDED */
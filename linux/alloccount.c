@@ -0,0 +1,122 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "alloccount.h"
+
+#include <errno.h>
+
+/*
+** Prototypes
+*/
+
+/* glibc's own allocator, which the definitions below forward to */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+/** Counts an allocation of @a size bytes. */
+static void countAlloc(size_t size);
+
+/*
+** Globals
+*/
+static struct
+{
+    uint64_t allocs;
+    uint64_t bytes;
+    uint64_t frees;
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+void alloccount_get(AllocCount *count)
+{
+    count->allocs = __atomic_load_n(&Global.allocs, __ATOMIC_RELAXED);
+    count->bytes  = __atomic_load_n(&Global.bytes, __ATOMIC_RELAXED);
+    count->frees  = __atomic_load_n(&Global.frees, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------------*/
+void *malloc(size_t size)
+{
+    countAlloc(size);
+    return __libc_malloc(size);
+}
+
+/*--------------------------------------------------------------------------*/
+void *calloc(size_t count, size_t size)
+{
+    countAlloc(count * size);
+    return __libc_calloc(count, size);
+}
+
+/*--------------------------------------------------------------------------*/
+void *realloc(void *ptr, size_t size)
+{
+    countAlloc(size);
+    return __libc_realloc(ptr, size);
+}
+
+/*--------------------------------------------------------------------------*/
+void *memalign(size_t alignment, size_t size)
+{
+    countAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+/*--------------------------------------------------------------------------*/
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    countAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+/*--------------------------------------------------------------------------*/
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    void *p;
+    if (!alignment || (alignment & (alignment - 1)) || alignment % sizeof(void*))
+    {
+        return EINVAL;
+    }
+    countAlloc(size);
+    if (!(p = __libc_memalign(alignment, size)))
+    {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+void free(void *ptr)
+{
+    if (ptr)
+    {
+        __atomic_add_fetch(&Global.frees, 1, __ATOMIC_RELAXED);
+        __libc_free(ptr);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void countAlloc(size_t size)
+{
+    __atomic_add_fetch(&Global.allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&Global.bytes, size, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,39 @@
+#ifndef SVN_WFX_ALLOCCOUNT_H_INCLUDED
+#define SVN_WFX_ALLOCCOUNT_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Heap usage of the whole process since it started. alloccount.c replaces
+    malloc and friends, so allocations made inside APR, Subversion and the
+    plugin are all counted. */
+typedef struct AllocCount
+{
+    uint64_t allocs;  /* calls of malloc, calloc, realloc and the aligned variants */
+    uint64_t bytes;   /* bytes requested by those calls */
+    uint64_t frees;   /* calls of free with a non-NULL pointer */
+} AllocCount;
+
+/** Reads the counters of all threads.
+    @param count Receives the counters. */
+extern void alloccount_get(AllocCount *count);
+
+#endif /* !SVN_WFX_ALLOCCOUNT_H_INCLUDED */
@@ -0,0 +1,1463 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+** Benchmark driver for the plugin on Linux. It creates a synthetic file://
+** repository, points a configuration file at it and drives the Fs* entry
+** points the way Total Commander does, reporting latency percentiles,
+** heap allocations per operation and the peak RSS. Run with --help.
+**
+** The repository holds, for every entry count up to --max-entries, a
+** directory "flat/<count>/base" listed warm and --iterations copies of it
+** ("c0", "c1", ...) that are each listed once, so that every cold listing
+** really goes to the repository. Copies are cheap in Subversion, so the
+** repository stays about as large as a single set of directories.
+*/
+
+#include "svn_wfx.h"
+#include "alloccount.h"
+#include "location.h"
+#include "snapshot.h"
+
+#include <svn_fs.h>
+#include <svn_path.h>
+#include <svn_pools.h>
+#include <svn_props.h>
+#include <svn_repos.h>
+#include <apr_file_io.h>
+#include <apr_strings.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+/*
+** Types
+*/
+typedef struct Options
+{
+    const char *dir;        /* working directory, a temporary one if NULL */
+    int keep;               /* keep the working directory */
+    size_t maxEntries;      /* largest directory listed */
+    int iterations;         /* cold listings per directory size, and copies of each directory */
+    int largeMb;            /* size of the largest downloaded file */
+    int deepLevels;         /* depth of the deep tree */
+    int smallFiles;         /* files copied at once by the batch scenario */
+    int locations;          /* locations configured by the locations scenario */
+    const char *scenarios;  /* comma-separated scenario names, NULL for all */
+    const char *url;        /* directory of a remote repository for the session scenario, may be NULL */
+} Options;
+
+typedef struct Run
+{
+    double *samples;        /* microseconds per operation */
+    size_t count;
+    size_t capacity;
+    double started;         /* see runStart */
+    AllocCount allocs;      /* at runBegin */
+} Run;
+
+/** Directory entry as the plugin stored it before snapshots were packed:
+    one allocation for the record and one each for the name and the author. */
+typedef struct LegacyObject
+{
+    char *name;
+    svn_dirent_t dirent;
+    struct LegacyObject *next;
+} LegacyObject;
+
+typedef struct Scenario
+{
+    const char *name;
+    const char *description;
+    void (*run)(void);
+} Scenario;
+
+/*
+** Prototypes
+*/
+
+/** Prints the usage and exits. */
+static void usage(const char *argv0, int status);
+
+/** Parses the command line into Global.options. */
+static void parseOptions(int argc, char **argv);
+
+/** Exits with the message of @a err if it is not SVN_NO_ERROR. */
+static void check(svn_error_t *err);
+
+/** @return Non-zero if scenario @a name was selected on the command line. */
+static int selected(const char *name);
+
+/** @return The monotonic time in microseconds. */
+static double now(void);
+
+/** @return The peak resident set size of the process in MB. */
+static double peakRss(void);
+
+/** @return A pseudo-random number, the same sequence on every run. */
+static apr_uint32_t nextRandom(void);
+
+/** Starts a series of measurements. */
+static void runBegin(Run *run);
+
+/** Starts timing a single operation. */
+static void runStart(Run *run);
+
+/** Records the time since runStart as one sample. */
+static void runStop(Run *run);
+
+/** Orders samples for qsort. */
+static int compareSamples(const void *a, const void *b);
+
+/** Prints percentiles, allocations per operation and @a extra of a series
+    and frees its samples.
+    @param scenario The scenario name.
+    @param name The zero-terminated case name.
+    @param extra Additional zero-terminated column, e.g. a throughput, may be NULL. */
+static void runEnd(Run *run, const char *scenario, const char *name, const char *extra);
+
+/** Creates the benchmark repository unless the working directory holds one
+    that was created with the same parameters. */
+static void createRepository(void);
+
+/** Creates and fills the repository, see createRepository. */
+static svn_error_t *fillRepository(apr_pool_t *pool);
+
+/** Begins a transaction on the youngest revision with a log message and one
+    of a few authors.
+    @param number Number of the commit, selects the author. */
+static svn_error_t *beginCommit(svn_fs_txn_t **txn, svn_fs_root_t **root, svn_repos_t *repos, int number, apr_pool_t *pool);
+
+/** Commits @a txn. */
+static svn_error_t *endCommit(svn_repos_t *repos, svn_fs_txn_t *txn, apr_pool_t *pool);
+
+/** Adds a file of @a size pseudo-random bytes. */
+static svn_error_t *addFile(svn_fs_root_t *root, const char *path, apr_size_t size, apr_pool_t *pool);
+
+/** Copies @a path to Global.options.iterations siblings named "c0", "c1", ...
+    in a single commit. @param path The directory holding "base". */
+static svn_error_t *copyBase(svn_repos_t *repos, const char *path, int number, apr_pool_t *pool);
+
+/** Writes the configuration file with the benchmark location, the
+    Global.extraLocations locations "loc0", "loc1", ... and the default
+    benchmark options, followed by @a options, and makes the plugin load it.
+    @param options Additional "name = value" lines, may be empty. */
+static void configure(const char *options);
+
+/** Lists a directory through FsFindFirst and FsFindNext.
+    @param path The TC path, e.g. "\\bench\\flat".
+    @return The number of entries. */
+static size_t listDirectory(const char *path);
+
+/** Downloads a file through FsGetFile into the working directory.
+    @return The FsGetFile result. */
+static int getFile(const char *remoteName, apr_int64_t size);
+
+/** @return The index of the custom column named @a name, -1 if there is none. */
+static int findField(const char *name);
+
+/** @return The name of entry @a i of the generated directories. */
+static const char *entryName(size_t i, char *buf, size_t bufSize);
+
+/** Builds a finished snapshot of @a entries files named like the entries
+    of the generated directories, without a location. */
+static Snapshot *buildSnapshot(size_t entries);
+
+/** Builds a list of @a entries like buildSnapshot in the layout snapshots
+    had before they were packed, see LegacyObject. */
+static LegacyObject *buildLegacy(size_t entries);
+
+/** Frees a list created by buildLegacy. */
+static void freeLegacy(LegacyObject *obj);
+
+/** @see f_progress_t, never cancels. */
+static int __stdcall progress(int pluginId, const char *sourceName, const char *targetName, int percentDone);
+
+/** @see f_log_t, counts and prints errors and discards everything else. */
+static void __stdcall logMessage(int pluginId, LogMsgType msgType, const char *logString);
+
+/** @see f_request_t, answers no request. */
+static BOOL __stdcall request(int pluginId, RequestRqType requestType, const char *customTitle, const char *customText, char *returnedText, int maxLen);
+
+/** Lists directories of every size, each copy once. */
+static void benchListCold(void);
+
+/** Lists the same directory of every size repeatedly. */
+static void benchListWarm(void);
+
+/** Lists a deep tree level by level. */
+static void benchDeep(void);
+
+/** Reads custom column values of random entries of cached listings. */
+static void benchColumns(void);
+
+/** Looks up random names in snapshots of every size. */
+static void benchFind(void);
+
+/** Builds and frees snapshots of every size, packed and in the old layout. */
+static void benchBuild(void);
+
+/** Revalidates listings and downloads small files with and without reusing
+    RA sessions. */
+static void benchSession(void);
+
+/** Copies many small files at once with different numbers of download threads. */
+static void benchBatch(void);
+
+/** Translates TC paths of ASCII and UTF-8 names into escaped URLs. */
+static void benchEscape(void);
+
+/** Loads, lists and resolves thousands of locations. */
+static void benchLocations(void);
+
+/** Downloads files of increasing size. */
+static void benchGet(void);
+
+/*
+** Globals
+*/
+/* bump whenever fillRepository changes, so that kept repositories are recreated */
+static const int RepositoryLayout = 2;
+
+static const size_t EntryCounts[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+static const int LargeFileMb[] = { 1, 16, 64, 256, 1024 };
+static const apr_size_t SmallFileSize = 4096;
+static const int DownloadThreads[] = { 0, 1, 2, 4, 8 };
+static const char * const Authors[] = { "alice", "bob", "carol" };
+
+/* options every scenario starts from: no background work, nothing kept on disk */
+static const char DefaultOptions[] =
+    "cache_size = 4096\n"
+    "cache_ttl = 3600\n"
+    "prefetch_threads = 0\n"
+    "stream_threads = 0\n"
+    "disk_cache_size = 0\n"
+    "poll_interval = 0\n"
+    "session_idle_timeout = 300\n"
+    "download_threads = 0\n"
+    "file_store_size = 0\n"
+    "index_interval = 0\n"
+    "column_threads = 0\n"
+    "trace_events = 0\n";
+
+static const Scenario Scenarios[] =
+{
+    { "list-cold", "FsFindFirst/FsFindNext of directories listed for the first time", &benchListCold },
+    { "list-warm", "FsFindFirst/FsFindNext of a cached directory",                     &benchListWarm },
+    { "deep",      "cold listings of every level of a deep tree",                     &benchDeep     },
+    { "columns",   "FsContentGetValue of random entries of a cached directory",       &benchColumns  },
+    { "find",      "snapshot_find of random names, the lookup behind every column",   &benchFind     },
+    { "build",     "allocations and time to store and free a listing",                 &benchBuild    },
+    { "session",   "server round-trips with and without the RA session pool",          &benchSession  },
+    { "batch",     "multi-file copies between FsStatusInfo notifications",             &benchBatch    },
+    { "escape",    "location_url of ASCII and UTF-8 paths",                             &benchEscape   },
+    { "locations", "configuration reload, root listing and location_resolve",         &benchLocations },
+    { "get",       "FsGetFile of a single file",                                      &benchGet      },
+    { NULL, NULL, NULL }
+};
+
+static struct
+{
+    Options options;
+    apr_pool_t *pool;
+    const char *dir;         /* working directory */
+    const char *repoPath;
+    const char *repoUrl;
+    const char *configPath;  /* where the plugin looks for svn_wfx.ini, see main */
+    const char *downloadPath;
+    int configWrites;        /* see configure */
+    int errors;              /* errors the plugin logged, see logMessage */
+    int extraLocations;      /* locations configure adds besides "bench" */
+    apr_uint32_t random;
+} Global = { { 0 } };
+
+/*--------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    FsDefaultParamStruct dps;
+    const Scenario *scenario;
+    char root[16];
+
+    parseOptions(argc, argv);
+    if (FsInit(1, &progress, &logMessage, &request))
+    {
+        fprintf(stderr, "FsInit failed\n");
+        return 1;
+    }
+    Global.pool = svn_pool_create(NULL);
+    if (Global.options.dir)
+    {
+        Global.dir = Global.options.dir;
+        apr_dir_make_recursive(Global.dir, APR_OS_DEFAULT, Global.pool);
+    }
+    else
+    {
+        char *dir = apr_pstrdup(Global.pool, "/tmp/svn_wfx_bench.XXXXXX");
+        if (!mkdtemp(dir))
+        {
+            perror("mkdtemp");
+            return 1;
+        }
+        Global.dir = dir;
+    }
+    Global.repoPath = apr_pstrcat(Global.pool, Global.dir, "/repo", NULL);
+    Global.repoUrl = apr_pstrcat(Global.pool, "file://", Global.repoPath, NULL);
+    Global.downloadPath = apr_pstrcat(Global.pool, Global.dir, "/download", NULL);
+    Global.random = 2463534242u;
+    createRepository();
+
+    /* The plugin takes the directory of TC's ini file up to the last
+       backslash, which on Linux makes it keep its files in Global.dir
+       with a leading backslash in their names. */
+    memset(&dps, 0, sizeof(dps));
+    dps.size = sizeof(dps);
+    apr_snprintf(dps.DefaultIniName, sizeof(dps.DefaultIniName), "%s/\\wincmd.ini", Global.dir);
+    Global.configPath = apr_pstrcat(Global.pool, Global.dir, "/\\svn_wfx.ini", NULL);
+    configure("");
+    FsSetDefaultParams(&dps);
+    FsGetDefRootName(root, sizeof(root));
+
+    printf("# svn_wfx_bench: %s, up to %lu entries, %d iterations\n", Global.repoUrl,
+           (unsigned long) Global.options.maxEntries, Global.options.iterations);
+    printf("%-10s %-44s %7s %10s %10s %10s %10s %10s %10s  %s\n",
+           "scenario", "case", "ops", "p50 us", "p90 us", "p99 us", "max us", "allocs/op", "KB/op", "");
+    for (scenario = Scenarios; scenario->name; ++scenario)
+    {
+        if (selected(scenario->name))
+        {
+            scenario->run();
+            printf("# %s: peak RSS %.1f MB\n", scenario->name, peakRss());
+            fflush(stdout);
+        }
+    }
+
+    FsContentPluginUnloading();
+    if (!Global.options.dir && !Global.options.keep)
+    {
+        svn_error_clear(svn_io_remove_dir2(Global.dir, TRUE, NULL, NULL, Global.pool));
+    }
+    svn_pool_destroy(Global.pool);
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+static void usage(const char *argv0, int status)
+{
+    const Scenario *scenario;
+    fprintf(status ? stderr : stdout,
+            "usage: %s [options]\n"
+            "  --dir DIR          keep the repository in DIR and reuse it on the next run\n"
+            "  --keep             keep the temporary working directory\n"
+            "  --max-entries N    largest directory, 10 to 1000000 (default 10000)\n"
+            "  --iterations N     measurements per case (default 20)\n"
+            "  --large-mb N       largest downloaded file in MB (default 64)\n"
+            "  --deep N           levels of the deep tree (default 32)\n"
+            "  --small-files N    files copied at once in the batch scenario (default 500)\n"
+            "  --locations N      locations configured in the locations scenario (default 10000)\n"
+            "  --scenario LIST    comma-separated scenarios to run (default all)\n"
+            "  --url URL          also list URL, e.g. an https repository, in the session scenario\n"
+            "  --quick            tiny sizes, for a smoke test\n"
+            "scenarios:\n", argv0);
+    for (scenario = Scenarios; scenario->name; ++scenario)
+    {
+        fprintf(status ? stderr : stdout, "  %-12s %s\n", scenario->name, scenario->description);
+    }
+    exit(status);
+}
+
+/*--------------------------------------------------------------------------*/
+static void parseOptions(int argc, char **argv)
+{
+    Options *options = &Global.options;
+    int i;
+
+    options->maxEntries = 10000;
+    options->iterations = 20;
+    options->largeMb = 64;
+    options->deepLevels = 32;
+    options->smallFiles = 500;
+    options->locations = 10000;
+    for (i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(arg, "--help"))
+        {
+            usage(argv[0], 0);
+        }
+        else if (!strcmp(arg, "--keep"))
+        {
+            options->keep = TRUE;
+        }
+        else if (!strcmp(arg, "--quick"))
+        {
+            options->maxEntries = 100;
+            options->iterations = 3;
+            options->largeMb = 1;
+            options->deepLevels = 4;
+            options->smallFiles = 20;
+            options->locations = 100;
+        }
+        else if (!value)
+        {
+            usage(argv[0], 1);
+        }
+        else
+        {
+            ++i;
+            if (!strcmp(arg, "--dir"))
+            {
+                options->dir = value;
+            }
+            else if (!strcmp(arg, "--max-entries"))
+            {
+                options->maxEntries = (size_t) atol(value);
+            }
+            else if (!strcmp(arg, "--iterations"))
+            {
+                options->iterations = atoi(value);
+            }
+            else if (!strcmp(arg, "--large-mb"))
+            {
+                options->largeMb = atoi(value);
+            }
+            else if (!strcmp(arg, "--deep"))
+            {
+                options->deepLevels = atoi(value);
+            }
+            else if (!strcmp(arg, "--small-files"))
+            {
+                options->smallFiles = atoi(value);
+            }
+            else if (!strcmp(arg, "--locations"))
+            {
+                options->locations = atoi(value);
+            }
+            else if (!strcmp(arg, "--scenario"))
+            {
+                options->scenarios = value;
+            }
+            else if (!strcmp(arg, "--url"))
+            {
+                options->url = value;
+            }
+            else
+            {
+                usage(argv[0], 1);
+            }
+        }
+    }
+    if (options->iterations < 1 || options->maxEntries < EntryCounts[0] || options->largeMb < 1 || options->deepLevels < 1 || options->smallFiles < 1 || options->locations < 1)
+    {
+        usage(argv[0], 1);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void check(svn_error_t *err)
+{
+    if (err)
+    {
+        svn_handle_error2(err, stderr, FALSE, "svn_wfx_bench: ");
+        exit(1);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static int selected(const char *name)
+{
+    const char *p = Global.options.scenarios;
+    const size_t len = strlen(name);
+
+    if (!p)
+    {
+        return TRUE;
+    }
+    while (*p)
+    {
+        const char *end = strchr(p, ',');
+        const size_t n = end ? (size_t) (end - p) : strlen(p);
+        if (n == len && !memcmp(p, name, len))
+        {
+            return TRUE;
+        }
+        p += n + (end != NULL);
+    }
+    return FALSE;
+}
+
+/*--------------------------------------------------------------------------*/
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/*--------------------------------------------------------------------------*/
+static double peakRss(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+/*--------------------------------------------------------------------------*/
+static apr_uint32_t nextRandom(void)
+{
+    /* xorshift32 */
+    apr_uint32_t x = Global.random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return Global.random = x;
+}
+
+/*--------------------------------------------------------------------------*/
+static void runBegin(Run *run)
+{
+    memset(run, 0, sizeof(*run));
+    alloccount_get(&run->allocs);
+}
+
+/*--------------------------------------------------------------------------*/
+static void runStart(Run *run)
+{
+    run->started = now();
+}
+
+/*--------------------------------------------------------------------------*/
+static void runStop(Run *run)
+{
+    const double elapsed = now() - run->started;
+    if (run->count == run->capacity)
+    {
+        run->capacity = run->capacity ? 2 * run->capacity : 64;
+        run->samples = realloc(run->samples, run->capacity * sizeof(*run->samples));
+    }
+    run->samples[run->count++] = elapsed;
+}
+
+/*--------------------------------------------------------------------------*/
+static int compareSamples(const void *a, const void *b)
+{
+    const double x = *(const double*) a, y = *(const double*) b;
+    return x < y ? -1 : x > y;
+}
+
+/*--------------------------------------------------------------------------*/
+static void runEnd(Run *run, const char *scenario, const char *name, const char *extra)
+{
+    AllocCount allocs;
+    double p[3];
+    const double fractions[3] = { 0.5, 0.9, 0.99 };
+    int i;
+
+    alloccount_get(&allocs);
+    if (!run->count)
+    {
+        free(run->samples);
+        return;
+    }
+    qsort(run->samples, run->count, sizeof(*run->samples), &compareSamples);
+    for (i = 0; i < 3; ++i)
+    {
+        /* nearest rank */
+        size_t rank = (size_t) (fractions[i] * run->count + 0.999999);
+        p[i] = run->samples[(rank ? rank : 1) - 1];
+    }
+    printf("%-10s %-44s %7lu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f  %s\n",
+           scenario, name, (unsigned long) run->count, p[0], p[1], p[2], run->samples[run->count - 1],
+           (double) (allocs.allocs - run->allocs.allocs) / run->count,
+           (double) (allocs.bytes - run->allocs.bytes) / run->count / 1024,
+           extra ? extra : "");
+    fflush(stdout);
+    free(run->samples);
+    run->samples = NULL;
+}
+
+
+/*--------------------------------------------------------------------------*/
+static void createRepository(void)
+{
+    apr_pool_t *pool = svn_pool_create(Global.pool);
+    const char *paramsPath = apr_pstrcat(pool, Global.dir, "/repo.params", NULL);
+    const char *params = apr_psprintf(pool, "layout %d, %lu entries, %d copies, %d MB, %d levels, %d small files\n",
+                                      RepositoryLayout, (unsigned long) Global.options.maxEntries, Global.options.iterations,
+                                      Global.options.largeMb, Global.options.deepLevels, Global.options.smallFiles);
+    char existing[256] = "";
+    FILE *f;
+    double start;
+
+    if ((f = fopen(paramsPath, "r")))
+    {
+        if (!fgets(existing, sizeof(existing), f))
+        {
+            *existing = '\0';
+        }
+        fclose(f);
+        if (!strcmp(existing, params))
+        {
+            svn_pool_destroy(pool);
+            return;
+        }
+    }
+    start = now();
+    remove(paramsPath);
+    check(svn_io_remove_dir2(Global.repoPath, TRUE, NULL, NULL, pool));
+    check(fillRepository(pool));
+    if ((f = fopen(paramsPath, "w")))
+    {
+        fputs(params, f);
+        fclose(f);
+    }
+    printf("# created %s in %.1f s\n", Global.repoPath, (now() - start) / 1e6);
+    svn_pool_destroy(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *fillRepository(apr_pool_t *pool)
+{
+    apr_pool_t *iterpool = svn_pool_create(pool);
+    apr_hash_t *fsConfig = apr_hash_make(pool);
+    svn_repos_t *repos;
+    svn_fs_txn_t *txn;
+    svn_fs_root_t *root;
+    char name[32];
+    const char *path;
+    size_t count, i;
+    int number = 0, level;
+
+    apr_hash_set(fsConfig, SVN_FS_CONFIG_FS_TYPE, APR_HASH_KEY_STRING, SVN_FS_TYPE_FSFS);
+    SVN_ERR(svn_repos_create(&repos, Global.repoPath, NULL, NULL, NULL, fsConfig, pool));
+
+    SVN_ERR(beginCommit(&txn, &root, repos, number++, pool));
+    SVN_ERR(svn_fs_make_dir(root, "flat", pool));
+    SVN_ERR(svn_fs_make_dir(root, "deep", pool));
+    SVN_ERR(svn_fs_make_dir(root, "large", pool));
+    SVN_ERR(svn_fs_make_dir(root, "small", pool));
+    SVN_ERR(endCommit(repos, txn, pool));
+
+    /* flat directories, each filled over a few commits for varied column values */
+    for (count = 0; count < sizeof(EntryCounts) / sizeof(*EntryCounts) && EntryCounts[count] <= Global.options.maxEntries; ++count)
+    {
+        const size_t entries = EntryCounts[count];
+        const size_t commits = entries < 8 ? entries : 8;
+        size_t commit;
+
+        path = apr_psprintf(pool, "flat/%lu", (unsigned long) entries);
+        for (commit = 0, i = 0; commit < commits; ++commit)
+        {
+            SVN_ERR(beginCommit(&txn, &root, repos, number++, pool));
+            if (!commit)
+            {
+                SVN_ERR(svn_fs_make_dir(root, path, pool));
+                SVN_ERR(svn_fs_make_dir(root, apr_pstrcat(pool, path, "/base", NULL), pool));
+            }
+            for (; i < (commit + 1) * entries / commits; ++i)
+            {
+                svn_pool_clear(iterpool);
+                entryName(i, name, sizeof(name));
+                SVN_ERR(addFile(root, apr_pstrcat(iterpool, path, "/base/", name, NULL), 16 + i % 64, iterpool));
+            }
+            SVN_ERR(endCommit(repos, txn, pool));
+        }
+        SVN_ERR(copyBase(repos, path, number++, pool));
+    }
+
+    /* a chain of directories with a few files on every level */
+    SVN_ERR(beginCommit(&txn, &root, repos, number++, pool));
+    path = "deep/base";
+    SVN_ERR(svn_fs_make_dir(root, path, pool));
+    for (level = 0; level < Global.options.deepLevels; ++level)
+    {
+        path = apr_psprintf(pool, "%s/l%d", path, level);
+        SVN_ERR(svn_fs_make_dir(root, path, pool));
+        for (i = 0; i < 8; ++i)
+        {
+            svn_pool_clear(iterpool);
+            entryName(i, name, sizeof(name));
+            SVN_ERR(addFile(root, apr_pstrcat(iterpool, path, "/", name, NULL), 256, iterpool));
+        }
+    }
+    SVN_ERR(endCommit(repos, txn, pool));
+    SVN_ERR(copyBase(repos, "deep", number++, pool));
+
+    /* files copied in a batch */
+    SVN_ERR(beginCommit(&txn, &root, repos, number++, pool));
+    for (i = 0; i < (size_t) Global.options.smallFiles; ++i)
+    {
+        svn_pool_clear(iterpool);
+        entryName(i, name, sizeof(name));
+        SVN_ERR(addFile(root, apr_pstrcat(iterpool, "small/", name, NULL), SmallFileSize, iterpool));
+    }
+    SVN_ERR(endCommit(repos, txn, pool));
+
+    /* files to download */
+    for (i = 0; i < sizeof(LargeFileMb) / sizeof(*LargeFileMb) && LargeFileMb[i] <= Global.options.largeMb; ++i)
+    {
+        svn_pool_clear(iterpool);
+        SVN_ERR(beginCommit(&txn, &root, repos, number++, iterpool));
+        SVN_ERR(addFile(root, apr_psprintf(iterpool, "large/%dmb.bin", LargeFileMb[i]),
+                        (apr_size_t) LargeFileMb[i] << 20, iterpool));
+        SVN_ERR(endCommit(repos, txn, iterpool));
+    }
+
+    svn_pool_destroy(iterpool);
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *beginCommit(svn_fs_txn_t **txn, svn_fs_root_t **root, svn_repos_t *repos, int number, apr_pool_t *pool)
+{
+    svn_fs_t *fs = svn_repos_fs(repos);
+    svn_revnum_t youngest;
+
+    SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+    SVN_ERR(svn_fs_begin_txn2(txn, fs, youngest, 0, pool));
+    SVN_ERR(svn_fs_change_txn_prop(*txn, SVN_PROP_REVISION_AUTHOR,
+                                   svn_string_create(Authors[number % (sizeof(Authors) / sizeof(*Authors))], pool), pool));
+    SVN_ERR(svn_fs_change_txn_prop(*txn, SVN_PROP_REVISION_LOG,
+                                   svn_string_createf(pool, "Benchmark commit %d\n\nGenerated by svn_wfx_bench.", number), pool));
+    return svn_fs_txn_root(root, *txn, pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *endCommit(svn_repos_t *repos, svn_fs_txn_t *txn, apr_pool_t *pool)
+{
+    const char *conflict;
+    svn_revnum_t revision;
+    return svn_repos_fs_commit_txn(&conflict, repos, &revision, txn, pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *addFile(svn_fs_root_t *root, const char *path, apr_size_t size, apr_pool_t *pool)
+{
+    apr_uint32_t buf[16384];
+    svn_stream_t *stream;
+
+    SVN_ERR(svn_fs_make_file(root, path, pool));
+    SVN_ERR(svn_fs_apply_text(&stream, root, path, NULL, pool));
+    while (size)
+    {
+        apr_size_t len = size < sizeof(buf) ? size : sizeof(buf);
+        size_t i;
+        for (i = 0; i < (len + 3) / 4; ++i)
+        {
+            buf[i] = nextRandom();
+        }
+        SVN_ERR(svn_stream_write(stream, (const char*) buf, &len));
+        size -= len;
+    }
+    return svn_stream_close(stream);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *copyBase(svn_repos_t *repos, const char *path, int number, apr_pool_t *pool)
+{
+    svn_fs_t *fs = svn_repos_fs(repos);
+    svn_fs_root_t *youngestRoot, *root;
+    svn_fs_txn_t *txn;
+    svn_revnum_t youngest;
+    const char *base = apr_pstrcat(pool, path, "/base", NULL);
+    int i;
+
+    SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+    SVN_ERR(svn_fs_revision_root(&youngestRoot, fs, youngest, pool));
+    SVN_ERR(beginCommit(&txn, &root, repos, number, pool));
+    for (i = 0; i < Global.options.iterations; ++i)
+    {
+        SVN_ERR(svn_fs_copy(youngestRoot, base, root, apr_psprintf(pool, "%s/c%d", path, i), pool));
+    }
+    return endCommit(repos, txn, pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static void configure(const char *options)
+{
+    struct timespec times[2];
+    FILE *f = fopen(Global.configPath, "w");
+    HANDLE find;
+    WIN32_FIND_DATA findData;
+    int i;
+
+    if (!f)
+    {
+        perror(Global.configPath);
+        exit(1);
+    }
+    fprintf(f, "bench = %s\n", Global.repoUrl);
+    if (Global.options.url)
+    {
+        fprintf(f, "remote = %s\n", Global.options.url);
+    }
+    for (i = 0; i < Global.extraLocations; ++i)
+    {
+        fprintf(f, "loc%d = %s/flat/10/base\n", i, Global.repoUrl);
+    }
+    fprintf(f, "\n[options]\n%s%s", DefaultOptions, options);
+    fclose(f);
+
+    /* The plugin reloads the file when its modification time changes, which
+       the kernel's coarse timestamps might not show for quick rewrites. */
+    times[0].tv_sec = times[1].tv_sec = 1000000000 + ++Global.configWrites;
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+    utimensat(AT_FDCWD, Global.configPath, times, 0);
+
+    /* listing the root reloads the configuration */
+    if ((find = FsFindFirst("\\", &findData)) != INVALID_HANDLE_VALUE)
+    {
+        while (FsFindNext(find, &findData))
+        {
+        }
+        FsFindClose(find);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static size_t listDirectory(const char *path)
+{
+    WIN32_FIND_DATA findData;
+    HANDLE find = FsFindFirst((char*) path, &findData);
+    size_t count = 0;
+
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            ++count;
+        }
+        while (FsFindNext(find, &findData));
+        FsFindClose(find);
+    }
+    return count;
+}
+
+/*--------------------------------------------------------------------------*/
+static int getFile(const char *remoteName, apr_int64_t size)
+{
+    RemoteInfoStruct ri;
+    memset(&ri, 0, sizeof(ri));
+    ri.SizeLow  = (DWORD) size;
+    ri.SizeHigh = (DWORD) (size >> 32);
+    ri.Attr = FILE_ATTRIBUTE_NORMAL;
+    return FsGetFile((char*) remoteName, (char*) Global.downloadPath, FS_COPYFLAGS_OVERWRITE, &ri);
+}
+
+/*--------------------------------------------------------------------------*/
+static int findField(const char *name)
+{
+    char fieldName[64], units[64];
+    int i;
+    for (i = 0; FsContentGetSupportedField(i, fieldName, units, sizeof(fieldName)) != FT_NOMOREFIELDS; ++i)
+    {
+        if (!strcmp(fieldName, name))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*--------------------------------------------------------------------------*/
+static const char *entryName(size_t i, char *buf, size_t bufSize)
+{
+    apr_snprintf(buf, bufSize, "f%07lu.txt", (unsigned long) i);
+    return buf;
+}
+
+/*--------------------------------------------------------------------------*/
+static Snapshot *buildSnapshot(size_t entries)
+{
+    Snapshot *snapshot = snapshot_create(NULL, "", 0);
+    svn_dirent_t dirent;
+    char name[32];
+    size_t i;
+
+    memset(&dirent, 0, sizeof(dirent));
+    dirent.kind = svn_node_file;
+    for (i = 0; i < entries; ++i)
+    {
+        dirent.size = 16 + i % 64;
+        dirent.created_rev = (svn_revnum_t) (1 + i % 8);
+        dirent.time = (apr_time_t) dirent.created_rev * APR_USEC_PER_SEC;
+        dirent.last_author = Authors[i % (sizeof(Authors) / sizeof(*Authors))];
+        snapshot_add(snapshot, entryName(i, name, sizeof(name)), &dirent);
+    }
+    snapshot_finish(snapshot);
+    return snapshot;
+}
+
+/*--------------------------------------------------------------------------*/
+static LegacyObject *buildLegacy(size_t entries)
+{
+    LegacyObject *list = NULL;
+    svn_dirent_t dirent;
+    char name[32];
+    size_t i;
+
+    memset(&dirent, 0, sizeof(dirent));
+    dirent.kind = svn_node_file;
+    for (i = 0; i < entries; ++i)
+    {
+        LegacyObject *obj = malloc(sizeof(*obj));
+        dirent.size = 16 + i % 64;
+        dirent.created_rev = (svn_revnum_t) (1 + i % 8);
+        dirent.time = (apr_time_t) dirent.created_rev * APR_USEC_PER_SEC;
+        dirent.last_author = Authors[i % (sizeof(Authors) / sizeof(*Authors))];
+        memcpy(&obj->dirent, &dirent, sizeof(dirent));
+        obj->dirent.last_author = strdup(dirent.last_author);
+        obj->name = strdup(entryName(i, name, sizeof(name)));
+        obj->next = list;
+        list = obj;
+    }
+    return list;
+}
+
+/*--------------------------------------------------------------------------*/
+static void freeLegacy(LegacyObject *obj)
+{
+    while (obj)
+    {
+        LegacyObject *next = obj->next;
+        free(obj->name);
+        free((char*) obj->dirent.last_author);
+        free(obj);
+        obj = next;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static int __stdcall progress(int pluginId, const char *sourceName, const char *targetName, int percentDone)
+{
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+static void __stdcall logMessage(int pluginId, LogMsgType msgType, const char *logString)
+{
+    if (msgType == MSGTYPE_IMPORTANTERROR)
+    {
+        fprintf(stderr, "%s\n", logString);
+        ++Global.errors;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static BOOL __stdcall request(int pluginId, RequestRqType requestType, const char *customTitle, const char *customText, char *returnedText, int maxLen)
+{
+    return FALSE;
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchListCold(void)
+{
+    size_t count;
+    char path[MAX_PATH], name[64];
+    int i;
+
+    configure("");
+    for (count = 0; count < sizeof(EntryCounts) / sizeof(*EntryCounts) && EntryCounts[count] <= Global.options.maxEntries; ++count)
+    {
+        Run run;
+        runBegin(&run);
+        for (i = 0; i < Global.options.iterations; ++i)
+        {
+            size_t listed;
+            apr_snprintf(path, sizeof(path), "\\bench\\flat\\%lu\\c%d", (unsigned long) EntryCounts[count], i);
+            runStart(&run);
+            listed = listDirectory(path);
+            runStop(&run);
+            if (listed != EntryCounts[count])
+            {
+                fprintf(stderr, "%s: %lu entries listed\n", path, (unsigned long) listed);
+                exit(1);
+            }
+        }
+        apr_snprintf(name, sizeof(name), "entries=%lu", (unsigned long) EntryCounts[count]);
+        runEnd(&run, "list-cold", name, NULL);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchListWarm(void)
+{
+    size_t count;
+    char path[MAX_PATH], name[64];
+    int i;
+
+    configure("");
+    for (count = 0; count < sizeof(EntryCounts) / sizeof(*EntryCounts) && EntryCounts[count] <= Global.options.maxEntries; ++count)
+    {
+        Run run;
+        apr_snprintf(path, sizeof(path), "\\bench\\flat\\%lu\\base", (unsigned long) EntryCounts[count]);
+        listDirectory(path);
+        runBegin(&run);
+        for (i = 0; i < Global.options.iterations; ++i)
+        {
+            runStart(&run);
+            listDirectory(path);
+            runStop(&run);
+        }
+        apr_snprintf(name, sizeof(name), "entries=%lu", (unsigned long) EntryCounts[count]);
+        runEnd(&run, "list-warm", name, NULL);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchDeep(void)
+{
+    Run run;
+    char name[64];
+    int i, level;
+
+    configure("");
+    runBegin(&run);
+    for (i = 0; i < Global.options.iterations; ++i)
+    {
+        char *path = apr_psprintf(Global.pool, "\\bench\\deep\\c%d", i);
+        for (level = 0; level < Global.options.deepLevels; ++level)
+        {
+            path = apr_psprintf(Global.pool, "%s\\l%d", path, level);
+            runStart(&run);
+            if (listDirectory(path) != 8 + (level + 1 < Global.options.deepLevels))
+            {
+                fprintf(stderr, "%s: unexpected listing\n", path);
+                exit(1);
+            }
+            runStop(&run);
+        }
+    }
+    apr_snprintf(name, sizeof(name), "levels=%d, per level", Global.options.deepLevels);
+    runEnd(&run, "deep", name, NULL);
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchColumns(void)
+{
+    static const char * const FieldNames[] = { "revision", "author", "message" };
+    size_t count, f;
+    char dir[MAX_PATH], name[64];
+
+    configure("");
+    for (count = 0; count < sizeof(EntryCounts) / sizeof(*EntryCounts) && EntryCounts[count] <= Global.options.maxEntries; ++count)
+    {
+        const size_t entries = EntryCounts[count];
+
+        /* the time per value should not depend on the directory size */
+        apr_snprintf(dir, sizeof(dir), "\\bench\\flat\\%lu\\base", (unsigned long) entries);
+        listDirectory(dir);
+        for (f = 0; f < sizeof(FieldNames) / sizeof(*FieldNames); ++f)
+        {
+            const int field = findField(FieldNames[f]);
+            Run run;
+            int i;
+
+            if (field < 0)
+            {
+                fprintf(stderr, "no column %s\n", FieldNames[f]);
+                exit(1);
+            }
+            runBegin(&run);
+            for (i = 0; i < 10 * Global.options.iterations; ++i)
+            {
+                char path[MAX_PATH], entry[32], value[1024];
+                int result;
+                apr_snprintf(path, sizeof(path), "%s\\%s", dir, entryName(nextRandom() % entries, entry, sizeof(entry)));
+                runStart(&run);
+                result = FsContentGetValue(path, field, 0, value, sizeof(value), 0);
+                runStop(&run);
+                if (result == FT_NOSUCHFIELD || result == FT_FILEERROR || result == FT_DELAYED)
+                {
+                    fprintf(stderr, "%s: column %s failed (%d)\n", path, FieldNames[f], result);
+                    exit(1);
+                }
+            }
+            apr_snprintf(name, sizeof(name), "%s, entries=%lu", FieldNames[f], (unsigned long) entries);
+            runEnd(&run, "columns", name, NULL);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchFind(void)
+{
+    enum { Lookups = 1000 };
+    size_t count;
+    char name[64];
+
+    for (count = 0; count < sizeof(EntryCounts) / sizeof(*EntryCounts) && EntryCounts[count] <= Global.options.maxEntries; ++count)
+    {
+        const size_t entries = EntryCounts[count];
+        Snapshot *snapshot = buildSnapshot(entries);
+        char (*names)[32] = malloc(Lookups * sizeof(*names));
+        Run run;
+        int i, j;
+
+        /* names are generated up front so that only the lookups are timed */
+        for (j = 0; j < Lookups; ++j)
+        {
+            entryName(nextRandom() % entries, names[j], sizeof(names[j]));
+        }
+        runBegin(&run);
+        for (i = 0; i < 10 * Global.options.iterations; ++i)
+        {
+            runStart(&run);
+            for (j = 0; j < Lookups; ++j)
+            {
+                if (!snapshot_find(snapshot, names[j]))
+                {
+                    fprintf(stderr, "snapshot_find(%s) failed\n", names[j]);
+                    exit(1);
+                }
+            }
+            runStop(&run);
+        }
+        apr_snprintf(name, sizeof(name), "entries=%lu, %d lookups", (unsigned long) entries, Lookups);
+        runEnd(&run, "find", name, NULL);
+        free(names);
+        snapshot_release(snapshot);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchBuild(void)
+{
+    size_t count;
+    char name[64], extra[64];
+    int legacy, i;
+
+    for (count = 0; count < sizeof(EntryCounts) / sizeof(*EntryCounts) && EntryCounts[count] <= Global.options.maxEntries; ++count)
+    {
+        const size_t entries = EntryCounts[count];
+        for (legacy = 0; legacy < 2; ++legacy)
+        {
+            AllocCount before, built;
+            apr_uint64_t allocs = 0, bytes = 0;
+            Run run;
+
+            /* allocs/op covers building and freeing, the extra column
+               only building */
+            runBegin(&run);
+            for (i = 0; i < Global.options.iterations; ++i)
+            {
+                Snapshot *snapshot = NULL;
+                LegacyObject *list = NULL;
+                runStart(&run);
+                alloccount_get(&before);
+                if (legacy)
+                {
+                    list = buildLegacy(entries);
+                }
+                else
+                {
+                    snapshot = buildSnapshot(entries);
+                }
+                alloccount_get(&built);
+                if (legacy)
+                {
+                    freeLegacy(list);
+                }
+                else
+                {
+                    snapshot_release(snapshot);
+                }
+                runStop(&run);
+                allocs += built.allocs - before.allocs;
+                bytes += built.bytes - before.bytes;
+            }
+            apr_snprintf(name, sizeof(name), "%s, entries=%lu", legacy ? "per-entry" : "packed", (unsigned long) entries);
+            apr_snprintf(extra, sizeof(extra), "%.2f allocs/entry, %.1f B/entry",
+                         (double) allocs / run.count / entries, (double) bytes / run.count / entries);
+            runEnd(&run, "build", name, extra);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchSession(void)
+{
+    /* every listing goes to the server, so each call needs a session */
+    static const char * const Configs[] = { "cache_ttl = 0\nsession_idle_timeout = 0\n",
+                                            "cache_ttl = 0\nsession_idle_timeout = 300\n" };
+    static const char * const ConfigNames[] = { "no pool", "pool" };
+    char name[64], file[MAX_PATH], entry[32];
+    size_t config;
+    int i;
+
+    for (config = 0; config < sizeof(Configs) / sizeof(*Configs); ++config)
+    {
+        Run run;
+
+        configure(Configs[config]);
+        /* the first call of each case opens the pooled session */
+        listDirectory("\\bench\\flat\\10\\base");
+        runBegin(&run);
+        for (i = 0; i < 10 * Global.options.iterations; ++i)
+        {
+            runStart(&run);
+            listDirectory("\\bench\\flat\\10\\base");
+            runStop(&run);
+        }
+        apr_snprintf(name, sizeof(name), "list, %s", ConfigNames[config]);
+        runEnd(&run, "session", name, NULL);
+
+        runBegin(&run);
+        for (i = 0; i < 10 * Global.options.iterations; ++i)
+        {
+            apr_snprintf(file, sizeof(file), "\\bench\\flat\\10\\base\\%s", entryName(i % 10, entry, sizeof(entry)));
+            runStart(&run);
+            if (getFile(file, 16 + i % 10) != FS_FILE_OK)
+            {
+                fprintf(stderr, "%s: FsGetFile failed\n", file);
+                exit(1);
+            }
+            runStop(&run);
+        }
+        apr_snprintf(name, sizeof(name), "get, %s", ConfigNames[config]);
+        runEnd(&run, "session", name, NULL);
+
+        if (Global.options.url)
+        {
+            listDirectory("\\remote");
+            runBegin(&run);
+            for (i = 0; i < Global.options.iterations; ++i)
+            {
+                runStart(&run);
+                listDirectory("\\remote");
+                runStop(&run);
+            }
+            apr_snprintf(name, sizeof(name), "list --url, %s", ConfigNames[config]);
+            runEnd(&run, "session", name, NULL);
+        }
+    }
+    remove(Global.downloadPath);
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchBatch(void)
+{
+    const char *batchDir = apr_pstrcat(Global.pool, Global.dir, "/batch", NULL);
+    char name[64], rate[64], entry[32];
+    size_t threads;
+    int i, j;
+
+    apr_dir_make_recursive(batchDir, APR_OS_DEFAULT, Global.pool);
+    for (threads = 0; threads < sizeof(DownloadThreads) / sizeof(*DownloadThreads); ++threads)
+    {
+        Run run;
+        double total = 0;
+
+        /* no file store, so that every copy downloads all files again */
+        configure(apr_psprintf(Global.pool, "download_threads = %d\n", DownloadThreads[threads]));
+        listDirectory("\\bench\\small");
+        runBegin(&run);
+        for (i = 0; i < Global.options.iterations; ++i)
+        {
+            const int errors = Global.errors;
+            runStart(&run);
+            FsStatusInfo("\\bench\\small\\", FS_STATUS_START, FS_STATUS_OP_GET_MULTI);
+            for (j = 0; j < Global.options.smallFiles; ++j)
+            {
+                char remoteName[MAX_PATH], localName[MAX_PATH];
+                RemoteInfoStruct ri;
+                entryName(j, entry, sizeof(entry));
+                apr_snprintf(remoteName, sizeof(remoteName), "\\bench\\small\\%s", entry);
+                apr_snprintf(localName, sizeof(localName), "%s/%s", batchDir, entry);
+                memset(&ri, 0, sizeof(ri));
+                ri.SizeLow = (DWORD) SmallFileSize;
+                ri.Attr = FILE_ATTRIBUTE_NORMAL;
+                if (FsGetFile(remoteName, localName, FS_COPYFLAGS_OVERWRITE, &ri) != FS_FILE_OK)
+                {
+                    ++Global.errors;
+                }
+            }
+            FsStatusInfo("\\bench\\small\\", FS_STATUS_END, FS_STATUS_OP_GET_MULTI);
+            runStop(&run);
+            total += run.samples[run.count - 1];
+            if (Global.errors != errors)
+            {
+                fprintf(stderr, "batch copy with %d threads failed\n", DownloadThreads[threads]);
+                exit(1);
+            }
+        }
+        apr_snprintf(name, sizeof(name), "download_threads=%d, %d files", DownloadThreads[threads], Global.options.smallFiles);
+        apr_snprintf(rate, sizeof(rate), "%.0f files/s", Global.options.smallFiles * run.count / (total / 1e6));
+        runEnd(&run, "batch", name, rate);
+    }
+    svn_error_clear(svn_io_remove_dir2(batchDir, FALSE, NULL, NULL, Global.pool));
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchEscape(void)
+{
+    enum { Calls = 1000 };
+    static const char Url[] = "https://svn.example.com/repos/project";
+    static const char * const Paths[] =
+    {
+        "Project\\trunk\\src\\module\\file.c",
+        "Project\\trunk\\docs\\R\xC3\xA4ksm\xC3\xB6rg\xC3\xA5s\\\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E.txt",
+        "Project\\branches\\feature with spaces\\a#b%c\\deeply\\nested\\path\\with\\many\\components\\file name.txt"
+    };
+    static const char * const PathNames[] = { "ascii", "utf-8", "long, encoded ascii" };
+    Locations set = { 0 };
+    char buf[LOCATION_URL_SIZE], name[64];
+    size_t p;
+
+    location_add(&set, "Project", 7, Url, sizeof(Url) - 1);
+    location_sort(&set);
+    for (p = 0; p < sizeof(Paths) / sizeof(*Paths); ++p)
+    {
+        const size_t len = strlen(Paths[p]);
+        Run run;
+        int i, j;
+
+        runBegin(&run);
+        for (i = 0; i < 10 * Global.options.iterations; ++i)
+        {
+            runStart(&run);
+            for (j = 0; j < Calls; ++j)
+            {
+                if (!location_url(&set, Paths[p], len, buf, sizeof(buf), NULL))
+                {
+                    fprintf(stderr, "location_url(%s) failed\n", Paths[p]);
+                    exit(1);
+                }
+            }
+            runStop(&run);
+        }
+        apr_snprintf(name, sizeof(name), "%s, %d calls", PathNames[p], Calls);
+        runEnd(&run, "escape", name, NULL);
+    }
+    location_clear(&set);
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchLocations(void)
+{
+    enum { Calls = 1000 };
+    const int count = Global.options.locations;
+    char name[64], subPath[MAX_PATH];
+    Locations set = { 0 };
+    Run run;
+    int i, j;
+
+    /* every write parses the whole file and merges the unchanged locations */
+    runBegin(&run);
+    Global.extraLocations = count;
+    for (i = 0; i < Global.options.iterations; ++i)
+    {
+        runStart(&run);
+        configure("");
+        runStop(&run);
+    }
+    apr_snprintf(name, sizeof(name), "reload and list, %d locations", count);
+    runEnd(&run, "locations", name, NULL);
+
+    runBegin(&run);
+    for (i = 0; i < 10 * Global.options.iterations; ++i)
+    {
+        size_t listed;
+        runStart(&run);
+        listed = listDirectory("\\");
+        runStop(&run);
+        if (listed < (size_t) count + 1)
+        {
+            fprintf(stderr, "root: %lu entries listed\n", (unsigned long) listed);
+            exit(1);
+        }
+    }
+    apr_snprintf(name, sizeof(name), "root listing, %d locations", count);
+    runEnd(&run, "locations", name, NULL);
+    Global.extraLocations = 0;
+    configure("");
+
+    /* the lookup behind every call, on a set of the same size */
+    for (i = 0; i < count; ++i)
+    {
+        const int len = apr_snprintf(name, sizeof(name), "loc%d", i);
+        location_add(&set, name, len, Global.repoUrl, strlen(Global.repoUrl));
+    }
+    location_sort(&set);
+    runBegin(&run);
+    for (i = 0; i < 10 * Global.options.iterations; ++i)
+    {
+        int len[Calls];
+        char (*paths)[64] = malloc(Calls * sizeof(*paths));
+        for (j = 0; j < Calls; ++j)
+        {
+            len[j] = apr_snprintf(paths[j], sizeof(paths[j]), "loc%u\\trunk\\src", (unsigned) (nextRandom() % count));
+        }
+        runStart(&run);
+        for (j = 0; j < Calls; ++j)
+        {
+            size_t subPathLen;
+            if (!location_resolve(&set, paths[j], len[j], subPath, sizeof(subPath), &subPathLen))
+            {
+                fprintf(stderr, "location_resolve(%s) failed\n", paths[j]);
+                exit(1);
+            }
+        }
+        runStop(&run);
+        free(paths);
+    }
+    apr_snprintf(name, sizeof(name), "location_resolve, %d locations, %d calls", count, Calls);
+    runEnd(&run, "locations", name, NULL);
+    location_clear(&set);
+}
+
+/*--------------------------------------------------------------------------*/
+static void benchGet(void)
+{
+    size_t i;
+    char path[MAX_PATH], name[64], rate[64];
+    int j;
+
+    configure("");
+    for (i = 0; i < sizeof(LargeFileMb) / sizeof(*LargeFileMb) && LargeFileMb[i] <= Global.options.largeMb; ++i)
+    {
+        const apr_int64_t size = (apr_int64_t) LargeFileMb[i] << 20;
+        Run run;
+        double total = 0;
+
+        apr_snprintf(path, sizeof(path), "\\bench\\large\\%dmb.bin", LargeFileMb[i]);
+        runBegin(&run);
+        for (j = 0; j < Global.options.iterations; ++j)
+        {
+            int result;
+            runStart(&run);
+            result = getFile(path, size);
+            runStop(&run);
+            total += run.samples[run.count - 1];
+            if (result != FS_FILE_OK)
+            {
+                fprintf(stderr, "%s: FsGetFile failed (%d)\n", path, result);
+                exit(1);
+            }
+        }
+        apr_snprintf(name, sizeof(name), "%d MB", LargeFileMb[i]);
+        apr_snprintf(rate, sizeof(rate), "%.1f MB/s", LargeFileMb[i] * run.count / (total / 1e6));
+        runEnd(&run, "get", name, rate);
+    }
+    remove(Global.downloadPath);
+}
@@ -0,0 +1,584 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+** Tests of the on-disk listing cache: listings survive a store and load
+** unchanged, and damaged or foreign cache files are rejected and removed
+** instead of being mapped. Exits with the number of failed checks.
+**
+** The damage tests rewrite header fields and entries of a stored file and
+** fix up its checksum, so that the structural checks of the loader are
+** reached. They therefore repeat the file layout of diskcache.c.
+*/
+
+#include "diskcache.h"
+#include "intern.h"
+
+#include <apr_general.h>
+#include <apr_strings.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+** Types
+*/
+
+/** Header of a cache file, as in diskcache.c. */
+typedef struct DiskHeader
+{
+    char magic[8];
+    apr_int64_t timestamp;
+    apr_uint32_t version;
+    apr_uint32_t entrySize;
+    apr_uint32_t checksum;
+    apr_uint32_t urlLen;
+    apr_uint32_t count;
+    apr_uint32_t indexSize;
+    apr_uint32_t stringsLen;
+    apr_uint32_t authorCount;
+    apr_uint32_t authorsLen;
+    apr_int32_t createdRev;
+    apr_int32_t revision;
+} DiskHeader;
+
+/** A cache file read into memory, see readFile. */
+typedef struct CacheFile
+{
+    char path[1024];
+    char *data;
+    size_t size;
+} CacheFile;
+
+/** Damages a cache file in memory. */
+typedef void (*damage_t)(CacheFile *file);
+
+/*
+** Prototypes
+*/
+
+/** Counts a failed check unless @a ok. */
+static void check(int ok, const char *what, int line);
+
+/** Builds a finished snapshot of @a count entries with varied fields. */
+static Snapshot *buildSnapshot(size_t count);
+
+/** Checks that @a loaded holds the entries buildSnapshot(@a count) made. */
+static void checkEntries(const Snapshot *loaded, size_t count, int line);
+
+/** Removes all files of the cache directory. */
+static void clearCacheDir(void);
+
+/** Reads the only cache file of the cache directory.
+    @return Non-zero on success. */
+static int readFile(CacheFile *file);
+
+/** Writes @a file back, recomputing its checksum unless @a keepChecksum. */
+static void writeFile(CacheFile *file, int keepChecksum);
+
+/** Stores a listing, damages its file and checks that loading it fails
+    and removes the file. */
+static void checkDamage(const char *what, damage_t damage, int keepChecksum, int line);
+
+/** @return The size of all files of the cache directory. */
+static apr_off_t cacheDirSize(void);
+
+/** @return The header of @a file. */
+static DiskHeader *header(CacheFile *file);
+
+/** @return The entries (0), the index (1), the strings (2) or the authors (3) of @a file. */
+static char *section(CacheFile *file, int which);
+
+/* the damages checkDamage is run with, see damage_t */
+static void damageMagic(CacheFile *file);
+static void damageVersion(CacheFile *file);
+static void damageEntrySize(CacheFile *file);
+static void damageBody(CacheFile *file);
+static void damageTruncate(CacheFile *file);
+static void damageHeaderOnly(CacheFile *file);
+static void damageShortHeader(CacheFile *file);
+static void damageCount(CacheFile *file);
+static void damageIndexSize(CacheFile *file);
+static void damageStringsLen(CacheFile *file);
+static void damageNameOffset(CacheFile *file);
+static void damageAuthor(CacheFile *file);
+static void damageIndexEntry(CacheFile *file);
+static void damageIndexFull(CacheFile *file);
+static void damageAuthorCount(CacheFile *file);
+static void damageUrl(CacheFile *file);
+
+/*
+** Globals
+*/
+static const char Url[] = "file:///repos/project/trunk";
+static const char SubPath[] = "/trunk";
+static const char * const Authors[] = { "alice", "bob", NULL };
+static const size_t EntryCount = 1000;
+
+static struct
+{
+    int failures;
+    char dir[256];
+    const struct Location *location;  /* only compared, never dereferenced */
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+int main(void)
+{
+    apr_pool_t *pool;
+    Snapshot *snapshot, *loaded;
+    size_t i;
+
+    apr_initialize();
+    apr_pool_create(&pool, NULL);
+    intern_init(pool);
+    snapcache_init(pool);
+    diskcache_init(pool);
+    Global.location = (const struct Location*) &Global;
+    apr_snprintf(Global.dir, sizeof(Global.dir), "/tmp/svn_wfx_test_diskcache.%d", (int) getpid());
+    diskcache_configure(Global.dir, 1 << 20);
+
+    /* round trip */
+    check(!diskcache_load(Global.location, SubPath, sizeof(SubPath) - 1, Url), "loading a missing file", __LINE__);
+    snapshot = buildSnapshot(EntryCount);
+    diskcache_store(snapshot, Url);
+    loaded = diskcache_load(Global.location, SubPath, sizeof(SubPath) - 1, Url);
+    check(loaded != NULL, "loading a stored listing", __LINE__);
+    if (loaded)
+    {
+        check(snapshot_finished(loaded), "loaded listing is finished", __LINE__);
+        check(loaded->location == Global.location && loaded->subPath.len == sizeof(SubPath) - 1
+              && !memcmp(loaded->subPath.data, SubPath, sizeof(SubPath) - 1), "location and sub path", __LINE__);
+        check(loaded->timestamp == snapshot->timestamp && loaded->createdRev == snapshot->createdRev
+              && loaded->revision == snapshot->revision, "timestamp and revisions", __LINE__);
+        checkEntries(loaded, EntryCount, __LINE__);
+        check(!snapshot_find(loaded, "missing"), "lookup of a missing name", __LINE__);
+        snapshot_release(loaded);
+    }
+    snapshot_release(snapshot);
+
+    /* another URL naming the same directory is a different listing */
+    check(!diskcache_load(Global.location, SubPath, sizeof(SubPath) - 1, "file:///repos/project/branch"),
+          "loading a listing of another URL", __LINE__);
+
+    /* empty directory */
+    clearCacheDir();
+    snapshot = buildSnapshot(0);
+    diskcache_store(snapshot, Url);
+    snapshot_release(snapshot);
+    loaded = diskcache_load(Global.location, SubPath, sizeof(SubPath) - 1, Url);
+    check(loaded && loaded->count == 0 && !snapshot_find(loaded, "f0"), "round trip of an empty listing", __LINE__);
+    if (loaded)
+    {
+        snapshot_release(loaded);
+    }
+
+    /* damaged files */
+    checkDamage("bad magic", &damageMagic, FALSE, __LINE__);
+    checkDamage("other version", &damageVersion, FALSE, __LINE__);
+    checkDamage("other entry size", &damageEntrySize, FALSE, __LINE__);
+    checkDamage("flipped byte", &damageBody, TRUE, __LINE__);
+    checkDamage("truncated", &damageTruncate, TRUE, __LINE__);
+    checkDamage("header only", &damageHeaderOnly, TRUE, __LINE__);
+    checkDamage("short header", &damageShortHeader, TRUE, __LINE__);
+    checkDamage("entry count beyond the file", &damageCount, FALSE, __LINE__);
+    checkDamage("index size not a power of two", &damageIndexSize, FALSE, __LINE__);
+    checkDamage("unterminated strings", &damageStringsLen, FALSE, __LINE__);
+    checkDamage("name offset beyond the strings", &damageNameOffset, FALSE, __LINE__);
+    checkDamage("author beyond the authors", &damageAuthor, FALSE, __LINE__);
+    checkDamage("index entry beyond the entries", &damageIndexEntry, FALSE, __LINE__);
+    checkDamage("index without empty slots", &damageIndexFull, FALSE, __LINE__);
+    checkDamage("author count", &damageAuthorCount, FALSE, __LINE__);
+    checkDamage("file of another URL", &damageUrl, FALSE, __LINE__);
+
+    /* size limit */
+    clearCacheDir();
+    diskcache_configure(Global.dir, 64 * 1024);
+    snapshot = buildSnapshot(100);
+    for (i = 0; i < 100; ++i)
+    {
+        char url[64];
+        apr_snprintf(url, sizeof(url), "%s/%d", Url, (int) i);
+        diskcache_store(snapshot, url);
+    }
+    snapshot_release(snapshot);
+    check(cacheDirSize() <= 64 * 1024, "size limit", __LINE__);
+    loaded = diskcache_load(Global.location, SubPath, sizeof(SubPath) - 1, "file:///repos/project/trunk/99");
+    check(loaded != NULL, "the newest file survives trimming", __LINE__);
+    if (loaded)
+    {
+        snapshot_release(loaded);
+    }
+
+    /* disabled */
+    diskcache_configure(Global.dir, 0);
+    check(!diskcache_load(Global.location, SubPath, sizeof(SubPath) - 1, "file:///repos/project/trunk/99"),
+          "loading from a disabled cache", __LINE__);
+
+    diskcache_configure(Global.dir, 1 << 20);
+    clearCacheDir();
+    rmdir(Global.dir);
+    apr_pool_destroy(pool);
+    apr_terminate();
+    if (Global.failures)
+    {
+        fprintf(stderr, "%d check(s) failed\n", Global.failures);
+    }
+    return Global.failures;
+}
+
+/*--------------------------------------------------------------------------*/
+static void check(int ok, const char *what, int line)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "line %d: %s failed\n", line, what);
+        ++Global.failures;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static Snapshot *buildSnapshot(size_t count)
+{
+    Snapshot *snapshot = snapshot_create(Global.location, SubPath, sizeof(SubPath) - 1);
+    svn_dirent_t dirent;
+    char name[32];
+    size_t i;
+
+    memset(&dirent, 0, sizeof(dirent));
+    for (i = 0; i < count; ++i)
+    {
+        dirent.kind = i % 10 ? svn_node_file : svn_node_dir;
+        dirent.size = (svn_filesize_t) i * 1000003;
+        dirent.created_rev = (svn_revnum_t) (i % 97 + 1);
+        dirent.time = (apr_time_t) i * APR_USEC_PER_SEC;
+        dirent.last_author = Authors[i % 3];
+        apr_snprintf(name, sizeof(name), "f%d", (int) i);
+        snapshot_add(snapshot, name, &dirent);
+    }
+    snapshot_finish(snapshot);
+    snapshot->timestamp = 1234567890123456LL;
+    snapshot->createdRev = 42;
+    snapshot_confirm(snapshot, 4711);
+    return snapshot;
+}
+
+/*--------------------------------------------------------------------------*/
+static void checkEntries(const Snapshot *loaded, size_t count, int line)
+{
+    char name[32];
+    size_t i;
+
+    check(loaded->count == count, "entry count", line);
+    for (i = 0; i < count; ++i)
+    {
+        const SVNObject *obj;
+        const char *author;
+        apr_snprintf(name, sizeof(name), "f%d", (int) i);
+        obj = snapshot_find(loaded, name);
+        if (!obj)
+        {
+            check(FALSE, name, line);
+            continue;
+        }
+        author = snapshot_author(loaded, obj);
+        if (obj->kind != (apr_uint32_t) (i % 10 ? svn_node_file : svn_node_dir)
+            || obj->size != (apr_int64_t) i * 1000003 || obj->createdRev != (apr_int32_t) (i % 97 + 1)
+            || obj->time != (apr_int64_t) i * APR_USEC_PER_SEC || strcmp(snapshot_name(loaded, obj), name)
+            || (Authors[i % 3] ? !author || strcmp(author, Authors[i % 3]) : author != NULL))
+        {
+            check(FALSE, name, line);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void clearCacheDir(void)
+{
+    DIR *dir = opendir(Global.dir);
+    struct dirent *entry;
+    char path[1024];
+
+    if (dir)
+    {
+        while ((entry = readdir(dir)))
+        {
+            if (entry->d_name[0] != '.')
+            {
+                apr_snprintf(path, sizeof(path), "%s/%s", Global.dir, entry->d_name);
+                unlink(path);
+            }
+        }
+        closedir(dir);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static int readFile(CacheFile *file)
+{
+    DIR *dir = opendir(Global.dir);
+    struct dirent *entry;
+    FILE *f;
+    int found = 0;
+
+    if (!dir)
+    {
+        return FALSE;
+    }
+    while ((entry = readdir(dir)))
+    {
+        const size_t len = strlen(entry->d_name);
+        if (len > 5 && !strcmp(entry->d_name + len - 5, ".snap"))
+        {
+            apr_snprintf(file->path, sizeof(file->path), "%s/%s", Global.dir, entry->d_name);
+            ++found;
+        }
+    }
+    closedir(dir);
+    if (found != 1 || !(f = fopen(file->path, "rb")))
+    {
+        return FALSE;
+    }
+    fseek(f, 0, SEEK_END);
+    file->size = (size_t) ftell(f);
+    fseek(f, 0, SEEK_SET);
+    file->data = malloc(file->size + 1);
+    found = fread(file->data, 1, file->size, f) == file->size;
+    fclose(f);
+    return found;
+}
+
+/*--------------------------------------------------------------------------*/
+static void writeFile(CacheFile *file, int keepChecksum)
+{
+    FILE *f = fopen(file->path, "wb");
+    if (!keepChecksum && file->size >= sizeof(DiskHeader))
+    {
+        /* FNV-1a of everything following the header */
+        DiskHeader *header = (DiskHeader*) file->data;
+        const unsigned char *p = (const unsigned char*) file->data + sizeof(DiskHeader);
+        const unsigned char *end = (const unsigned char*) file->data + file->size;
+        apr_uint32_t hash = 2166136261u;
+        while (p < end)
+        {
+            hash ^= *p++;
+            hash *= 16777619u;
+        }
+        header->checksum = hash;
+    }
+    if (f)
+    {
+        fwrite(file->data, 1, file->size, f);
+        fclose(f);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void checkDamage(const char *what, damage_t damage, int keepChecksum, int line)
+{
+    Snapshot *snapshot, *loaded;
+    CacheFile file;
+
+    clearCacheDir();
+    snapshot = buildSnapshot(EntryCount);
+    diskcache_store(snapshot, Url);
+    snapshot_release(snapshot);
+    if (!readFile(&file))
+    {
+        check(FALSE, what, line);
+        return;
+    }
+    damage(&file);
+    writeFile(&file, keepChecksum);
+    free(file.data);
+
+    loaded = diskcache_load(Global.location, SubPath, sizeof(SubPath) - 1, Url);
+    check(!loaded, what, line);
+    if (loaded)
+    {
+        snapshot_release(loaded);
+    }
+    else
+    {
+        check(access(file.path, F_OK) != 0, "removal of the damaged file", line);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static apr_off_t cacheDirSize(void)
+{
+    DIR *dir = opendir(Global.dir);
+    struct dirent *entry;
+    struct stat st;
+    char path[1024];
+    apr_off_t size = 0;
+
+    if (dir)
+    {
+        while ((entry = readdir(dir)))
+        {
+            apr_snprintf(path, sizeof(path), "%s/%s", Global.dir, entry->d_name);
+            if (entry->d_name[0] != '.' && !stat(path, &st))
+            {
+                size += st.st_size;
+            }
+        }
+        closedir(dir);
+    }
+    return size;
+}
+
+/*--------------------------------------------------------------------------*/
+static DiskHeader *header(CacheFile *file)
+{
+    return (DiskHeader*) file->data;
+}
+
+/*--------------------------------------------------------------------------*/
+static char *section(CacheFile *file, int which)
+{
+    const DiskHeader *h = header(file);
+    char *p = file->data + sizeof(DiskHeader) + ((h->urlLen + 8) & ~7);
+    if (which > 0)
+    {
+        p += h->count * sizeof(SVNObject);
+    }
+    if (which > 1)
+    {
+        p += h->indexSize * sizeof(apr_uint32_t);
+    }
+    if (which > 2)
+    {
+        p += h->stringsLen;
+    }
+    return p;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageMagic(CacheFile *file)
+{
+    file->data[0] ^= 0x20;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageVersion(CacheFile *file)
+{
+    ++header(file)->version;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageEntrySize(CacheFile *file)
+{
+    header(file)->entrySize += 8;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageBody(CacheFile *file)
+{
+    file->data[file->size / 2] ^= 0x01;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageTruncate(CacheFile *file)
+{
+    file->size /= 2;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageHeaderOnly(CacheFile *file)
+{
+    file->size = sizeof(DiskHeader);
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageShortHeader(CacheFile *file)
+{
+    file->size = sizeof(DiskHeader) - 1;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageCount(CacheFile *file)
+{
+    header(file)->count = 0x7FFFFFFF;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageIndexSize(CacheFile *file)
+{
+    --header(file)->indexSize;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageStringsLen(CacheFile *file)
+{
+    /* the strings section would end inside the last name */
+    --header(file)->stringsLen;
+    ++header(file)->authorsLen;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageNameOffset(CacheFile *file)
+{
+    SVNObject *entries = (SVNObject*) section(file, 0);
+    entries[EntryCount / 2].nameOffset = header(file)->stringsLen;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageAuthor(CacheFile *file)
+{
+    SVNObject *entries = (SVNObject*) section(file, 0);
+    entries[1].author = header(file)->authorCount;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageIndexEntry(CacheFile *file)
+{
+    apr_uint32_t *index = (apr_uint32_t*) section(file, 1);
+    apr_uint32_t i;
+    for (i = 0; index[i]; ++i);
+    index[i] = header(file)->count + 1;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageIndexFull(CacheFile *file)
+{
+    /* lookups of missing names would never end */
+    apr_uint32_t *index = (apr_uint32_t*) section(file, 1);
+    apr_uint32_t i;
+    for (i = 0; i < header(file)->indexSize; ++i)
+    {
+        index[i] = 1;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageAuthorCount(CacheFile *file)
+{
+    ++header(file)->authorCount;
+}
+
+/*--------------------------------------------------------------------------*/
+static void damageUrl(CacheFile *file)
+{
+    /* another directory whose URL hashes to the same file name */
+    file->data[sizeof(DiskHeader) + header(file)->urlLen - 1] ^= 0x01;
+}
@@ -0,0 +1,142 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+** Tests of the translation of TC paths into escaped URLs, see location_url.
+** Exits with the number of failed checks.
+*/
+
+#include "location.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+** Prototypes
+*/
+
+/** Checks that location_url translates @a remoteName into @a expected. */
+static void checkUrl(const Locations *set, const char *remoteName, const char *expected, int line);
+
+/** Checks that location_escape encodes @a str as @a expected. */
+static void checkEscape(const char *str, const char *expected, int line);
+
+/** Counts a failed check unless @a ok. */
+static void check(int ok, const char *what, int line);
+
+/*
+** Globals
+*/
+static int Failures = 0;
+
+/*--------------------------------------------------------------------------*/
+int main(void)
+{
+    static const char AsciiUrl[] = "svn://host/repo";
+    static const char Utf8Url[]  = "http://h\xC3\xB6st/r\xC3\xA9po dir";
+    Locations set = { 0 };
+    const Location *loc = NULL;
+    char buf[LOCATION_URL_SIZE], small[19], subPath[256];
+    size_t len;
+
+    location_add(&set, "Repo", 4, AsciiUrl, sizeof(AsciiUrl) - 1);
+    location_add(&set, "Repository", 10, AsciiUrl, sizeof(AsciiUrl) - 1);
+    location_add(&set, "\xC3\x9C" "ber", 5, Utf8Url, sizeof(Utf8Url) - 1);
+    location_sort(&set);
+
+    /* separators, trailing separators, literal and encoded ASCII */
+    checkUrl(&set, "Repo", "svn://host/repo", __LINE__);
+    checkUrl(&set, "Repo\\", "svn://host/repo", __LINE__);
+    checkUrl(&set, "Repo\\trunk\\src\\\\", "svn://host/repo/trunk/src", __LINE__);
+    checkUrl(&set, "Repo\\a b\\c#d%e", "svn://host/repo/a%20b/c%23d%25e", __LINE__);
+    checkUrl(&set, "Repo\\x;y=z&(1)!~'*,+$@:", "svn://host/repo/x%3By=z&(1)!~'*,+$@:", __LINE__);
+
+    /* two-, three- and four-byte UTF-8 sequences, byte by byte in upper case hex */
+    checkUrl(&set, "Repo\\R\xC3\xA4ksm\xC3\xB6rg\xC3\xA5s", "svn://host/repo/R%C3%A4ksm%C3%B6rg%C3%A5s", __LINE__);
+    checkUrl(&set, "Repo\\\xE6\x97\xA5\xE6\x9C\xAC\\\xE8\xAA\x9E", "svn://host/repo/%E6%97%A5%E6%9C%AC/%E8%AA%9E", __LINE__);
+    checkUrl(&set, "Repo\\\xF0\x9F\x98\x80.txt", "svn://host/repo/%F0%9F%98%80.txt", __LINE__);
+
+    /* UTF-8 in titles and location URLs; the URL's own separators stay */
+    checkUrl(&set, "\xC3\x9C" "ber\\d\xC3\xA9j\xC3\xA0", "http://h%C3%B6st/r%C3%A9po%20dir/d%C3%A9j%C3%A0", __LINE__);
+    len = location_url(&set, "\xC3\x9C" "ber", 5, buf, sizeof(buf), &loc);
+    check(len && loc && loc->title.len == 5, "location of an UTF-8 title", __LINE__);
+
+    /* exact title match, not prefix match */
+    loc = NULL;
+    location_url(&set, "Repository\\x", 12, buf, sizeof(buf), &loc);
+    check(loc && loc->title.len == 10, "Repository is not matched as Repo", __LINE__);
+    check(!location_url(&set, "Rep\\x", 5, buf, sizeof(buf), NULL), "Rep matches nothing", __LINE__);
+    check(!location_url(&set, "\xC3\x9C", 2, buf, sizeof(buf), NULL), "partial UTF-8 title matches nothing", __LINE__);
+
+    /* truncation never splits an escape sequence and still reports the full length */
+    len = location_url(&set, "Repo\\\xC3\xA4", 7, small, sizeof(small), NULL);
+    check(len == strlen("svn://host/repo/%C3%A4"), "length of a truncated URL", __LINE__);
+    check(!strcmp(small, "svn://host/repo/"), "truncated URL", __LINE__);
+    len = location_url(&set, "Repo\\\xC3\xA4", 7, small, 1, NULL);
+    check(len == strlen("svn://host/repo/%C3%A4") && !*small, "URL in a one byte buffer", __LINE__);
+
+    /* location_escape encodes backslashes instead of turning them into separators */
+    checkEscape("a\\b c", "a%5Cb%20c", __LINE__);
+    checkEscape("\xC3\xA9t\xC3\xA9", "%C3%A9t%C3%A9", __LINE__);
+    checkEscape("", "", __LINE__);
+
+    /* resolved sub paths keep their UTF-8 names unescaped */
+    loc = location_resolve(&set, "Repo\\d\xC3\xA9j\xC3\xA0\\", 12, subPath, sizeof(subPath), &len);
+    check(loc && !strcmp(subPath, "/d\xC3\xA9j\xC3\xA0") && len == 7, "resolved UTF-8 sub path", __LINE__);
+
+    location_clear(&set);
+    if (Failures)
+    {
+        fprintf(stderr, "%d check(s) failed\n", Failures);
+    }
+    return Failures;
+}
+
+/*--------------------------------------------------------------------------*/
+static void checkUrl(const Locations *set, const char *remoteName, const char *expected, int line)
+{
+    char buf[LOCATION_URL_SIZE];
+    const size_t len = location_url(set, remoteName, strlen(remoteName), buf, sizeof(buf), NULL);
+    if (len != strlen(expected) || strcmp(buf, expected))
+    {
+        fprintf(stderr, "line %d: \"%s\" -> \"%s\", expected \"%s\"\n", line, remoteName, len ? buf : "", expected);
+        ++Failures;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void checkEscape(const char *str, const char *expected, int line)
+{
+    char buf[256];
+    const size_t len = location_escape(str, strlen(str), buf, sizeof(buf));
+    if (len != strlen(expected) || strcmp(buf, expected))
+    {
+        fprintf(stderr, "line %d: \"%s\" -> \"%s\", expected \"%s\"\n", line, str, buf, expected);
+        ++Failures;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void check(int ok, const char *what, int line)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "line %d: %s failed\n", line, what);
+        ++Failures;
+    }
+}
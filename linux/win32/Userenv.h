@@ -0,0 +1,25 @@
+#ifndef SVN_WFX_LINUX_USERENV_H_INCLUDED
+#define SVN_WFX_LINUX_USERENV_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* svn_wfx.c uses nothing of the user profile API beyond windows.h, see there */
+#include <windows.h>
+
+#endif /* !SVN_WFX_LINUX_USERENV_H_INCLUDED */
@@ -0,0 +1,385 @@
+#ifndef SVN_WFX_LINUX_WINDOWS_H_INCLUDED
+#define SVN_WFX_LINUX_WINDOWS_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+** The parts of the Win32 API the plugin uses, mapped onto POSIX so that
+** svn_wfx.c builds on Linux for the benchmark driver, see bench.c. Handles
+** are file descriptors plus one, so that NULL and INVALID_HANDLE_VALUE stay
+** distinct from every descriptor. There is no registry, no change
+** notification and no process creation: TortoiseSVN is never found, the
+** configuration file is checked on every listing and "Edit Locations"
+** reports that the editor could not be started.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define __stdcall
+#define APIENTRY
+#define WINAPI
+#define __inline inline
+#define _snprintf snprintf
+#define stricmp strcasecmp
+#define strnicmp strncasecmp
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+/* Subversion keeps no credentials in the Windows store elsewhere */
+#define svn_auth_get_windows_simple_provider svn_auth_get_simple_provider
+
+#define MAX_PATH 260
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/*
+** Types
+*/
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef int64_t LONGLONG;
+typedef unsigned int UINT;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+typedef void *LPVOID;
+typedef void *HANDLE;
+typedef void *HWND;
+typedef void *HICON;
+typedef void *HINSTANCE;
+typedef void *HMODULE;
+typedef void *HKEY;
+
+typedef struct
+{
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME;
+
+typedef struct
+{
+    DWORD dwFileAttributes;
+    FILETIME ftCreationTime;
+    FILETIME ftLastAccessTime;
+    FILETIME ftLastWriteTime;
+    DWORD nFileSizeHigh;
+    DWORD nFileSizeLow;
+    DWORD dwReserved0;
+    DWORD dwReserved1;
+    char cFileName[MAX_PATH];
+    char cAlternateFileName[14];
+} WIN32_FIND_DATA;
+
+typedef struct
+{
+    DWORD dwFileAttributes;
+    FILETIME ftCreationTime;
+    FILETIME ftLastAccessTime;
+    FILETIME ftLastWriteTime;
+    DWORD nFileSizeHigh;
+    DWORD nFileSizeLow;
+} WIN32_FILE_ATTRIBUTE_DATA;
+
+typedef enum
+{
+    GetFileExInfoStandard
+} GET_FILEEX_INFO_LEVELS;
+
+typedef struct
+{
+    DWORD cb;
+    DWORD dwFlags;
+    WORD wShowWindow;
+} STARTUPINFO;
+
+typedef struct
+{
+    HANDLE hProcess;
+    HANDLE hThread;
+    DWORD dwProcessId;
+    DWORD dwThreadId;
+} PROCESS_INFORMATION;
+
+/*
+** Constants
+*/
+#define INVALID_HANDLE_VALUE ((HANDLE) (intptr_t) -1)
+
+#define FILE_ATTRIBUTE_READONLY      0x00000001
+#define FILE_ATTRIBUTE_DIRECTORY     0x00000010
+#define FILE_ATTRIBUTE_NORMAL        0x00000080
+#define FILE_ATTRIBUTE_UNIX_MODE     0x80000000
+
+#define GENERIC_READ                 0x80000000
+#define GENERIC_WRITE                0x40000000
+#define OPEN_EXISTING                3
+
+#define FILE_NOTIFY_CHANGE_FILE_NAME  0x00000001
+#define FILE_NOTIFY_CHANGE_LAST_WRITE 0x00000010
+
+#define CREATE_NO_WINDOW             0x08000000
+#define DETACHED_PROCESS             0x00000008
+#define INFINITE                     0xFFFFFFFF
+#define WAIT_OBJECT_0                0
+#define WAIT_TIMEOUT                 258
+
+#define ERROR_SUCCESS                0
+#define ERROR_FILE_NOT_FOUND         2
+#define ERROR_PATH_NOT_FOUND         3
+#define ERROR_NO_MORE_FILES          18
+
+#define MB_OK                        0x00000000
+#define MB_ICONERROR                 0x00000010
+#define MB_ICONINFORMATION           0x00000040
+#define IDOK                         1
+
+#define SW_MAXIMIZE                  3
+#define SW_RESTORE                   9
+
+#define KEY_READ                     0x20019
+#define HKEY_LOCAL_MACHINE           ((HKEY) (intptr_t) 0x80000002)
+
+#define DLL_PROCESS_ATTACH           1
+
+#define MAKEINTRESOURCE(i) ((LPSTR) (uintptr_t) (WORD) (i))
+
+/* 100ns intervals between 1601-01-01 and 1970-01-01 */
+#define SHIM_FILETIME_UNIX_EPOCH 116444736000000000ULL
+
+/*
+** Functions
+*/
+static inline void SetLastError(DWORD error)
+{
+    errno = (int) error;
+}
+
+static inline DWORD GetLastError(void)
+{
+    return (DWORD) errno;
+}
+
+static inline int MessageBox(HWND wnd, LPCSTR text, LPCSTR caption, UINT type)
+{
+    (void) wnd;
+    (void) type;
+    fprintf(stderr, "%s: %s\n", caption ? caption : "Error", text);
+    return IDOK;
+}
+
+static inline HICON LoadIcon(HINSTANCE instance, LPCSTR name)
+{
+    (void) instance;
+    (void) name;
+    return NULL;
+}
+
+static inline HANDLE CreateFile(LPCSTR name, DWORD access, DWORD share, void *security, DWORD disposition, DWORD flags, HANDLE templ)
+{
+    const int mode = (access & GENERIC_WRITE) ? ((access & GENERIC_READ) ? O_RDWR : O_WRONLY) : O_RDONLY;
+    const int fd = open(name, mode);
+    (void) share;
+    (void) security;
+    (void) disposition;
+    (void) flags;
+    (void) templ;
+    return fd < 0 ? INVALID_HANDLE_VALUE : (HANDLE) (intptr_t) (fd + 1);
+}
+
+static inline BOOL CloseHandle(HANDLE handle)
+{
+    if (!handle || handle == INVALID_HANDLE_VALUE)
+    {
+        SetLastError(EBADF);
+        return FALSE;
+    }
+    return !close((int) (intptr_t) handle - 1);
+}
+
+static inline DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+    (void) handle;
+    (void) milliseconds;
+    return WAIT_TIMEOUT;
+}
+
+static inline HANDLE FindFirstChangeNotification(LPCSTR dir, BOOL subtree, DWORD filter)
+{
+    (void) dir;
+    (void) subtree;
+    (void) filter;
+    return INVALID_HANDLE_VALUE;
+}
+
+static inline BOOL FindNextChangeNotification(HANDLE handle)
+{
+    (void) handle;
+    return FALSE;
+}
+
+static inline BOOL FindCloseChangeNotification(HANDLE handle)
+{
+    (void) handle;
+    return TRUE;
+}
+
+static inline void GetStartupInfo(STARTUPINFO *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->cb = sizeof(*info);
+}
+
+static inline BOOL CreateProcess(LPCSTR app, LPSTR cmdLine, void *processSecurity, void *threadSecurity, BOOL inherit,
+                                 DWORD flags, void *env, LPCSTR dir, STARTUPINFO *startup, PROCESS_INFORMATION *info)
+{
+    (void) app;
+    (void) cmdLine;
+    (void) processSecurity;
+    (void) threadSecurity;
+    (void) inherit;
+    (void) flags;
+    (void) env;
+    (void) dir;
+    (void) startup;
+    info->hProcess = info->hThread = NULL;
+    info->dwProcessId = info->dwThreadId = 0;
+    SetLastError(ENOSYS);
+    return FALSE;
+}
+
+static inline DWORD GetEnvironmentVariable(LPCSTR name, LPSTR buf, DWORD size)
+{
+    const char *value = getenv(name);
+    size_t len;
+    if (!value)
+    {
+        SetLastError(ENOENT);
+        return 0;
+    }
+    len = strlen(value);
+    if (len >= size)
+    {
+        return (DWORD) len + 1;
+    }
+    memcpy(buf, value, len + 1);
+    return (DWORD) len;
+}
+
+static inline BOOL GetUserName(LPSTR buf, DWORD *size)
+{
+    const char *user = getenv("USER");
+    const size_t len = user ? strlen(user) : 0;
+    if (!user || len >= *size)
+    {
+        SetLastError(user ? ERANGE : ENOENT);
+        return FALSE;
+    }
+    memcpy(buf, user, len + 1);
+    *size = (DWORD) len + 1;
+    return TRUE;
+}
+
+static inline LONG RegOpenKeyEx(HKEY key, LPCSTR subKey, DWORD options, DWORD access, HKEY *result)
+{
+    (void) key;
+    (void) subKey;
+    (void) options;
+    (void) access;
+    *result = NULL;
+    return ERROR_FILE_NOT_FOUND;
+}
+
+static inline LONG RegQueryValueEx(HKEY key, LPCSTR name, DWORD *reserved, DWORD *type, void *data, DWORD *size)
+{
+    (void) key;
+    (void) name;
+    (void) reserved;
+    (void) type;
+    (void) data;
+    (void) size;
+    return ERROR_FILE_NOT_FOUND;
+}
+
+static inline LONG RegCloseKey(HKEY key)
+{
+    (void) key;
+    return ERROR_SUCCESS;
+}
+
+static inline void shimFileTime(FILETIME *ft, time_t sec, long nsec)
+{
+    const uint64_t t = SHIM_FILETIME_UNIX_EPOCH + (uint64_t) sec * 10000000 + (uint64_t) nsec / 100;
+    ft->dwLowDateTime  = (DWORD) t;
+    ft->dwHighDateTime = (DWORD) (t >> 32);
+}
+
+static inline void GetSystemTimeAsFileTime(FILETIME *ft)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    shimFileTime(ft, tv.tv_sec, tv.tv_usec * 1000L);
+}
+
+static inline LONG CompareFileTime(const FILETIME *a, const FILETIME *b)
+{
+    const uint64_t x = ((uint64_t) a->dwHighDateTime << 32) | a->dwLowDateTime;
+    const uint64_t y = ((uint64_t) b->dwHighDateTime << 32) | b->dwLowDateTime;
+    return x < y ? -1 : x > y;
+}
+
+static inline BOOL GetFileAttributesEx(LPCSTR name, GET_FILEEX_INFO_LEVELS level, void *info)
+{
+    WIN32_FILE_ATTRIBUTE_DATA *data = info;
+    struct stat st;
+    (void) level;
+    if (stat(name, &st))
+    {
+        return FALSE;
+    }
+    memset(data, 0, sizeof(*data));
+    data->dwFileAttributes = S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+    shimFileTime(&data->ftCreationTime, st.st_ctim.tv_sec, st.st_ctim.tv_nsec);
+    shimFileTime(&data->ftLastAccessTime, st.st_atim.tv_sec, st.st_atim.tv_nsec);
+    shimFileTime(&data->ftLastWriteTime, st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    data->nFileSizeHigh = (DWORD) ((uint64_t) st.st_size >> 32);
+    data->nFileSizeLow  = (DWORD) st.st_size;
+    return TRUE;
+}
+
+#endif /* !SVN_WFX_LINUX_WINDOWS_H_INCLUDED */
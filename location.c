@@ -0,0 +1,380 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "location.h"
+
+#include <apr_strings.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+** Prototypes
+*/
+
+/** Replaces all backslashes in the zero-terminated @a str by slashes. */
+static void slashify(char *str);
+
+/** Appends the percent-encoded @a str to the URL in @a buf.
+    @param str The string. Need not be zero-terminated.
+    @param len The length of @a str.
+    @param buf The URL buffer. Receives a zero-terminated prefix of the result
+               if the result does not fit.
+    @param bufSize The size of @a buf, zero to just count.
+    @param pos The length of the URL so far, less than @a bufSize unless that is zero.
+    @param separators Non-zero to turn backslashes into slashes instead of encoding them.
+    @return The length of the complete URL, @a bufSize or more if it was truncated. */
+static size_t escape(const char *str, size_t len, char *buf, size_t bufSize, size_t pos, int separators);
+
+/** @return The slot of the location titled @a title in the hash table of
+    @a set, or the empty slot where it belongs. */
+static Location **findSlot(const Locations *set, const char *title, size_t titleLen);
+
+/** Doubles the hash table of @a set and the capacity of its sorted array. */
+static void growTable(Locations *set);
+
+/** qsort comparison of Location pointers by title. */
+static int compareTitles(const void *a, const void *b);
+
+
+/*
+** Globals
+*/
+
+/** Bytes of a TC path by how they appear in an URL: 0 literally, 1 percent-encoded,
+    3 as a separator ('\\'), which is encoded, too, outside of paths. Everything
+    beyond ASCII is encoded, so UTF-8 names arrive as Subversion encodes them. */
+static const unsigned char UriEscape[256] =
+{
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* 00 */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* 10 */
+    1, 0, 1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 20 */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 1,  /* 30 */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 40 */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 3, 1, 1, 0,  /* 50 */
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 60 */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 0, 1,  /* 70 */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* 80 */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* 90 */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* A0 */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* B0 */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* C0 */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* D0 */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* E0 */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1   /* F0 */
+};
+
+/*--------------------------------------------------------------------------*/
+Location *location_add(Locations *set, const char *title, size_t titleLen, const char *url, size_t urlLen)
+{
+    Location *loc = malloc(sizeof(*loc)), **slot;
+    size_t pegLen = urlLen;
+
+    /* a trailing "@N" or "@rN" is a peg revision */
+    while (pegLen && isdigit((unsigned char) url[pegLen - 1])) --pegLen;
+    if (pegLen < urlLen && pegLen && (url[pegLen - 1] == 'r' || url[pegLen - 1] == 'R'))
+    {
+        --pegLen;
+    }
+    if (pegLen < urlLen && pegLen && url[pegLen - 1] == '@')
+    {
+        loc->revision = atol(url + pegLen + (url[pegLen] == 'r' || url[pegLen] == 'R'));
+        urlLen = pegLen - 1;
+    }
+    else
+    {
+        loc->revision = SVN_INVALID_REVNUM;
+    }
+
+    loc->title.data = malloc(titleLen + 1);
+    memcpy(loc->title.data, title, titleLen);
+    loc->title.data[titleLen] = '\0';
+    loc->title.len = titleLen;
+    loc->url.data = malloc(urlLen + 1);
+    memcpy(loc->url.data, url, urlLen);
+    loc->url.data[urlLen] = '\0';
+    loc->url.len = urlLen;
+    if (SVN_IS_VALID_REVNUM(loc->revision))
+    {
+        char peg[16];
+        const int pegLen = apr_snprintf(peg, sizeof(peg), "@%ld", loc->revision);
+        loc->key.len = urlLen + pegLen;
+        loc->key.data = malloc(loc->key.len + 1);
+        memcpy(loc->key.data, url, urlLen);
+        memcpy(loc->key.data + urlLen, peg, pegLen + 1);
+    }
+    else
+    {
+        loc->key = loc->url;
+    }
+    loc->indexScheduled = 0;
+    loc->stats = calloc(1, sizeof(*loc->stats));
+
+    if ((set->count + 1) * 2 > (set->table ? set->tableMask + 1 : 0))
+    {
+        growTable(set);
+    }
+    slot = findSlot(set, title, titleLen);
+    if (*slot)
+    {
+        /* a later definition of the same title wins */
+        size_t i;
+        for (i = 0; set->sorted[i] != *slot; ++i);
+        set->sorted[i] = loc;
+        location_free(*slot);
+    }
+    else
+    {
+        set->sorted[set->count++] = loc;
+    }
+    *slot = loc;
+    return loc;
+}
+
+/*--------------------------------------------------------------------------*/
+void location_sort(Locations *set)
+{
+    if (set->count)
+    {
+        qsort(set->sorted, set->count, sizeof(*set->sorted), &compareTitles);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+void location_clear(Locations *set)
+{
+    size_t i;
+    for (i = 0; i < set->count; ++i)
+    {
+        location_free(set->sorted[i]);
+    }
+    free(set->sorted);
+    free(set->table);
+    memset(set, 0, sizeof(*set));
+}
+
+/*--------------------------------------------------------------------------*/
+Location **location_merge(Locations *fresh, Locations *old, size_t *staleCount)
+{
+    Location **stale = malloc((old->count + 1) * sizeof(*stale));
+    size_t i, j = 0, n = 0;
+
+    /* walk both sorted arrays side by side */
+    for (i = 0; i < old->count; ++i)
+    {
+        Location *loc = old->sorted[i];
+        int order = 1;
+        while (j < fresh->count && (order = strcmp(fresh->sorted[j]->title.data, loc->title.data)) < 0)
+        {
+            /* added */
+            ++j;
+        }
+        if (!order && fresh->sorted[j]->key.len == loc->key.len && !memcmp(fresh->sorted[j]->key.data, loc->key.data, loc->key.len))
+        {
+            /* unchanged */
+            Location **slot = findSlot(fresh, loc->title.data, loc->title.len);
+            location_free(*slot);
+            *slot = fresh->sorted[j] = loc;
+        }
+        else
+        {
+            stale[n++] = loc;
+        }
+    }
+    free(old->sorted);
+    free(old->table);
+    memset(old, 0, sizeof(*old));
+    *staleCount = n;
+    return stale;
+}
+
+/*--------------------------------------------------------------------------*/
+void location_free(Location *loc)
+{
+    if (loc->key.data != loc->url.data)
+    {
+        free(loc->key.data);
+    }
+    free(loc->title.data);
+    free(loc->url.data);
+    free(loc->stats);
+    free(loc);
+}
+
+/*--------------------------------------------------------------------------*/
+const Location *location_find(const Locations *set, const char *title, size_t titleLen)
+{
+    return set->table ? *findSlot(set, title, titleLen) : NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+const Location *location_resolve(const Locations *set, const char *path, size_t pathLen, char *subPath, size_t subPathSize, size_t *subPathLen)
+{
+    const char *separator = memchr(path, '\\', pathLen);
+    const size_t titleLen = separator ? (size_t) (separator - path) : pathLen;
+    const Location *loc = location_find(set, path, titleLen);
+    if (loc)
+    {
+        strbuf_t s = { subPath, subPathSize };
+        strbuf_cat(&s, path + titleLen, pathLen - titleLen);
+        slashify(subPath);
+        /* trim trailing slashes, SVN doesn't like those */
+        while (s.data > subPath && s.data[-1] == '/')
+        {
+            *(--s.data) = '\0';
+        }
+        *subPathLen = s.data - subPath;
+    }
+    return loc;
+}
+
+/*--------------------------------------------------------------------------*/
+size_t location_url(const Locations *set, const char *remoteName, size_t remoteNameLen, char *buf, size_t bufSize, const Location **location)
+{
+    const char *separator = memchr(remoteName, '\\', remoteNameLen);
+    const size_t titleLen = separator ? (size_t) (separator - remoteName) : remoteNameLen;
+    const Location *loc = location_find(set, remoteName, titleLen);
+    if (!loc)
+    {
+        return 0;
+    }
+    if (location)
+    {
+        *location = loc;
+    }
+    return location_node_url(loc, remoteName + titleLen, remoteNameLen - titleLen, buf, bufSize);
+}
+
+/*--------------------------------------------------------------------------*/
+size_t location_node_url(const Location *loc, const char *subPath, size_t subPathLen, char *buf, size_t bufSize)
+{
+    size_t len;
+
+    /* trailing separators name the same node, SVN doesn't like them */
+    while (subPathLen && (subPath[subPathLen - 1] == '\\' || subPath[subPathLen - 1] == '/'))
+    {
+        --subPathLen;
+    }
+    len = escape(loc->url.data, loc->url.len, buf, bufSize, 0, FALSE);
+    if (len >= bufSize)
+    {
+        /* just count */
+        return escape(subPath, subPathLen, NULL, 0, len, TRUE);
+    }
+    return escape(subPath, subPathLen, buf, bufSize, len, TRUE);
+}
+
+/*--------------------------------------------------------------------------*/
+size_t location_escape(const char *str, size_t len, char *buf, size_t bufSize)
+{
+    return escape(str, len, buf, bufSize, 0, FALSE);
+}
+
+/*--------------------------------------------------------------------------*/
+static size_t escape(const char *str, size_t len, char *buf, size_t bufSize, size_t pos, int separators)
+{
+    static const char Hex[] = "0123456789ABCDEF";
+    const unsigned char *s = (const unsigned char*) str, *end = s + len;
+    size_t written = pos;   /* falls behind pos once something did not fit */
+
+    for (; s < end; ++s)
+    {
+        const unsigned char c = *s;
+        const unsigned char action = UriEscape[c] & (separators ? 3 : 1);
+        const size_t n = action == 1 ? 3 : 1;
+        if (written == pos && pos + n < bufSize)
+        {
+            if (!action)
+            {
+                buf[pos] = c;
+            }
+            else if (action == 1)
+            {
+                buf[pos]     = '%';
+                buf[pos + 1] = Hex[c >> 4];
+                buf[pos + 2] = Hex[c & 0xF];
+            }
+            else
+            {
+                buf[pos] = '/';
+            }
+            written += n;
+        }
+        pos += n;
+    }
+    if (bufSize)
+    {
+        buf[written] = '\0';
+    }
+    return pos;
+}
+
+/*--------------------------------------------------------------------------*/
+static Location **findSlot(const Locations *set, const char *title, size_t titleLen)
+{
+    const unsigned char *s = (const unsigned char*) title, *end = s + titleLen;
+    size_t hash = 2166136261u, i;
+
+    /* FNV-1a */
+    for (; s < end; ++s)
+    {
+        hash = (hash ^ *s) * 16777619u;
+    }
+    for (i = hash & set->tableMask; set->table[i]; i = (i + 1) & set->tableMask)
+    {
+        const Location *loc = set->table[i];
+        if (loc->title.len == titleLen && !memcmp(loc->title.data, title, titleLen))
+        {
+            break;
+        }
+    }
+    return set->table + i;
+}
+
+/*--------------------------------------------------------------------------*/
+static void growTable(Locations *set)
+{
+    const size_t size = set->table ? (set->tableMask + 1) * 2 : 64;
+    size_t i;
+
+    /* the sorted array never needs more than half the table */
+    set->sorted = realloc(set->sorted, size / 2 * sizeof(*set->sorted));
+    free(set->table);
+    set->table = calloc(size, sizeof(*set->table));
+    set->tableMask = size - 1;
+    for (i = 0; i < set->count; ++i)
+    {
+        *findSlot(set, set->sorted[i]->title.data, set->sorted[i]->title.len) = set->sorted[i];
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static int compareTitles(const void *a, const void *b)
+{
+    return strcmp((*(Location* const*) a)->title.data, (*(Location* const*) b)->title.data);
+}
+
+/*--------------------------------------------------------------------------*/
+static void slashify(char *str)
+{
+    for (; *str; ++str)
+    {
+        if (*str == '\\') *str = '/';
+    }
+}
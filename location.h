@@ -0,0 +1,139 @@
+#ifndef SVN_WFX_LOCATION_H_INCLUDED
+#define SVN_WFX_LOCATION_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "strbuf.h"
+#include "stats.h"
+
+#include <svn_types.h>
+
+/** Size of a buffer that holds the URL of any path of up to 1024 characters
+    below any location the configuration file can define, see location_url. */
+#define LOCATION_URL_SIZE 8192
+
+/* Translation of Total Commander paths into repository URLs. This module,
+   like the snapshot, cache, session and worker modules, uses nothing but
+   APR, Subversion and the C library, so that it builds on any platform. */
+
+/** A configured repository, shown as a directory in the plugin root. */
+typedef struct Location
+{
+    String title;   /* directory name in the plugin root */
+    String url;     /* unescaped repository URL, without trailing slash */
+    svn_revnum_t revision;  /* peg revision the location is browsed at, SVN_INVALID_REVNUM for HEAD */
+    String key;     /* url, followed by "@revision" if pinned; keys the disk cache and the filename index */
+    volatile apr_uint32_t indexScheduled;  /* apr_time_sec of the last background index update */
+    LocationStats *stats;                  /* request statistics, see stats_report_location */
+} Location;
+
+/** The configured locations. A zero-initialized set is empty. Paths are
+    resolved by looking up their first component in a hash table, so the
+    number of locations does not matter. */
+typedef struct Locations
+{
+    Location **sorted;   /* ordered by title, for listing the plugin root, see location_sort */
+    size_t count;
+    Location **table;    /* open addressing hash table by title, at most half full */
+    size_t tableMask;    /* table size - 1 */
+} Locations;
+
+/** Adds a location to @a set. A location with the same title is replaced.
+    @param set The set.
+    @param title The title. Need not be zero-terminated.
+    @param titleLen The length of @a title, not zero.
+    @param url The unescaped URL, optionally followed by a peg revision
+               "@N" or "@rN" that pins the location to revision N, so that
+               its listings and files never change. Need not be zero-terminated.
+    @param urlLen The length of @a url.
+    @return The new location, owned by @a set. */
+extern Location *location_add(Locations *set, const char *title, size_t titleLen, const char *url, size_t urlLen);
+
+/** Orders the locations of @a set by title. Call once after adding locations. */
+extern void location_sort(Locations *set);
+
+/** Frees all locations of @a set and leaves it empty. */
+extern void location_clear(Locations *set);
+
+/** Takes over the locations of @a old that @a fresh defines with the same
+    title, URL and peg revision, so that everything referring to them stays valid, and
+    empties @a old. Both sets must be sorted, see location_sort.
+    @param fresh The new locations. Its copies of unchanged locations are freed.
+    @param old The previous locations.
+    @param staleCount Receives the number of locations of @a old that @a fresh
+                      removes or changes.
+    @return An array of the @a staleCount stale locations, to be freed with
+            free. The caller frees the locations themselves with location_free
+            once nothing refers to them anymore. */
+extern Location **location_merge(Locations *fresh, Locations *old, size_t *staleCount);
+
+/** Frees a location that is not part of a set anymore, see location_merge. */
+extern void location_free(Location *loc);
+
+/** Looks up a location by its exact title in O(1).
+    @param set The set.
+    @param title The title. Need not be zero-terminated.
+    @param titleLen The length of @a title.
+    @return The location, or NULL if there is none titled @a title. */
+extern const Location *location_find(const Locations *set, const char *title, size_t titleLen);
+
+/** Finds the location of a path below the plugin root and normalizes the
+    rest of the path into a sub path as used by snapshots. The location is the
+    one titled like the first component of @a path.
+    @param set The locations.
+    @param path The path without leading backslash. Need not be zero-terminated.
+    @param pathLen The length of @a path.
+    @param subPath Receives the zero-terminated, '/'-separated sub path
+                   without trailing slashes, empty for the location root.
+    @param subPathSize The size of the @a subPath buffer.
+    @param subPathLen Receives the length of @a subPath.
+    @return The location, or NULL if @a path belongs to none. */
+extern const Location *location_resolve(const Locations *set, const char *path, size_t pathLen, char *subPath, size_t subPathSize, size_t *subPathLen);
+
+/** Translates a path below the plugin root into the escaped URL of a
+    repository node in a single pass: matches the location, turns backslashes
+    into slashes, drops trailing separators and percent-encodes whatever
+    Subversion does not accept literally, including the bytes of UTF-8 names.
+    @param set The locations.
+    @param remoteName The path without leading backslash. Need not be zero-terminated.
+    @param remoteNameLen The length of @a remoteName.
+    @param buf Receives the zero-terminated URL, truncated if it does not fit.
+    @param bufSize The size of @a buf. LOCATION_URL_SIZE always suffices.
+    @param location Receives the location, may be NULL.
+    @return The length of the complete URL, which is @a bufSize or more if it
+            was truncated, or 0 if @a remoteName belongs to no location. */
+extern size_t location_url(const Locations *set, const char *remoteName, size_t remoteNameLen, char *buf, size_t bufSize, const Location **location);
+
+/** Like location_url, for a node of a known location.
+    @param loc The location.
+    @param subPath The path inside @a loc, separated by slashes or backslashes,
+                   empty for the location root. Need not be zero-terminated.
+    @param subPathLen The length of @a subPath. */
+extern size_t location_node_url(const Location *loc, const char *subPath, size_t subPathLen, char *buf, size_t bufSize);
+
+/** Percent-encodes a string for use in an URL the way location_url does,
+    except that backslashes are encoded as well.
+    @param str The string. Need not be zero-terminated.
+    @param len The length of @a str.
+    @param buf Receives the zero-terminated result, truncated if it does not fit.
+    @param bufSize The size of @a buf.
+    @return The length of the complete result, @a bufSize or more if it was truncated. */
+extern size_t location_escape(const char *str, size_t len, char *buf, size_t bufSize);
+
+#endif /* !SVN_WFX_LOCATION_H_INCLUDED */
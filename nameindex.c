@@ -0,0 +1,945 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "nameindex.h"
+#include "cachedir.h"
+#include "trace.h"
+
+#include <svn_delta.h>
+#include <svn_path.h>
+#include <apr_atomic.h>
+#include <apr_file_info.h>
+#include <apr_file_io.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+** Types
+*/
+
+/** Paths of all nodes below a URL. An index is never modified once it has
+    been published, so searches run without a lock while an update builds
+    its replacement. */
+typedef struct NameIndex
+{
+    char *url;
+    svn_revnum_t revision;              /* indexed revision */
+    volatile apr_uint32_t updatedAt;    /* apr_time_sec of the last update */
+    apr_size_t count;
+    const char **paths;                 /* sorted, pointing into strings */
+    char *strings;                      /* zero-terminated paths relative to url, directories end with '/' */
+    apr_size_t stringsLen;
+    volatile apr_uint32_t refCount;
+    struct NameIndex *next;
+} NameIndex;
+
+/** Stored index header. It is followed by the zero-terminated URL, then by
+    each path as the length of the prefix it shares with the previous path,
+    the length of the remainder, both as 7 bit varints, and the remainder
+    itself. All values are stored in host byte order. */
+typedef struct IndexHeader
+{
+    char magic[8];
+    apr_int64_t updated;        /* time of the last update */
+    apr_uint32_t version;
+    apr_uint32_t checksum;      /* FNV-1a of everything following the header */
+    apr_int32_t revision;
+    apr_uint32_t urlLen;
+    apr_uint32_t count;
+    apr_uint32_t stringsLen;    /* total length of the zero-terminated paths */
+} IndexHeader;
+
+/** Paths collected during an update. Also the edit baton of the status editor. */
+typedef struct PathList
+{
+    const char **paths;
+    apr_size_t count;
+    apr_size_t capacity;
+    const char *prefix;         /* prepended to reported paths, "" or ending with '/' */
+    apr_pool_t *pool;           /* holds new path strings */
+} PathList;
+
+/** Paths added, replaced or deleted since the indexed revision. */
+typedef struct Changes
+{
+    const char *reposPath;      /* decoded path of the indexed URL inside the repository, "" for the root */
+    apr_size_t reposPathLen;
+    apr_hash_t *touched;        /* changed paths relative to the indexed URL */
+    int rebuild;                /* the indexed URL itself or a parent was added, replaced or deleted */
+    apr_pool_t *pool;
+} Changes;
+
+/*
+** Prototypes
+*/
+
+/** Updates the index of a target. Global.updateMutex must be locked. @see nameindex_update */
+static svn_error_t *updateIndex(svn_ra_session_t *session, const NameIndexTarget *target, apr_pool_t *pool);
+
+/** Indexes the whole tree below the session URL.
+    @param index Receives the new index.
+    @param url The URL the index is kept for.
+    @param session A session opened at @a url.
+    @param revision The revision to index.
+    @param pool The pool for temporary allocations. */
+static svn_error_t *buildIndex(NameIndex **index, const char *url, svn_ra_session_t *session, svn_revnum_t revision, apr_pool_t *pool);
+
+/** Updates an index from the log of changed paths since its revision.
+    @param index Receives the new index, or NULL if so much has changed that
+                 it is better built from scratch.
+    @param old The current index.
+    @param session A session opened at the index's URL.
+    @param revision The revision to update to.
+    @param pool The pool for temporary allocations. */
+static svn_error_t *updateFromLog(NameIndex **index, const NameIndex *old, svn_ra_session_t *session, svn_revnum_t revision, apr_pool_t *pool);
+
+/** Adds the paths below the session URL to @a list in a single status request. */
+static svn_error_t *crawl(svn_ra_session_t *session, svn_revnum_t revision, PathList *list, apr_pool_t *pool);
+
+/** @see svn_delta_editor_t */
+static svn_error_t *openRoot(void *editBaton, svn_revnum_t baseRevision, apr_pool_t *pool, void **rootBaton);
+
+/** @see svn_delta_editor_t */
+static svn_error_t *openDirectory(const char *path, void *parentBaton, svn_revnum_t baseRevision, apr_pool_t *pool, void **childBaton);
+
+/** @see svn_delta_editor_t */
+static svn_error_t *addDirectory(const char *path, void *parentBaton, const char *copyfromPath, svn_revnum_t copyfromRevision, apr_pool_t *pool, void **childBaton);
+
+/** @see svn_delta_editor_t */
+static svn_error_t *addFile(const char *path, void *parentBaton, const char *copyfromPath, svn_revnum_t copyfromRevision, apr_pool_t *pool, void **fileBaton);
+
+/** Records the paths of a log entry in the Changes @a baton. @see svn_log_entry_receiver_t */
+static svn_error_t *collectChanges(void *baton, svn_log_entry_t *entry, apr_pool_t *pool);
+
+/** Appends a path to @a list, copying it into the list's pool.
+    @param list The path list.
+    @param path The path relative to the list's prefix.
+    @param isDir Non-zero to append a '/'. */
+static void addPath(PathList *list, const char *path, int isDir);
+
+/** Appends a path to @a list without copying it. */
+static void pushPath(PathList *list, const char *path);
+
+/** Creates an index from unsorted paths, which may contain duplicates.
+    @return The new index with a reference count of one. */
+static NameIndex *packIndex(const char *url, const char **paths, apr_size_t count);
+
+/** @return The index of @a url with an additional reference, loading it from
+    disk if necessary, or NULL if there is none. */
+static NameIndex *acquireIndex(const char *url);
+
+/** Releases a reference to @a index, which may be NULL. */
+static void releaseIndex(NameIndex *index);
+
+/** Makes @a index the current index of its URL. */
+static void publishIndex(NameIndex *index);
+
+/** Reads a stored index. Global.mutex must be locked.
+    @return The index with a reference count of one, or NULL if there is no
+            valid file. */
+static NameIndex *loadIndex(const char *url);
+
+/** Writes @a index to disk, replacing any older file for the same URL. Failures are ignored. */
+static void storeIndex(const NameIndex *index);
+
+/** @return The position of the first path in @a index not less than @a key. */
+static apr_size_t lowerBound(const NameIndex *index, const char *key);
+
+/** @return Non-zero if the name from @a name to @a end matches @a pattern with wildcards. */
+static int matchWildcard(const char *name, const char *end, const char *pattern);
+
+/** @return Non-zero if the name from @a name to @a end contains @a pattern. */
+static int matchSubstring(const char *name, const char *end, const char *pattern);
+
+/** Appends @a value to @a p as a varint of 7 bit groups, least significant first.
+    @return The position after the varint. */
+static unsigned char *writeVarint(unsigned char *p, apr_size_t value);
+
+/** Reads a varint written by writeVarint and advances @a p past it.
+    @return Non-zero on success, zero if the varint is truncated or too long. */
+static int readVarint(const unsigned char **p, const unsigned char *end, apr_size_t *value);
+
+/** qsort comparison of path pointers. */
+static int comparePaths(const void *a, const void *b);
+
+/*
+** Globals
+*/
+static const char Magic[8] = { 's', 'v', 'n', 'w', 'f', 'x', 'i', '\n' };
+static const apr_uint32_t Version = 1;
+
+/* beyond this many changed paths, listing the whole tree is cheaper */
+static const unsigned int MaxTouched = 1000;
+
+static struct
+{
+    apr_thread_mutex_t *mutex;          /* guards indexes */
+    apr_thread_mutex_t *updateMutex;    /* serializes updates */
+    CacheDir *files;                    /* stored indexes */
+    NameIndex *indexes;
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+void nameindex_init(apr_pool_t *pool)
+{
+    apr_thread_mutex_create(&Global.mutex, APR_THREAD_MUTEX_DEFAULT, pool);
+    apr_thread_mutex_create(&Global.updateMutex, APR_THREAD_MUTEX_DEFAULT, pool);
+    Global.files = cachedir_create(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+void nameindex_configure(const char *dir, apr_off_t maxBytes)
+{
+    cachedir_configure(Global.files, dir, maxBytes);
+}
+
+/*--------------------------------------------------------------------------*/
+svn_error_t *nameindex_update(svn_ra_session_t *session, void *target, apr_pool_t *pool)
+{
+    svn_error_t *err;
+    if (!((const NameIndexTarget*) target)->nowait)
+    {
+        apr_thread_mutex_lock(Global.updateMutex);
+    }
+    else if (apr_thread_mutex_trylock(Global.updateMutex) != APR_SUCCESS)
+    {
+        return SVN_NO_ERROR;
+    }
+    err = updateIndex(session, target, pool);
+    apr_thread_mutex_unlock(Global.updateMutex);
+    return err;
+}
+
+/*--------------------------------------------------------------------------*/
+int nameindex_age(const char *url)
+{
+    NameIndex *index = acquireIndex(url);
+    int age = -1;
+    if (index)
+    {
+        age = (int) ((apr_uint32_t) apr_time_sec(apr_time_now()) - apr_atomic_read32(&index->updatedAt));
+        releaseIndex(index);
+    }
+    return age;
+}
+
+/*--------------------------------------------------------------------------*/
+int nameindex_search(const char *url, const char *subPath, const char *pattern, nameindex_match_t match, void *baton)
+{
+    NameIndex *index = acquireIndex(url);
+    const size_t subPathLen = strlen(subPath);
+    char *prefix;
+    size_t prefixLen = subPathLen, i;
+    int matches = 0;
+    const int wildcard = strpbrk(pattern, "*?") != NULL;
+
+    if (!index)
+    {
+        return -1;
+    }
+
+    /* the subtree of a directory is a contiguous range of the sorted paths */
+    prefix = malloc(subPathLen + 2);
+    memcpy(prefix, subPath, subPathLen);
+    if (prefixLen)
+    {
+        prefix[prefixLen++] = '/';
+    }
+    prefix[prefixLen] = '\0';
+    for (i = lowerBound(index, prefix); i < index->count && !strncmp(index->paths[i], prefix, prefixLen); ++i)
+    {
+        const char *path = index->paths[i] + prefixLen;
+        const char *end = path + strlen(path);
+        const char *name;
+
+        if (end > path && end[-1] == '/')
+        {
+            --end;
+        }
+        for (name = end; name > path && name[-1] != '/'; --name);
+        if (name < end && (wildcard ? matchWildcard(name, end, pattern) : matchSubstring(name, end, pattern)))
+        {
+            ++matches;
+            if (match(path, baton))
+            {
+                break;
+            }
+        }
+    }
+    free(prefix);
+    releaseIndex(index);
+    return matches;
+}
+
+/*--------------------------------------------------------------------------*/
+void nameindex_clear(void)
+{
+    NameIndex *index;
+
+    apr_thread_mutex_lock(Global.mutex);
+    index = Global.indexes;
+    Global.indexes = NULL;
+    apr_thread_mutex_unlock(Global.mutex);
+    while (index)
+    {
+        NameIndex *next = index->next;
+        releaseIndex(index);
+        index = next;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *updateIndex(svn_ra_session_t *session, const NameIndexTarget *target, apr_pool_t *pool)
+{
+    const char *url = target->url;
+    NameIndex *old = acquireIndex(url);
+    NameIndex *index = NULL;
+    svn_revnum_t youngest = target->revision;
+    svn_error_t *err = SVN_NO_ERROR;
+
+    if (!SVN_IS_VALID_REVNUM(youngest))
+    {
+        const apr_time_t start = trace_begin();
+        err = svn_ra_get_latest_revnum(session, &youngest, pool);
+        trace_end(start, "ra", "svn_ra_get_latest_revnum", url);
+    }
+
+    if (!err && old && old->revision == youngest)
+    {
+        apr_atomic_set32(&old->updatedAt, (apr_uint32_t) apr_time_sec(apr_time_now()));
+        releaseIndex(old);
+        return SVN_NO_ERROR;
+    }
+    if (!err && old && old->revision < youngest)
+    {
+        err = updateFromLog(&index, old, session, youngest, pool);
+    }
+    if (!err && !index)
+    {
+        err = buildIndex(&index, url, session, youngest, pool);
+    }
+    releaseIndex(old);
+    SVN_ERR(err);
+
+    index->revision = youngest;
+    index->updatedAt = (apr_uint32_t) apr_time_sec(apr_time_now());
+    storeIndex(index);
+    publishIndex(index);
+    releaseIndex(index);
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *buildIndex(NameIndex **index, const char *url, svn_ra_session_t *session, svn_revnum_t revision, apr_pool_t *pool)
+{
+    PathList list = { 0 };
+    svn_error_t *err;
+
+    list.prefix = "";
+    list.pool = pool;
+    err = crawl(session, revision, &list, pool);
+    if (!err)
+    {
+        *index = packIndex(url, list.paths, list.count);
+    }
+    free(list.paths);
+    return err;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *updateFromLog(NameIndex **index, const NameIndex *old, svn_ra_session_t *session, svn_revnum_t revision, apr_pool_t *pool)
+{
+    apr_array_header_t *logPaths = apr_array_make(pool, 1, sizeof(const char*));
+    apr_array_header_t *touched;
+    apr_hash_index_t *hi;
+    PathList list = { 0 };
+    Changes changes;
+    const char *root, *sessionURL;
+    char *removed;
+    apr_time_t start;
+    svn_error_t *err = SVN_NO_ERROR;
+    int i;
+
+    *index = NULL;
+    SVN_ERR(svn_ra_get_repos_root2(session, &root, pool));
+    SVN_ERR(svn_ra_get_session_url(session, &sessionURL, pool));
+    changes.reposPath = svn_path_uri_decode(sessionURL + strlen(root), pool);
+    changes.reposPathLen = strlen(changes.reposPath);
+    changes.touched = apr_hash_make(pool);
+    changes.rebuild = FALSE;
+    changes.pool = pool;
+    APR_ARRAY_PUSH(logPaths, const char*) = "";
+    TRACE_SVN_ERR("ra", "svn_ra_get_log2",
+                  svn_ra_get_log2(session, logPaths, old->revision + 1, revision, 0, TRUE, FALSE, FALSE,
+                                  apr_array_make(pool, 0, sizeof(const char*)), &collectChanges, &changes, pool));
+    if (changes.rebuild || apr_hash_count(changes.touched) > MaxTouched)
+    {
+        return SVN_NO_ERROR;
+    }
+
+    /* changes below a changed directory are covered by listing it again */
+    touched = apr_array_make(pool, apr_hash_count(changes.touched), sizeof(const char*));
+    for (hi = apr_hash_first(pool, changes.touched); hi; hi = apr_hash_next(hi))
+    {
+        const void *key;
+        const char *slash;
+
+        apr_hash_this(hi, &key, NULL, NULL);
+        for (slash = strchr(key, '/'); slash && !apr_hash_get(changes.touched, key, slash - (const char*) key); slash = strchr(slash + 1, '/'));
+        if (!slash)
+        {
+            APR_ARRAY_PUSH(touched, const char*) = key;
+        }
+    }
+
+    removed = apr_pcalloc(pool, old->count + 1);
+    list.prefix = "";
+    list.pool = pool;
+    for (i = 0; !err && i < touched->nelts; ++i)
+    {
+        const char *rel = APR_ARRAY_IDX(touched, i, const char*);
+        const size_t relLen = strlen(rel);
+        const char *relDir = apr_pstrcat(pool, rel, "/", NULL);
+        svn_node_kind_t kind;
+        size_t j;
+
+        /* drop the old node and everything below it */
+        j = lowerBound(old, rel);
+        if (j < old->count && !strcmp(old->paths[j], rel))
+        {
+            removed[j] = 1;
+        }
+        for (j = lowerBound(old, relDir); j < old->count && !strncmp(old->paths[j], relDir, relLen + 1); ++j)
+        {
+            removed[j] = 1;
+        }
+
+        /* and add what is there now */
+        start = trace_begin();
+        err = svn_ra_check_path(session, rel, revision, &kind, pool);
+        trace_end(start, "ra", "svn_ra_check_path", rel);
+        if (!err && kind == svn_node_file)
+        {
+            addPath(&list, rel, FALSE);
+        }
+        else if (!err && kind == svn_node_dir)
+        {
+            addPath(&list, rel, TRUE);
+            list.prefix = relDir;
+            err = svn_ra_reparent(session, apr_pstrcat(pool, sessionURL, "/", svn_path_uri_encode(rel, pool), NULL), pool);
+            if (!err)
+            {
+                err = crawl(session, revision, &list, pool);
+            }
+            if (!err)
+            {
+                err = svn_ra_reparent(session, sessionURL, pool);
+            }
+            list.prefix = "";
+        }
+    }
+
+    if (!err)
+    {
+        apr_size_t j;
+        for (j = 0; j < old->count; ++j)
+        {
+            if (!removed[j])
+            {
+                pushPath(&list, old->paths[j]);
+            }
+        }
+        *index = packIndex(old->url, list.paths, list.count);
+    }
+    free(list.paths);
+    return err;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *crawl(svn_ra_session_t *session, svn_revnum_t revision, PathList *list, apr_pool_t *pool)
+{
+    svn_delta_editor_t *editor = svn_delta_default_editor(pool);
+    const svn_ra_reporter3_t *reporter;
+    void *reportBaton;
+    apr_time_t start;
+    svn_error_t *err;
+
+    editor->open_root = &openRoot;
+    editor->open_directory = &openDirectory;
+    editor->add_directory = &addDirectory;
+    editor->add_file = &addFile;
+    SVN_ERR(svn_ra_do_status2(session, &reporter, &reportBaton, "", revision, svn_depth_infinity, editor, list, pool));
+
+    /* claim an empty tree, so that the server reports every node as added */
+    if ((err = reporter->set_path(reportBaton, "", revision, svn_depth_infinity, TRUE, NULL, pool)))
+    {
+        svn_error_clear(reporter->abort_report(reportBaton, pool));
+        return err;
+    }
+    start = trace_begin();
+    err = reporter->finish_report(reportBaton, pool);
+    trace_end(start, "ra", "svn_ra_do_status2", NULL);
+    return err;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *openRoot(void *editBaton, svn_revnum_t baseRevision, apr_pool_t *pool, void **rootBaton)
+{
+    *rootBaton = editBaton;
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *openDirectory(const char *path, void *parentBaton, svn_revnum_t baseRevision, apr_pool_t *pool, void **childBaton)
+{
+    *childBaton = parentBaton;
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *addDirectory(const char *path, void *parentBaton, const char *copyfromPath, svn_revnum_t copyfromRevision, apr_pool_t *pool, void **childBaton)
+{
+    addPath(parentBaton, path, TRUE);
+    *childBaton = parentBaton;
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *addFile(const char *path, void *parentBaton, const char *copyfromPath, svn_revnum_t copyfromRevision, apr_pool_t *pool, void **fileBaton)
+{
+    addPath(parentBaton, path, FALSE);
+    *fileBaton = parentBaton;
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *collectChanges(void *baton, svn_log_entry_t *entry, apr_pool_t *pool)
+{
+    Changes *changes = baton;
+    apr_hash_index_t *hi;
+
+    if (!entry->changed_paths)
+    {
+        return SVN_NO_ERROR;
+    }
+    for (hi = apr_hash_first(pool, entry->changed_paths); hi; hi = apr_hash_next(hi))
+    {
+        const void *key;
+        void *value;
+        const char *path;
+        size_t pathLen;
+
+        apr_hash_this(hi, &key, NULL, &value);
+        if (((const svn_log_changed_path_t*) value)->action == 'M')
+        {
+            /* contents or properties only */
+            continue;
+        }
+        path = key;
+        pathLen = strlen(path);
+        if (pathLen > changes->reposPathLen + 1 && path[changes->reposPathLen] == '/'
+            && !strncmp(path, changes->reposPath, changes->reposPathLen))
+        {
+            const char *rel = apr_pstrdup(changes->pool, path + changes->reposPathLen + 1);
+            apr_hash_set(changes->touched, rel, APR_HASH_KEY_STRING, rel);
+        }
+        else if (!strncmp(changes->reposPath, path, pathLen)
+                 && (changes->reposPath[pathLen] == '\0' || changes->reposPath[pathLen] == '/'))
+        {
+            changes->rebuild = TRUE;
+        }
+    }
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static void addPath(PathList *list, const char *path, int isDir)
+{
+    pushPath(list, apr_pstrcat(list->pool, list->prefix, path, isDir ? "/" : "", NULL));
+}
+
+/*--------------------------------------------------------------------------*/
+static void pushPath(PathList *list, const char *path)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->paths = realloc(list->paths, list->capacity * sizeof(*list->paths));
+    }
+    list->paths[list->count++] = path;
+}
+
+/*--------------------------------------------------------------------------*/
+static NameIndex *packIndex(const char *url, const char **paths, apr_size_t count)
+{
+    NameIndex *index = calloc(1, sizeof(*index));
+    apr_size_t i, unique = 0, len = 0;
+    char *s;
+
+    qsort(paths, count, sizeof(*paths), &comparePaths);
+    for (i = 0; i < count; ++i)
+    {
+        if (!i || strcmp(paths[i - 1], paths[i]))
+        {
+            paths[unique++] = paths[i];
+            len += strlen(paths[i]) + 1;
+        }
+    }
+
+    index->url = strdup(url);
+    index->revision = SVN_INVALID_REVNUM;
+    index->count = unique;
+    index->paths = malloc(unique * sizeof(*index->paths) + 1);
+    index->strings = s = malloc(len + 1);
+    index->stringsLen = len;
+    index->refCount = 1;
+    for (i = 0; i < unique; ++i)
+    {
+        const size_t pathLen = strlen(paths[i]) + 1;
+        memcpy(s, paths[i], pathLen);
+        index->paths[i] = s;
+        s += pathLen;
+    }
+    return index;
+}
+
+/*--------------------------------------------------------------------------*/
+static NameIndex *acquireIndex(const char *url)
+{
+    NameIndex *index;
+
+    apr_thread_mutex_lock(Global.mutex);
+    for (index = Global.indexes; index && strcmp(index->url, url); index = index->next);
+    if (!index && (index = loadIndex(url)))
+    {
+        index->next = Global.indexes;
+        Global.indexes = index;
+    }
+    if (index)
+    {
+        apr_atomic_inc32(&index->refCount);
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+    return index;
+}
+
+/*--------------------------------------------------------------------------*/
+static void releaseIndex(NameIndex *index)
+{
+    if (index && !apr_atomic_dec32(&index->refCount))
+    {
+        free(index->url);
+        free((void*) index->paths);
+        free(index->strings);
+        free(index);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void publishIndex(NameIndex *index)
+{
+    NameIndex **link, *old = NULL;
+
+    apr_atomic_inc32(&index->refCount);
+    apr_thread_mutex_lock(Global.mutex);
+    for (link = &Global.indexes; *link; link = &(*link)->next)
+    {
+        if (!strcmp((*link)->url, index->url))
+        {
+            old = *link;
+            *link = old->next;
+            break;
+        }
+    }
+    index->next = Global.indexes;
+    Global.indexes = index;
+    apr_thread_mutex_unlock(Global.mutex);
+    releaseIndex(old);
+}
+
+/*--------------------------------------------------------------------------*/
+static NameIndex *loadIndex(const char *url)
+{
+    NameIndex *index = NULL;
+    apr_pool_t *pool;
+    apr_file_t *file;
+    apr_finfo_t finfo;
+    const char *path;
+    char *data = NULL;
+
+    apr_pool_create(&pool, NULL);
+    /* a URL sharing the file name is told apart by the stored URL */
+    if ((path = cachedir_path(Global.files, url, ".idx", pool))
+        && apr_file_open(&file, path, APR_READ | APR_BINARY, APR_OS_DEFAULT, pool) == APR_SUCCESS)
+    {
+        if (apr_file_info_get(&finfo, APR_FINFO_SIZE, file) == APR_SUCCESS && finfo.size >= (apr_off_t) sizeof(IndexHeader)
+            && (data = malloc((apr_size_t) finfo.size)) && apr_file_read_full(file, data, (apr_size_t) finfo.size, NULL) != APR_SUCCESS)
+        {
+            free(data);
+            data = NULL;
+        }
+        apr_file_close(file);
+    }
+    apr_pool_destroy(pool);
+
+    if (data)
+    {
+        const IndexHeader *header = (const IndexHeader*) data;
+        const unsigned char *p = (const unsigned char*) data + sizeof(*header);
+        const unsigned char *end = (const unsigned char*) data + finfo.size;
+        const char *prev = "";
+        apr_size_t prevLen = 0, i;
+        char *s;
+
+        if (memcmp(header->magic, Magic, sizeof(Magic)) || header->version != Version
+            || cachedir_hash(CACHEDIR_HASH_INIT, p, end - p) != header->checksum
+            || (apr_size_t) (end - p) <= header->urlLen || p[header->urlLen]
+            || strlen(url) != header->urlLen || memcmp(p, url, header->urlLen)
+            || header->count > (apr_size_t) (end - p) / 2)
+        {
+            free(data);
+            return NULL;
+        }
+        p += header->urlLen + 1;
+
+        index = calloc(1, sizeof(*index));
+        index->url = strdup(url);
+        index->revision = header->revision;
+        index->updatedAt = (apr_uint32_t) apr_time_sec(header->updated);
+        index->count = header->count;
+        index->paths = malloc(header->count * sizeof(*index->paths) + 1);
+        index->strings = s = malloc(header->stringsLen + 1);
+        index->stringsLen = header->stringsLen;
+        index->refCount = 1;
+        for (i = 0; index && i < header->count; ++i)
+        {
+            apr_size_t shared, rest;
+
+            if (!readVarint(&p, end, &shared) || !readVarint(&p, end, &rest) || shared > prevLen || rest > (apr_size_t) (end - p) || memchr(p, '\0', rest)
+                || header->stringsLen - (s - index->strings) < shared + rest + 1)
+            {
+                releaseIndex(index);
+                index = NULL;
+                break;
+            }
+            memcpy(s, prev, shared);
+            memcpy(s + shared, p, rest);
+            s[shared + rest] = '\0';
+            p += rest;
+            if (i && strcmp(prev, s) >= 0)
+            {
+                /* searches depend on the order */
+                releaseIndex(index);
+                index = NULL;
+                break;
+            }
+            index->paths[i] = prev = s;
+            prevLen = shared + rest;
+            s += prevLen + 1;
+        }
+        if (index && (p != end || (apr_size_t) (s - index->strings) != header->stringsLen))
+        {
+            releaseIndex(index);
+            index = NULL;
+        }
+        free(data);
+    }
+    return index;
+}
+
+/*--------------------------------------------------------------------------*/
+static void storeIndex(const NameIndex *index)
+{
+    IndexHeader header;
+    apr_pool_t *pool;
+    apr_file_t *file;
+    char *path, *tempPath;
+    unsigned char *data, *p;
+    const char *prev = "";
+    const apr_size_t urlLen = strlen(index->url);
+    apr_size_t i;
+    int ok;
+
+    apr_pool_create(&pool, NULL);
+    if (!(path = cachedir_path(Global.files, index->url, ".idx", pool)))
+    {
+        apr_pool_destroy(pool);
+        return;
+    }
+
+    /* sorted paths share long prefixes with their predecessors; storing only
+       the differing suffix typically shrinks the file to a fraction */
+    p = data = malloc(urlLen + 1 + index->stringsLen + index->count * 2 * 5);
+    memcpy(p, index->url, urlLen + 1);
+    p += urlLen + 1;
+    for (i = 0; i < index->count; ++i)
+    {
+        const char *s = index->paths[i];
+        apr_size_t shared = 0, rest;
+
+        while (prev[shared] && prev[shared] == s[shared])
+        {
+            ++shared;
+        }
+        rest = strlen(s + shared);
+        p = writeVarint(p, shared);
+        p = writeVarint(p, rest);
+        memcpy(p, s + shared, rest);
+        p += rest;
+        prev = s;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.updated = apr_time_from_sec(index->updatedAt);
+    header.version = Version;
+    header.checksum = cachedir_hash(CACHEDIR_HASH_INIT, data, p - data);
+    header.revision = (apr_int32_t) index->revision;
+    header.urlLen = (apr_uint32_t) urlLen;
+    header.count = (apr_uint32_t) index->count;
+    header.stringsLen = (apr_uint32_t) index->stringsLen;
+
+    if (cachedir_mktemp(Global.files, &file, &tempPath, APR_BINARY, pool) == APR_SUCCESS)
+    {
+        ok = apr_file_write_full(file, &header, sizeof(header), NULL) == APR_SUCCESS
+             && apr_file_write_full(file, data, p - data, NULL) == APR_SUCCESS;
+        ok = (apr_file_close(file) == APR_SUCCESS) && ok;
+        if (ok)
+        {
+            cachedir_commit(Global.files, tempPath, path, sizeof(header) + (p - data), pool);
+        }
+        else
+        {
+            apr_file_remove(tempPath, pool);
+        }
+    }
+    free(data);
+    apr_pool_destroy(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static apr_size_t lowerBound(const NameIndex *index, const char *key)
+{
+    apr_size_t lo = 0, hi = index->count;
+    while (lo < hi)
+    {
+        const apr_size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(index->paths[mid], key) < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*--------------------------------------------------------------------------*/
+static int matchWildcard(const char *name, const char *end, const char *pattern)
+{
+    const char *starName = NULL, *starPattern = NULL;
+
+    while (name < end)
+    {
+        if (*pattern == '*')
+        {
+            starPattern = ++pattern;
+            starName = name;
+        }
+        else if (*pattern && (*pattern == '?' || tolower((unsigned char) *pattern) == tolower((unsigned char) *name)))
+        {
+            ++pattern;
+            ++name;
+        }
+        else if (starPattern)
+        {
+            /* let the last '*' swallow one more character */
+            pattern = starPattern;
+            name = ++starName;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    while (*pattern == '*')
+    {
+        ++pattern;
+    }
+    return !*pattern;
+}
+
+/*--------------------------------------------------------------------------*/
+static int matchSubstring(const char *name, const char *end, const char *pattern)
+{
+    const apr_size_t len = strlen(pattern);
+    for (; name + len <= end; ++name)
+    {
+        apr_size_t i;
+        for (i = 0; i < len && tolower((unsigned char) name[i]) == tolower((unsigned char) pattern[i]); ++i);
+        if (i == len)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+static unsigned char *writeVarint(unsigned char *p, apr_size_t value)
+{
+    while (value > 0x7f)
+    {
+        *p++ = (unsigned char) (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    *p++ = (unsigned char) value;
+    return p;
+}
+
+/*--------------------------------------------------------------------------*/
+static int readVarint(const unsigned char **p, const unsigned char *end, apr_size_t *value)
+{
+    const unsigned char *q = *p;
+    int shift;
+
+    *value = 0;
+    for (shift = 0; q < end && shift < 32; shift += 7)
+    {
+        *value |= (apr_size_t) (*q & 0x7f) << shift;
+        if (!(*q++ & 0x80))
+        {
+            *p = q;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+static int comparePaths(const void *a, const void *b)
+{
+    return strcmp(*(const char* const*) a, *(const char* const*) b);
+}
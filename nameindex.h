@@ -0,0 +1,87 @@
+#ifndef SVN_WFX_NAMEINDEX_H_INCLUDED
+#define SVN_WFX_NAMEINDEX_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <svn_ra.h>
+#include <apr_pools.h>
+
+/** Callback for nameindex_search.
+    @param path The zero-terminated matching path, relative to the searched
+                directory. Directories end with a '/'.
+    @param baton The baton passed to nameindex_search.
+    @return Zero to continue the search, non-zero to stop it. */
+typedef int (*nameindex_match_t)(const char *path, void *baton);
+
+/** What nameindex_update indexes. */
+typedef struct NameIndexTarget
+{
+    const char *url;        /* zero-terminated, unescaped URL the index is kept for */
+    svn_revnum_t revision;  /* the revision to index, SVN_INVALID_REVNUM to follow the youngest one */
+    int nowait;             /* non-zero to leave the index as it is while another update runs */
+} NameIndexTarget;
+
+/** Sets up the filename index. An index holds the paths of all files and
+    directories below a URL, sorted, so that any directory's subtree is a
+    contiguous range. All nameindex functions are thread-safe.
+    @param pool The pool to allocate global state from. */
+extern void nameindex_init(apr_pool_t *pool);
+
+/** Sets the directory indexes are stored in and its size limit, evicting
+    the least recently written indexes if necessary. They are kept
+    front-coded, one file per URL, see cachedir_path.
+    @param dir The zero-terminated directory. Created on demand.
+    @param maxBytes The maximum total size of all stored indexes. Zero keeps
+                    indexes in memory only. */
+extern void nameindex_configure(const char *dir, apr_off_t maxBytes);
+
+/** Brings the index of a URL up to date with the youngest revision, or
+    with the target's fixed revision, which needs no request once indexed.
+    An existing index is updated from the changed paths in the log since its
+    revision; otherwise the whole tree is reported in a single status
+    request. Only one update runs at a time, later ones wait for it unless
+    the target says otherwise. @see session_func_t
+    @param session A session opened at the URL.
+    @param target The NameIndexTarget. Indexes of the same URL at different
+                  revisions need different target URLs.
+    @param pool The pool for temporary allocations.
+    @return The error, or SVN_NO_ERROR on success. */
+extern svn_error_t *nameindex_update(svn_ra_session_t *session, void *target, apr_pool_t *pool);
+
+/** @return The seconds since the index of @a url was last brought up to date,
+    or -1 if there is no index for @a url, neither in memory nor on disk. */
+extern int nameindex_age(const char *url);
+
+/** Finds all paths below a directory whose name matches @a pattern.
+    @param url The zero-terminated, unescaped URL the index is kept for.
+    @param subPath The '/'-separated directory to search, relative to @a url,
+                   without leading or trailing slash. Empty searches everything.
+    @param pattern The zero-terminated pattern. Names are compared without
+                   regard to case, with '*' and '?' as wildcards if the pattern
+                   contains any, otherwise as substrings.
+    @param match Called for each match, in sorted order.
+    @param baton Passed to @a match.
+    @return The number of matches reported to @a match, or -1 if there is no
+            index for @a url. */
+extern int nameindex_search(const char *url, const char *subPath, const char *pattern, nameindex_match_t match, void *baton);
+
+/** Drops all indexes from memory. Stored indexes are loaded again on demand. */
+extern void nameindex_clear(void);
+
+#endif /* !SVN_WFX_NAMEINDEX_H_INCLUDED */
@@ -0,0 +1,264 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "revinfo.h"
+
+#include <apr_hash.h>
+#include <apr_thread_mutex.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+** Types
+*/
+typedef struct RevKey
+{
+    const struct Location *location;
+    svn_revnum_t revision;
+} RevKey;
+
+typedef struct RevEntry
+{
+    RevKey key;                 /* zero-padded, hashed as a whole */
+    struct RevEntry *newer;     /* LRU list links */
+    struct RevEntry *older;
+    apr_uint32_t changedPaths;  /* number of paths the commit changed */
+    size_t messageLen;
+    char message[1];            /* zero-terminated log message on a single line, allocated past the end of the struct */
+} RevEntry;
+
+/*
+** Prototypes
+*/
+
+/** Fills in a hash key, including its padding. */
+static void makeKey(RevKey *key, const struct Location *location, svn_revnum_t revision);
+
+/** Copies a log message, flattened to a single line and truncated to at
+    most REVINFO_MESSAGE_SIZE - 1 bytes without splitting a UTF-8 sequence.
+    @param dst Receives the zero-terminated result, REVINFO_MESSAGE_SIZE bytes.
+    @param src The zero-terminated message.
+    @return The length of the result. */
+static size_t flattenMessage(char *dst, const char *src);
+
+/** Removes @a entry from the LRU list. Global.mutex must be locked. */
+static void unlinkEntry(RevEntry *entry);
+
+/** Makes @a entry the most recently used one. Global.mutex must be locked. */
+static void linkNewest(RevEntry *entry);
+
+/** Drops @a entry from the cache and frees it. Global.mutex must be locked. */
+static void dropEntry(RevEntry *entry);
+
+/*
+** Globals
+*/
+static struct
+{
+    apr_thread_mutex_t *mutex;
+    apr_hash_t *revisions;  /* RevKey -> RevEntry */
+    RevEntry *newest;
+    RevEntry *oldest;
+    size_t count;
+    size_t capacity;
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+void revinfo_init(apr_pool_t *pool)
+{
+    apr_thread_mutex_create(&Global.mutex, APR_THREAD_MUTEX_DEFAULT, pool);
+    Global.revisions = apr_hash_make(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+void revinfo_set_capacity(size_t capacity)
+{
+    apr_thread_mutex_lock(Global.mutex);
+    Global.capacity = capacity;
+    while (Global.count > Global.capacity)
+    {
+        dropEntry(Global.oldest);
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+int revinfo_lookup(const struct Location *location, svn_revnum_t revision, apr_uint32_t *changedPaths, char *message, size_t messageSize)
+{
+    RevKey key;
+    RevEntry *entry;
+
+    makeKey(&key, location, revision);
+    apr_thread_mutex_lock(Global.mutex);
+    entry = apr_hash_get(Global.revisions, &key, sizeof(key));
+    if (entry)
+    {
+        unlinkEntry(entry);
+        linkNewest(entry);
+        if (changedPaths)
+        {
+            *changedPaths = entry->changedPaths;
+        }
+        if (message && messageSize)
+        {
+            const size_t len = entry->messageLen < messageSize ? entry->messageLen : messageSize - 1;
+            memcpy(message, entry->message, len);
+            message[len] = '\0';
+        }
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+    return entry != NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+void revinfo_store(const struct Location *location, svn_revnum_t revision, apr_uint32_t changedPaths, const char *message)
+{
+    char buf[REVINFO_MESSAGE_SIZE];
+    const size_t len = message ? flattenMessage(buf, message) : 0;
+    RevEntry *entry = malloc(offsetof(RevEntry, message) + len + 1);
+
+    makeKey(&entry->key, location, revision);
+    entry->changedPaths = changedPaths;
+    entry->messageLen = len;
+    memcpy(entry->message, buf, len);
+    entry->message[len] = '\0';
+
+    apr_thread_mutex_lock(Global.mutex);
+    if (!Global.capacity || apr_hash_get(Global.revisions, &entry->key, sizeof(entry->key)))
+    {
+        free(entry);
+    }
+    else
+    {
+        if (Global.count >= Global.capacity)
+        {
+            dropEntry(Global.oldest);
+        }
+        apr_hash_set(Global.revisions, &entry->key, sizeof(entry->key), entry);
+        linkNewest(entry);
+        ++Global.count;
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+void revinfo_clear(const struct Location *location)
+{
+    apr_hash_index_t *hi;
+
+    apr_thread_mutex_lock(Global.mutex);
+    for (hi = apr_hash_first(NULL, Global.revisions); hi; hi = apr_hash_next(hi))
+    {
+        void *value;
+        RevEntry *entry;
+
+        apr_hash_this(hi, NULL, NULL, &value);
+        entry = value;
+        if (!location || entry->key.location == location)
+        {
+            /* removing the current entry does not disturb the iteration */
+            dropEntry(entry);
+        }
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+static void makeKey(RevKey *key, const struct Location *location, svn_revnum_t revision)
+{
+    memset(key, 0, sizeof(*key));
+    key->location = location;
+    key->revision = revision;
+}
+
+/*--------------------------------------------------------------------------*/
+static size_t flattenMessage(char *dst, const char *src)
+{
+    size_t len = 0;
+    int space = 1;  /* drops leading and repeated whitespace */
+
+    for (; *src && len < REVINFO_MESSAGE_SIZE - 1; ++src)
+    {
+        if ((unsigned char) *src <= ' ')
+        {
+            if (!space)
+            {
+                dst[len++] = ' ';
+                space = 1;
+            }
+        }
+        else
+        {
+            dst[len++] = *src;
+            space = 0;
+        }
+    }
+    if (*src)
+    {
+        /* cut before an incomplete UTF-8 sequence */
+        while (len && ((unsigned char) *src & 0xC0) == 0x80)
+        {
+            --len;
+            src = dst + len;
+        }
+    }
+    while (len && dst[len - 1] == ' ')
+    {
+        --len;
+    }
+    return len;
+}
+
+/*--------------------------------------------------------------------------*/
+static void unlinkEntry(RevEntry *entry)
+{
+    if (entry->newer)
+        entry->newer->older = entry->older;
+    else
+        Global.newest = entry->older;
+
+    if (entry->older)
+        entry->older->newer = entry->newer;
+    else
+        Global.oldest = entry->newer;
+
+    entry->newer = entry->older = NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+static void linkNewest(RevEntry *entry)
+{
+    entry->newer = NULL;
+    entry->older = Global.newest;
+    if (Global.newest)
+        Global.newest->newer = entry;
+    else
+        Global.oldest = entry;
+    Global.newest = entry;
+}
+
+/*--------------------------------------------------------------------------*/
+static void dropEntry(RevEntry *entry)
+{
+    unlinkEntry(entry);
+    apr_hash_set(Global.revisions, &entry->key, sizeof(entry->key), NULL);
+    --Global.count;
+    free(entry);
+}
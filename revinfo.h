@@ -0,0 +1,68 @@
+#ifndef SVN_WFX_REVINFO_H_INCLUDED
+#define SVN_WFX_REVINFO_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <svn_types.h>
+#include <apr_pools.h>
+
+struct Location;
+
+/** Size of the longest log message kept, including the terminating zero. */
+#define REVINFO_MESSAGE_SIZE 256
+
+/** Initializes the cache of commit details. Revisions never change, so their
+    details are cached until they are evicted or their location is removed.
+    Must be called before any other revinfo function. All revinfo functions
+    are thread-safe.
+    @param pool The pool to allocate the cache from. */
+extern void revinfo_init(apr_pool_t *pool);
+
+/** Sets the maximum number of revisions kept, evicting the least recently
+    used ones if necessary.
+    @param capacity The number of revisions, zero keeps none. */
+extern void revinfo_set_capacity(size_t capacity);
+
+/** Looks up the details of a revision and marks them as most recently
+    used. They are copied, since another thread may drop them at any time.
+    @param location The location, which stands for its repository.
+    @param revision The revision.
+    @param changedPaths Receives the number of paths the commit changed, may be NULL.
+    @param message Receives the zero-terminated log message on a single line,
+                   truncated to @a messageSize - 1 bytes. May be NULL.
+    @param messageSize The size of @a message in bytes.
+    @return Non-zero if the details have been stored, zero otherwise. */
+extern int revinfo_lookup(const struct Location *location, svn_revnum_t revision, apr_uint32_t *changedPaths, char *message, size_t messageSize);
+
+/** Stores the details of a revision unless they are known already,
+    evicting the least recently used revision if the cache is full.
+    @param location The location, which stands for its repository.
+    @param revision The revision.
+    @param changedPaths The number of paths the commit changed.
+    @param message The log message, may be NULL. Line breaks and other
+                   control characters are turned into spaces, and messages
+                   longer than REVINFO_MESSAGE_SIZE - 1 bytes are cut at a
+                   character boundary. */
+extern void revinfo_store(const struct Location *location, svn_revnum_t revision, apr_uint32_t changedPaths, const char *message);
+
+/** Drops cached revision details.
+    @param location Drop only the revisions of this location, NULL for all. */
+extern void revinfo_clear(const struct Location *location);
+
+#endif /* !SVN_WFX_REVINFO_H_INCLUDED */
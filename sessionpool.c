@@ -0,0 +1,234 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sessionpool.h"
+#include "trace.h"
+
+#include <apr_errno.h>
+#include <apr_thread_mutex.h>
+#include <apr_time.h>
+#include <svn_pools.h>
+
+#include <stdlib.h>
+
+/*
+** Types
+*/
+typedef struct PooledSession
+{
+    svn_ra_session_t *session;
+    apr_pool_t *pool;           /* owns the session */
+    const void *key;
+    svn_client_ctx_t *ctx;      /* context the session was opened with */
+    apr_time_t lastUsed;
+    struct PooledSession *next;
+} PooledSession;
+
+/*
+** Prototypes
+*/
+
+/** Takes an idle session for @a key and @a ctx off the list and unlinks all
+    expired sessions into @a expired. Global.mutex must be locked.
+    @return The session, or NULL if there is none. */
+static PooledSession *takeIdle(const void *key, svn_client_ctx_t *ctx, PooledSession **expired);
+
+/** Closes a list of sessions. */
+static void closeSessions(PooledSession *list);
+
+/** @return Non-zero if @a err or any error it wraps tells that the
+    connection of the session has been lost. */
+static int isConnectionError(const svn_error_t *err);
+
+/*
+** Globals
+*/
+static struct
+{
+    apr_thread_mutex_t *mutex;
+    PooledSession *idle;        /* most recently used first */
+    apr_interval_time_t idleTimeout;
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+void sessionpool_init(apr_pool_t *pool)
+{
+    apr_thread_mutex_create(&Global.mutex, APR_THREAD_MUTEX_DEFAULT, pool);
+}
+
+/*--------------------------------------------------------------------------*/
+void sessionpool_set_idle_timeout(int seconds)
+{
+    PooledSession *expired = NULL;
+    apr_thread_mutex_lock(Global.mutex);
+    Global.idleTimeout = apr_time_from_sec(seconds);
+    takeIdle(NULL, NULL, &expired);
+    apr_thread_mutex_unlock(Global.mutex);
+    closeSessions(expired);
+}
+
+/*--------------------------------------------------------------------------*/
+svn_error_t *sessionpool_run(const void *key, const char *url, svn_client_ctx_t *ctx, session_func_t func, void *baton, apr_pool_t *pool)
+{
+    PooledSession *session, *expired = NULL;
+    const apr_time_t traceStart = trace_begin();
+    apr_time_t start;
+    svn_error_t *err;
+
+    apr_thread_mutex_lock(Global.mutex);
+    session = takeIdle(key, ctx, &expired);
+    apr_thread_mutex_unlock(Global.mutex);
+    closeSessions(expired);
+
+    if (session)
+    {
+        start = trace_begin();
+        err = svn_ra_reparent(session->session, url, pool);
+        trace_end(start, "ra", "svn_ra_reparent", NULL);
+        if (!err)
+        {
+            err = func(session->session, baton, pool);
+        }
+        if (err && isConnectionError(err))
+        {
+            /* probably a connection that timed out on the server side */
+            svn_error_clear(err);
+            closeSessions(session);
+            session = NULL;
+        }
+    }
+
+    if (!session)
+    {
+        session = malloc(sizeof(*session));
+        session->pool = svn_pool_create(NULL);
+        session->key = key;
+        session->ctx = ctx;
+        session->next = NULL;
+        start = trace_begin();
+        err = svn_client_open_ra_session(&session->session, url, ctx, session->pool);
+        trace_end(start, "ra", "svn_client_open_ra_session", NULL);
+        if (err)
+        {
+            closeSessions(session);
+            trace_end(traceStart, "ra", "session", url);
+            return err;
+        }
+        err = func(session->session, baton, pool);
+    }
+
+    apr_thread_mutex_lock(Global.mutex);
+    /* a cancelled request may leave unread responses on the connection */
+    if ((!err || (err->apr_err != SVN_ERR_CANCELLED && !isConnectionError(err))) && Global.idleTimeout)
+    {
+        session->lastUsed = apr_time_now();
+        session->next = Global.idle;
+        Global.idle = session;
+        session = NULL;
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+    if (session)
+    {
+        closeSessions(session);
+    }
+    trace_end(traceStart, "ra", "session", url);
+    return err;
+}
+
+/*--------------------------------------------------------------------------*/
+void sessionpool_clear(svn_client_ctx_t *ctx)
+{
+    PooledSession **p, *closed = NULL;
+
+    apr_thread_mutex_lock(Global.mutex);
+    p = &Global.idle;
+    while (*p)
+    {
+        PooledSession *session = *p;
+        if (!ctx || session->ctx == ctx)
+        {
+            *p = session->next;
+            session->next = closed;
+            closed = session;
+        }
+        else
+        {
+            p = &session->next;
+        }
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+    closeSessions(closed);
+}
+
+/*--------------------------------------------------------------------------*/
+static PooledSession *takeIdle(const void *key, svn_client_ctx_t *ctx, PooledSession **expired)
+{
+    const apr_time_t now = apr_time_now();
+    PooledSession **p = &Global.idle;
+    PooledSession *found = NULL;
+
+    while (*p)
+    {
+        PooledSession *session = *p;
+        if (now - session->lastUsed >= Global.idleTimeout)
+        {
+            *p = session->next;
+            session->next = *expired;
+            *expired = session;
+        }
+        else if (!found && session->key == key && session->ctx == ctx)
+        {
+            *p = session->next;
+            session->next = NULL;
+            found = session;
+        }
+        else
+        {
+            p = &session->next;
+        }
+    }
+    return found;
+}
+
+/*--------------------------------------------------------------------------*/
+static void closeSessions(PooledSession *list)
+{
+    while (list)
+    {
+        PooledSession *next = list->next;
+        /* destroying the pool closes the connection */
+        svn_pool_destroy(list->pool);
+        free(list);
+        list = next;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static int isConnectionError(const svn_error_t *err)
+{
+    for (; err; err = err->child)
+    {
+        if (err->apr_err == SVN_ERR_RA_SVN_CONNECTION_CLOSED || err->apr_err == SVN_ERR_RA_SVN_IO_ERROR
+            || err->apr_err == SVN_ERR_RA_DAV_REQUEST_FAILED
+            || APR_STATUS_IS_ECONNRESET(err->apr_err) || APR_STATUS_IS_EPIPE(err->apr_err))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
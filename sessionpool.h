@@ -0,0 +1,65 @@
+#ifndef SVN_WFX_SESSIONPOOL_H_INCLUDED
+#define SVN_WFX_SESSIONPOOL_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <svn_client.h>
+#include <svn_ra.h>
+
+/** Callback for sessionpool_run.
+    @param session An open session, parented at the URL passed to sessionpool_run.
+    @param baton The baton passed to sessionpool_run.
+    @param pool The pool for temporary allocations.
+    @return The error, or SVN_NO_ERROR on success. */
+typedef svn_error_t *(*session_func_t)(svn_ra_session_t *session, void *baton, apr_pool_t *pool);
+
+/** Initializes the session pool. Must be called before any other
+    sessionpool function. All sessionpool functions are thread-safe.
+    @param pool The pool to allocate global state from. */
+extern void sessionpool_init(apr_pool_t *pool);
+
+/** Sets how long unused sessions are kept open, closing any sessions that
+    have been idle for longer.
+    @param seconds The idle timeout. Zero disables pooling, so that every
+                   sessionpool_run opens and closes its own session. */
+extern void sessionpool_set_idle_timeout(int seconds);
+
+/** Runs @a func with a session reparented to @a url. Open sessions are
+    reused when they belong to the same @a key and @a ctx, so the
+    connection, authentication and capabilities exchange happen only once.
+    If @a func fails on a reused session because its connection has been
+    lost, it is run once more on a new session, as the server may have
+    dropped the old connection. Sessions that fail for any other reason than
+    a lost connection or cancellation are kept for reuse. A session is never
+    used by two threads at once.
+    @param key Identifies the repository area, e.g. the location. Sessions
+               are only reparented within the same key.
+    @param url The escaped URL to parent the session at.
+    @param ctx The client context to open new sessions with. Sessions keep
+               using the auth baton and cancel function of this context.
+    @param func The function to run. It may be called twice, see above.
+    @param baton Passed to @a func.
+    @param pool The pool for temporary allocations.
+    @return The error returned by @a func or by opening the session. */
+extern svn_error_t *sessionpool_run(const void *key, const char *url, svn_client_ctx_t *ctx, session_func_t func, void *baton, apr_pool_t *pool);
+
+/** Closes all idle sessions of @a ctx, or all idle sessions if @a ctx is NULL. */
+extern void sessionpool_clear(svn_client_ctx_t *ctx);
+
+#endif /* !SVN_WFX_SESSIONPOOL_H_INCLUDED */
@@ -0,0 +1,616 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "snapshot.h"
+#include "intern.h"
+#include "stats.h"
+
+#include <apr_atomic.h>
+#include <apr_hash.h>
+#include <apr_md5.h>
+#include <apr_thread_mutex.h>
+#include <apr_time.h>
+
+#include <string.h>
+
+/*
+** Prototypes
+*/
+static void snapshot_append(Snapshot *snapshot, const char *name, const svn_dirent_t *dirent);
+static void snapshot_pack(Snapshot *snapshot);
+static size_t blockSize(const Snapshot *snapshot);
+static apr_uint32_t appendString(Snapshot *snapshot, const char *str);
+static apr_uint32_t addAuthor(Snapshot *snapshot, const char *author);
+static void insertAuthorIndex(Snapshot *snapshot, apr_uint32_t author);
+static apr_uint32_t hashName(const char *name);
+static size_t snapcache_make_key(char *buf, size_t size, const struct Location *location, const char *subPath, size_t subPathLen);
+static void snapcache_unlink(Snapshot *snapshot);
+static void snapcache_link_newest(Snapshot *snapshot);
+static void snapcache_trim(void);
+
+/*
+** Globals
+*/
+static const apr_uint32_t NoAuthor = SNAPSHOT_NO_AUTHOR;
+
+static struct
+{
+    apr_thread_mutex_t *mutex;
+    apr_hash_t *index;  /* key -> Snapshot */
+    Snapshot *newest;
+    Snapshot *oldest;
+    size_t count;
+    size_t capacity;
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+Snapshot *snapshot_create(const struct Location *location, const char *subPath, size_t subPathLen)
+{
+    Snapshot *snapshot = calloc(1, sizeof(*snapshot));
+    snapshot->location = location;
+    snapshot->refCount = 1;
+    snapshot->timestamp = apr_time_now();
+    snapshot->createdRev = -1;
+    snapshot->revision = (apr_uint32_t) -1;
+    snapshot->checkedAt = (apr_uint32_t) apr_time_sec(snapshot->timestamp);
+
+    /* key layout: location pointer, then the sub path */
+    snapshot->keyLen = sizeof(location) + subPathLen;
+    snapshot->key = malloc(snapshot->keyLen + 1);
+    memcpy(snapshot->key, &location, sizeof(location));
+    memcpy(snapshot->key + sizeof(location), subPath, subPathLen);
+    snapshot->key[snapshot->keyLen] = '\0';
+
+    snapshot->subPath.data = snapshot->key + sizeof(location);
+    snapshot->subPath.len = subPathLen;
+    stats_add(STAT_SNAPSHOTS, 1);
+    return snapshot;
+}
+
+/*--------------------------------------------------------------------------*/
+void snapshot_begin_stream(Snapshot *snapshot)
+{
+    apr_pool_create(&snapshot->streamPool, NULL);
+    apr_thread_mutex_create(&snapshot->streamMutex, APR_THREAD_MUTEX_DEFAULT, snapshot->streamPool);
+    apr_thread_cond_create(&snapshot->streamCond, snapshot->streamPool);
+}
+
+/*--------------------------------------------------------------------------*/
+void snapshot_fail(Snapshot *snapshot, const char *message)
+{
+    apr_thread_mutex_lock(snapshot->streamMutex);
+    snapshot->ended = 1;
+    snapshot->error = message ? strdup(message) : NULL;
+    apr_thread_cond_broadcast(snapshot->streamCond);
+    apr_thread_mutex_unlock(snapshot->streamMutex);
+}
+
+/*--------------------------------------------------------------------------*/
+int snapshot_read(Snapshot *snapshot, size_t i, snapshot_reader_t reader, void *baton)
+{
+    int result = 0;
+    if (!snapshot->streamMutex)
+    {
+        if (i < snapshot->count)
+        {
+            reader(snapshot, snapshot->entries + i, baton);
+            result = 1;
+        }
+        return result;
+    }
+
+    apr_thread_mutex_lock(snapshot->streamMutex);
+    while (i >= snapshot->count && !snapshot->ended)
+    {
+        apr_thread_cond_wait(snapshot->streamCond, snapshot->streamMutex);
+    }
+    if (i < snapshot->count)
+    {
+        reader(snapshot, snapshot->entries + i, baton);
+        result = 1;
+    }
+    apr_thread_mutex_unlock(snapshot->streamMutex);
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+int snapshot_finished(Snapshot *snapshot)
+{
+    int result;
+    if (!snapshot->streamMutex)
+    {
+        return snapshot->block || snapshot->mapPool;
+    }
+    apr_thread_mutex_lock(snapshot->streamMutex);
+    result = snapshot->block != NULL;
+    apr_thread_mutex_unlock(snapshot->streamMutex);
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+void snapshot_add(Snapshot *snapshot, const char *name, const svn_dirent_t *dirent)
+{
+    if (snapshot->streamMutex)
+    {
+        apr_thread_mutex_lock(snapshot->streamMutex);
+        snapshot_append(snapshot, name, dirent);
+        apr_thread_cond_broadcast(snapshot->streamCond);
+        apr_thread_mutex_unlock(snapshot->streamMutex);
+    }
+    else
+    {
+        snapshot_append(snapshot, name, dirent);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+void snapshot_finish(Snapshot *snapshot)
+{
+    if (snapshot->streamMutex)
+    {
+        apr_thread_mutex_lock(snapshot->streamMutex);
+        snapshot_pack(snapshot);
+        snapshot->ended = 1;
+        apr_thread_cond_broadcast(snapshot->streamCond);
+        apr_thread_mutex_unlock(snapshot->streamMutex);
+    }
+    else
+    {
+        snapshot_pack(snapshot);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+SVNObject *snapshot_find(const Snapshot *snapshot, const char *name)
+{
+    if (snapshot->index)
+    {
+        size_t slot = hashName(name) & snapshot->indexMask;
+        while (snapshot->index[slot])
+        {
+            SVNObject *obj = snapshot->entries + snapshot->index[slot] - 1;
+            if (!strcmp(snapshot->strings + obj->nameOffset, name))
+            {
+                return obj;
+            }
+            slot = (slot + 1) & snapshot->indexMask;
+        }
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+const char *snapshot_name(const Snapshot *snapshot, const SVNObject *obj)
+{
+    return snapshot->strings + obj->nameOffset;
+}
+
+/*--------------------------------------------------------------------------*/
+const char *snapshot_author(const Snapshot *snapshot, const SVNObject *obj)
+{
+    return obj->author != NoAuthor ? snapshot->authors[obj->author] : NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+void snapshot_set_checksums(Snapshot *snapshot, unsigned char *checksums)
+{
+    if (apr_atomic_casptr((volatile void**) &snapshot->checksums, checksums, NULL))
+    {
+        free(checksums);
+        return;
+    }
+    stats_add(STAT_SNAPSHOT_BYTES, (apr_uint32_t) (snapshot->count * APR_MD5_DIGESTSIZE));
+}
+
+/*--------------------------------------------------------------------------*/
+const unsigned char *snapshot_checksum(const Snapshot *snapshot, const SVNObject *obj)
+{
+    static const unsigned char Unknown[APR_MD5_DIGESTSIZE] = { 0 };
+    const unsigned char *checksums = snapshot->checksums;
+    const unsigned char *digest;
+
+    if (!checksums)
+    {
+        return NULL;
+    }
+    digest = checksums + (obj - snapshot->entries) * APR_MD5_DIGESTSIZE;
+    return memcmp(digest, Unknown, APR_MD5_DIGESTSIZE) ? digest : NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+void snapshot_confirm(Snapshot *snapshot, svn_revnum_t revision)
+{
+    apr_atomic_set32(&snapshot->revision, (apr_uint32_t) revision);
+    apr_atomic_set32(&snapshot->checkedAt, (apr_uint32_t) apr_time_sec(apr_time_now()));
+}
+
+/*--------------------------------------------------------------------------*/
+int snapshot_fresh(const Snapshot *snapshot, int ttl)
+{
+    const apr_uint32_t now = (apr_uint32_t) apr_time_sec(apr_time_now());
+    return snapshot->pinned || now - apr_atomic_read32((volatile apr_uint32_t*) &snapshot->checkedAt) < (apr_uint32_t) ttl;
+}
+
+/*--------------------------------------------------------------------------*/
+Snapshot *snapshot_acquire(Snapshot *snapshot)
+{
+    apr_atomic_inc32(&snapshot->refCount);
+    return snapshot;
+}
+
+/*--------------------------------------------------------------------------*/
+void snapshot_release(Snapshot *snapshot)
+{
+    if (snapshot && !apr_atomic_dec32(&snapshot->refCount))
+    {
+        apr_uint32_t i;
+        for (i = 0; i < snapshot->authorCount; ++i)
+        {
+            intern_release(snapshot->authors[i]);
+        }
+        if (snapshot->block)
+        {
+            stats_sub(STAT_SNAPSHOT_BYTES, (apr_uint32_t) blockSize(snapshot));
+            free(snapshot->block);
+        }
+        else if (snapshot->mapPool)
+        {
+            free((void*) snapshot->authors);
+            apr_pool_destroy(snapshot->mapPool);
+        }
+        else
+        {
+            /* never finished */
+            free(snapshot->entries);
+            free(snapshot->strings);
+            free((void*) snapshot->authors);
+            free(snapshot->authorIndex);
+        }
+        if (snapshot->streamPool)
+        {
+            apr_thread_cond_destroy(snapshot->streamCond);
+            apr_thread_mutex_destroy(snapshot->streamMutex);
+            apr_pool_destroy(snapshot->streamPool);
+        }
+        if (snapshot->checksums)
+        {
+            stats_sub(STAT_SNAPSHOT_BYTES, (apr_uint32_t) (snapshot->count * APR_MD5_DIGESTSIZE));
+            free(snapshot->checksums);
+        }
+        free(snapshot->error);
+        free(snapshot->key);
+        free(snapshot);
+        stats_sub(STAT_SNAPSHOTS, 1);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+void snapcache_init(apr_pool_t *pool)
+{
+    apr_thread_mutex_create(&Global.mutex, APR_THREAD_MUTEX_DEFAULT, pool);
+    Global.index = apr_hash_make(pool);
+}
+
+/*--------------------------------------------------------------------------*/
+void snapcache_set_capacity(size_t capacity)
+{
+    apr_thread_mutex_lock(Global.mutex);
+    Global.capacity = capacity;
+    snapcache_trim();
+    apr_thread_mutex_unlock(Global.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+Snapshot *snapcache_lookup(const struct Location *location, const char *subPath, size_t subPathLen)
+{
+    Snapshot *snapshot;
+    char buf[1024];
+    const size_t keyLen = snapcache_make_key(buf, sizeof(buf), location, subPath, subPathLen);
+
+    apr_thread_mutex_lock(Global.mutex);
+    snapshot = apr_hash_get(Global.index, buf, keyLen);
+    if (snapshot)
+    {
+        snapcache_unlink(snapshot);
+        snapcache_link_newest(snapshot);
+        snapshot_acquire(snapshot);
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+    return snapshot;
+}
+
+/*--------------------------------------------------------------------------*/
+int snapcache_contains(const struct Location *location, const char *subPath, size_t subPathLen)
+{
+    int result;
+    char buf[1024];
+    const size_t keyLen = snapcache_make_key(buf, sizeof(buf), location, subPath, subPathLen);
+
+    apr_thread_mutex_lock(Global.mutex);
+    result = apr_hash_get(Global.index, buf, keyLen) != NULL;
+    apr_thread_mutex_unlock(Global.mutex);
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+void snapcache_insert(Snapshot *snapshot)
+{
+    Snapshot *old;
+    apr_thread_mutex_lock(Global.mutex);
+    old = apr_hash_get(Global.index, snapshot->key, snapshot->keyLen);
+    if (Global.capacity && old != snapshot)
+    {
+        if (old)
+        {
+            snapcache_unlink(old);
+            apr_hash_set(Global.index, old->key, old->keyLen, NULL);
+            --Global.count;
+            snapshot_release(old);
+        }
+
+        apr_hash_set(Global.index, snapshot->key, snapshot->keyLen, snapshot_acquire(snapshot));
+        snapcache_link_newest(snapshot);
+        ++Global.count;
+        snapcache_trim();
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+Snapshot **snapcache_acquire_all(size_t *count)
+{
+    Snapshot **snapshots;
+    Snapshot *snapshot;
+    size_t n = 0;
+
+    apr_thread_mutex_lock(Global.mutex);
+    snapshots = malloc((Global.count + 1) * sizeof(*snapshots));
+    for (snapshot = Global.newest; snapshot; snapshot = snapshot->older)
+    {
+        snapshots[n++] = snapshot_acquire(snapshot);
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+    *count = n;
+    return snapshots;
+}
+
+/*--------------------------------------------------------------------------*/
+void snapcache_clear(const struct Location *location)
+{
+    Snapshot *snapshot, *newer;
+    apr_thread_mutex_lock(Global.mutex);
+    for (snapshot = Global.oldest; snapshot; snapshot = newer)
+    {
+        newer = snapshot->newer;
+        if (!location || snapshot->location == location)
+        {
+            snapcache_unlink(snapshot);
+            apr_hash_set(Global.index, snapshot->key, snapshot->keyLen, NULL);
+            --Global.count;
+            snapshot_release(snapshot);
+        }
+    }
+    apr_thread_mutex_unlock(Global.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+static void snapshot_append(Snapshot *snapshot, const char *name, const svn_dirent_t *dirent)
+{
+    SVNObject *obj;
+    if (snapshot->count == snapshot->capacity)
+    {
+        snapshot->capacity = snapshot->capacity ? snapshot->capacity * 2 : 64;
+        snapshot->entries = realloc(snapshot->entries, snapshot->capacity * sizeof(*snapshot->entries));
+    }
+    obj = snapshot->entries + snapshot->count++;
+    obj->size = dirent->size;
+    obj->time = dirent->time;
+    obj->createdRev = dirent->created_rev;
+    obj->kind = dirent->kind;
+    obj->nameOffset = appendString(snapshot, name);
+    obj->author = dirent->last_author ? addAuthor(snapshot, dirent->last_author) : NoAuthor;
+}
+
+/*--------------------------------------------------------------------------*/
+static void snapshot_pack(Snapshot *snapshot)
+{
+    size_t indexSize = 16;
+    size_t entriesBytes, authorsBytes, indexBytes, i;
+    char *block;
+
+    /* keep the load factor at or below 50% */
+    while (indexSize < snapshot->count * 2) indexSize <<= 1;
+    entriesBytes = snapshot->count * sizeof(*snapshot->entries);
+    authorsBytes = snapshot->authorCount * sizeof(*snapshot->authors);
+    indexBytes = indexSize * sizeof(*snapshot->index);
+
+    /* layout: entries, authors, index, strings */
+    block = malloc(entriesBytes + authorsBytes + indexBytes + snapshot->stringsLen);
+    if (snapshot->count)
+    {
+        memcpy(block, snapshot->entries, entriesBytes);
+        memcpy(block + entriesBytes + authorsBytes + indexBytes, snapshot->strings, snapshot->stringsLen);
+    }
+    if (snapshot->authorCount)
+    {
+        memcpy(block + entriesBytes, snapshot->authors, authorsBytes);
+    }
+    memset(block + entriesBytes + authorsBytes, 0, indexBytes);
+    free(snapshot->entries);
+    free(snapshot->strings);
+    free((void*) snapshot->authors);
+    free(snapshot->authorIndex);
+    snapshot->authorIndex = NULL;
+
+    snapshot->block = block;
+    snapshot->entries = (SVNObject*) block;
+    snapshot->authors = (const char**) (block + entriesBytes);
+    snapshot->index = (apr_uint32_t*) (block + entriesBytes + authorsBytes);
+    snapshot->indexMask = indexSize - 1;
+    snapshot->strings = block + entriesBytes + authorsBytes + indexBytes;
+    snapshot->capacity = snapshot->count;
+    snapshot->stringsCapacity = snapshot->stringsLen;
+    stats_add(STAT_SNAPSHOT_BYTES, (apr_uint32_t) blockSize(snapshot));
+
+    for (i = 0; i < snapshot->count; ++i)
+    {
+        size_t slot = hashName(snapshot->strings + snapshot->entries[i].nameOffset) & snapshot->indexMask;
+        while (snapshot->index[slot])
+        {
+            slot = (slot + 1) & snapshot->indexMask;
+        }
+        snapshot->index[slot] = (apr_uint32_t) i + 1;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static size_t blockSize(const Snapshot *snapshot)
+{
+    return snapshot->count * sizeof(*snapshot->entries) + snapshot->authorCount * sizeof(*snapshot->authors)
+           + (snapshot->indexMask + 1) * sizeof(*snapshot->index) + snapshot->stringsLen;
+}
+
+/*--------------------------------------------------------------------------*/
+static apr_uint32_t appendString(Snapshot *snapshot, const char *str)
+{
+    const size_t len = strlen(str) + 1;
+    const apr_uint32_t offset = (apr_uint32_t) snapshot->stringsLen;
+    if (snapshot->stringsLen + len > snapshot->stringsCapacity)
+    {
+        do
+        {
+            snapshot->stringsCapacity = snapshot->stringsCapacity ? snapshot->stringsCapacity * 2 : 4096;
+        } while (snapshot->stringsLen + len > snapshot->stringsCapacity);
+        snapshot->strings = realloc(snapshot->strings, snapshot->stringsCapacity);
+    }
+    memcpy(snapshot->strings + snapshot->stringsLen, str, len);
+    snapshot->stringsLen += len;
+    return offset;
+}
+
+/*--------------------------------------------------------------------------*/
+static apr_uint32_t addAuthor(Snapshot *snapshot, const char *author)
+{
+    /* each distinct author is interned once per snapshot, repeated authors
+       are resolved through the local index without touching the intern table */
+    if (snapshot->authorIndex)
+    {
+        apr_uint32_t slot = hashName(author) & snapshot->authorIndexMask;
+        while (snapshot->authorIndex[slot])
+        {
+            const apr_uint32_t i = snapshot->authorIndex[slot] - 1;
+            if (!strcmp(snapshot->authors[i], author))
+            {
+                return i;
+            }
+            slot = (slot + 1) & snapshot->authorIndexMask;
+        }
+    }
+
+    if (!(snapshot->authorCount & (snapshot->authorCount - 1)))
+    {
+        /* authorCount is zero or a power of two, grow the table and rebuild the index */
+        apr_uint32_t i;
+        const apr_uint32_t size = snapshot->authorCount ? snapshot->authorCount * 4 : 16;
+        snapshot->authors = realloc((void*) snapshot->authors, (snapshot->authorCount ? snapshot->authorCount * 2 : 1) * sizeof(*snapshot->authors));
+        free(snapshot->authorIndex);
+        snapshot->authorIndex = calloc(size, sizeof(*snapshot->authorIndex));
+        snapshot->authorIndexMask = size - 1;
+        for (i = 0; i < snapshot->authorCount; ++i)
+        {
+            insertAuthorIndex(snapshot, i);
+        }
+    }
+    snapshot->authors[snapshot->authorCount] = intern_acquire(author);
+    insertAuthorIndex(snapshot, snapshot->authorCount);
+    return snapshot->authorCount++;
+}
+
+/*--------------------------------------------------------------------------*/
+static void insertAuthorIndex(Snapshot *snapshot, apr_uint32_t author)
+{
+    apr_uint32_t slot = hashName(snapshot->authors[author]) & snapshot->authorIndexMask;
+    while (snapshot->authorIndex[slot])
+    {
+        slot = (slot + 1) & snapshot->authorIndexMask;
+    }
+    snapshot->authorIndex[slot] = author + 1;
+}
+
+/*--------------------------------------------------------------------------*/
+static apr_uint32_t hashName(const char *name)
+{
+    /* FNV-1a */
+    apr_uint32_t hash = 2166136261u;
+    while (*name)
+    {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*--------------------------------------------------------------------------*/
+static size_t snapcache_make_key(char *buf, size_t size, const struct Location *location, const char *subPath, size_t subPathLen)
+{
+    strbuf_t s = { buf, size };
+    strbuf_cat(&s, (const char*) &location, sizeof(location));
+    strbuf_cat(&s, subPath, subPathLen);
+    return s.data - buf;
+}
+
+/*--------------------------------------------------------------------------*/
+static void snapcache_unlink(Snapshot *snapshot)
+{
+    if (snapshot->newer)
+        snapshot->newer->older = snapshot->older;
+    else
+        Global.newest = snapshot->older;
+
+    if (snapshot->older)
+        snapshot->older->newer = snapshot->newer;
+    else
+        Global.oldest = snapshot->newer;
+
+    snapshot->newer = snapshot->older = NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+static void snapcache_link_newest(Snapshot *snapshot)
+{
+    snapshot->newer = NULL;
+    snapshot->older = Global.newest;
+    if (Global.newest)
+        Global.newest->newer = snapshot;
+    else
+        Global.oldest = snapshot;
+    Global.newest = snapshot;
+}
+
+/*--------------------------------------------------------------------------*/
+static void snapcache_trim(void)
+{
+    while (Global.count > Global.capacity)
+    {
+        Snapshot *snapshot = Global.oldest;
+        snapcache_unlink(snapshot);
+        apr_hash_set(Global.index, snapshot->key, snapshot->keyLen, NULL);
+        --Global.count;
+        snapshot_release(snapshot);
+    }
+}
@@ -0,0 +1,212 @@
+#ifndef SVN_WFX_SNAPSHOT_H_INCLUDED
+#define SVN_WFX_SNAPSHOT_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "strbuf.h"
+
+#include <svn_types.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+
+struct Location;
+
+/** SVNObject.author of entries without a known author */
+#define SNAPSHOT_NO_AUTHOR 0xFFFFFFFF
+
+/** A single directory entry. The name is stored as an offset into the
+    snapshot's string blob, the author as an index into the snapshot's table
+    of interned authors, see snapshot_name and snapshot_author. */
+typedef struct SVNObject
+{
+    apr_int64_t size;
+    apr_int64_t time;
+    apr_int32_t createdRev;
+    apr_uint32_t nameOffset;
+    apr_uint32_t author;        /* index into Snapshot.authors, SNAPSHOT_NO_AUTHOR if unknown */
+    apr_uint32_t kind;          /* svn_node_kind_t */
+} SVNObject;
+
+/** Directory listing of a single remote directory. Snapshots are reference
+    counted and shared between find handles, content columns and the cache. */
+typedef struct Snapshot
+{
+    const struct Location *location;
+    String subPath;          /* '/'-separated, no trailing slash, empty for the location root */
+    SVNObject *entries;      /* entry records in listing order */
+    size_t count;            /* number of entries */
+    char *strings;           /* zero-terminated entry names */
+    const char **authors;    /* distinct authors of this snapshot, interned */
+    apr_uint32_t authorCount;
+    apr_uint32_t *index;     /* open addressing hash table by name, holds entry index + 1 or 0 if empty */
+    size_t indexMask;        /* index size - 1 */
+    void *block;             /* single allocation holding entries, authors, index and strings once finished */
+    apr_pool_t *mapPool;     /* owns the file mapping holding entries, index and strings if loaded by diskcache_load */
+    apr_uint32_t *authorIndex;  /* open addressing hash table of authors while building */
+    apr_uint32_t authorIndexMask;
+    size_t capacity;         /* allocated entries while building */
+    size_t stringsLen;       /* used string blob bytes while building */
+    size_t stringsCapacity;  /* allocated string blob bytes while building */
+    apr_time_t timestamp;    /* time of the listing */
+    apr_int32_t createdRev;  /* created revision of the listed directory itself, -1 if unknown */
+    volatile apr_uint32_t revision;   /* youngest revision the listing was last confirmed at, (apr_uint32_t) -1 if never */
+    volatile apr_uint32_t checkedAt;  /* apr_time_sec of the listing or its last confirmation */
+    int pinned;              /* listed at the location's peg revision, so it never becomes outdated */
+    volatile apr_uint32_t revisionsFetched;  /* the revision details of the entries have been fetched or failed to, see revinfo_lookup */
+    unsigned char *volatile checksums;       /* MD5 digests of the entries once fetched, see snapshot_checksum */
+    volatile apr_uint32_t checksumsFetched;  /* the checksums have been fetched or failed to */
+    apr_pool_t *streamPool;  /* streaming state, see snapshot_begin_stream */
+    apr_thread_mutex_t *streamMutex;
+    apr_thread_cond_t *streamCond;
+    int ended;               /* streamed listing has finished or failed */
+    char *error;             /* error message of a failed streamed listing */
+    volatile apr_uint32_t refCount;
+    char *key;               /* cache key, see snapshot_create */
+    size_t keyLen;
+    struct Snapshot *newer;  /* LRU list links, only valid while cached */
+    struct Snapshot *older;
+} Snapshot;
+
+/** Creates an empty snapshot with a reference count of one.
+    @param location The location the snapshot belongs to.
+    @param subPath The normalized sub path inside @a location. Need not be zero-terminated.
+    @param subPathLen The length of @a subPath.
+    @return The new snapshot. */
+extern Snapshot *snapshot_create(const struct Location *location, const char *subPath, size_t subPathLen);
+
+/** Callback for snapshot_read.
+    @param snapshot The snapshot.
+    @param obj The requested entry.
+    @param baton The baton passed to snapshot_read. */
+typedef void (*snapshot_reader_t)(const Snapshot *snapshot, const SVNObject *obj, void *baton);
+
+/** Allows entries of @a snapshot to be read through snapshot_read while
+    another thread is still adding them. The stream ends with snapshot_finish
+    or snapshot_fail.
+    @param snapshot An empty snapshot. */
+extern void snapshot_begin_stream(Snapshot *snapshot);
+
+/** Ends a streamed listing that could not be completed and wakes up all readers.
+    @param snapshot The streamed snapshot.
+    @param message The error message, may be NULL. */
+extern void snapshot_fail(Snapshot *snapshot, const char *message);
+
+/** Reads entry @a i of @a snapshot, waiting for it to arrive if the snapshot
+    is being streamed.
+    @param snapshot The snapshot.
+    @param i The entry index.
+    @param reader Called with the entry. While it runs, no entries are added.
+    @param baton Passed to @a reader.
+    @return Non-zero if @a reader was called, zero if the listing has ended
+            with less than @a i + 1 entries. */
+extern int snapshot_read(Snapshot *snapshot, size_t i, snapshot_reader_t reader, void *baton);
+
+/** @return Non-zero if snapshot_finish has been called on @a snapshot, so that
+    all of its entries may be accessed directly. */
+extern int snapshot_finished(Snapshot *snapshot);
+
+/** Adds an entry to @a snapshot. Only valid until snapshot_finish is called.
+    @param snapshot The snapshot.
+    @param name The entry name.
+    @param dirent The entry's properties. */
+extern void snapshot_add(Snapshot *snapshot, const char *name, const svn_dirent_t *dirent);
+
+/** Packs the entries, their strings and a name index of @a snapshot into a
+    single allocation. Call once after all entries have been added.
+    @param snapshot The snapshot. */
+extern void snapshot_finish(Snapshot *snapshot);
+
+/** Looks up an entry by name in O(1).
+    @param snapshot A finished snapshot.
+    @param name The zero-terminated entry name.
+    @return The entry, or NULL if there is no entry named @a name. */
+extern SVNObject *snapshot_find(const Snapshot *snapshot, const char *name);
+
+/** @return The zero-terminated name of @a obj. */
+extern const char *snapshot_name(const Snapshot *snapshot, const SVNObject *obj);
+
+/** @return The zero-terminated, interned last author of @a obj, or NULL if unknown. */
+extern const char *snapshot_author(const Snapshot *snapshot, const SVNObject *obj);
+
+/** Attaches the MD5 digests of the file contents to @a snapshot, unless
+    another thread has attached them already. Thread-safe.
+    @param snapshot A finished snapshot.
+    @param checksums APR_MD5_DIGESTSIZE bytes per entry in entry order, all
+                     zero if the checksum of an entry is unknown. Allocated
+                     with malloc, @a snapshot takes ownership. */
+extern void snapshot_set_checksums(Snapshot *snapshot, unsigned char *checksums);
+
+/** @return The APR_MD5_DIGESTSIZE bytes MD5 digest of the contents of @a obj,
+    or NULL if it is unknown or has not been attached yet. */
+extern const unsigned char *snapshot_checksum(const Snapshot *snapshot, const SVNObject *obj);
+
+/** Records that @a snapshot still matches the repository.
+    @param snapshot The snapshot.
+    @param revision The youngest revision of the repository at the time of the check. */
+extern void snapshot_confirm(Snapshot *snapshot, svn_revnum_t revision);
+
+/** @return Non-zero if @a snapshot is pinned, or was listed or confirmed less than @a ttl seconds ago. */
+extern int snapshot_fresh(const Snapshot *snapshot, int ttl);
+
+/** Increments the reference count of @a snapshot. Reference counting is thread-safe.
+    @return @a snapshot */
+extern Snapshot *snapshot_acquire(Snapshot *snapshot);
+
+/** Decrements the reference count of @a snapshot and destroys it when it drops to zero.
+    @param snapshot The snapshot, may be NULL. */
+extern void snapshot_release(Snapshot *snapshot);
+
+/** Initializes the snapshot cache. Must be called before any other snapcache function.
+    All snapcache functions are thread-safe.
+    @param pool The pool to allocate the cache from. */
+extern void snapcache_init(apr_pool_t *pool);
+
+/** Sets the maximum amount of snapshots kept in the cache, evicting the
+    least recently used ones if necessary.
+    @param capacity The new capacity. Zero disables caching. */
+extern void snapcache_set_capacity(size_t capacity);
+
+/** Looks up a cached snapshot and marks it as most recently used.
+    @param location The location.
+    @param subPath The normalized sub path. Need not be zero-terminated.
+    @param subPathLen The length of @a subPath.
+    @return The snapshot with an additional reference the caller must release,
+            or NULL if it is not cached. */
+extern Snapshot *snapcache_lookup(const struct Location *location, const char *subPath, size_t subPathLen);
+
+/** @return Non-zero if a snapshot for the given directory is cached. Unlike
+    snapcache_lookup, this does not affect the LRU order. */
+extern int snapcache_contains(const struct Location *location, const char *subPath, size_t subPathLen);
+
+/** Adds @a snapshot to the cache, replacing any snapshot of the same directory.
+    The cache takes its own reference; the caller's reference is left untouched.
+    @param snapshot The snapshot to cache. */
+extern void snapcache_insert(Snapshot *snapshot);
+
+/** Takes a reference to every cached snapshot, most recently used first.
+    @param count Receives the number of snapshots.
+    @return An array of @a count snapshots that must be released, then freed with free. */
+extern Snapshot **snapcache_acquire_all(size_t *count);
+
+/** Drops cached snapshots. Snapshots still referenced elsewhere stay alive
+    until released.
+    @param location Drop only the snapshots of this location, NULL for all. */
+extern void snapcache_clear(const struct Location *location);
+
+#endif /* !SVN_WFX_SNAPSHOT_H_INCLUDED */
@@ -0,0 +1,180 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stats.h"
+
+#include <apr_atomic.h>
+#include <apr_strings.h>
+
+/*
+** Prototypes
+*/
+
+/** Adds a successful or failed request to @a histogram. */
+static void record(StatHistogram *histogram, apr_time_t start, int failed);
+
+/** Appends a line summarizing @a histogram to @a report. */
+static void reportHistogram(svn_stringbuf_t *report, const char *name, const StatHistogram *histogram);
+
+/** @return The bound of the bucket holding the fraction @a q of the @a count
+    requests in @a histogram, as "< n ms" or, for the last bucket, which has
+    no upper bound, as ">= n ms". Allocated from @a pool. */
+static const char *percentile(const StatHistogram *histogram, apr_uint32_t count, double q, apr_pool_t *pool);
+
+/*
+** Globals
+*/
+static const char * const CounterNames[STAT_MAX] =
+{
+    "Listings served from memory",
+    "Outdated listings confirmed unchanged",
+    "Listings loaded from disk",
+    "Listings fetched",
+    "Files copied from the file store",
+    "Column values requested",
+    "Revision log requests",
+    "Checksum requests",
+    "Column values delayed",
+    "Snapshots alive",
+    "Snapshot heap bytes"
+};
+
+static struct
+{
+    volatile apr_uint32_t counters[STAT_MAX];
+    apr_time_t started;
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+void stats_init(void)
+{
+    Global.started = apr_time_now();
+}
+
+/*--------------------------------------------------------------------------*/
+void stats_add(StatCounter counter, apr_uint32_t n)
+{
+    apr_atomic_add32(&Global.counters[counter], n);
+}
+
+/*--------------------------------------------------------------------------*/
+void stats_sub(StatCounter counter, apr_uint32_t n)
+{
+    apr_atomic_sub32(&Global.counters[counter], n);
+}
+
+/*--------------------------------------------------------------------------*/
+void stats_record_listing(LocationStats *stats, apr_time_t start, int failed)
+{
+    record(&stats->listings, start, failed);
+}
+
+/*--------------------------------------------------------------------------*/
+void stats_record_download(LocationStats *stats, apr_time_t start, apr_int64_t bytes, int failed)
+{
+    record(&stats->downloads, start, failed);
+    apr_atomic_add32(&stats->downloadedKB, (apr_uint32_t) ((bytes + 512) >> 10));
+}
+
+/*--------------------------------------------------------------------------*/
+void stats_report(svn_stringbuf_t *report)
+{
+    int i;
+    svn_stringbuf_appendcstr(report, apr_psprintf(report->pool, "svn_wfx statistics of the last %" APR_INT64_T_FMT " seconds\r\n\r\n",
+                                                  apr_time_sec(apr_time_now() - Global.started)));
+    for (i = 0; i < STAT_MAX; ++i)
+    {
+        svn_stringbuf_appendcstr(report, apr_psprintf(report->pool, "%-40s %10u\r\n", CounterNames[i], apr_atomic_read32(&Global.counters[i])));
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+void stats_report_location(svn_stringbuf_t *report, const char *title, const char *url, const LocationStats *stats)
+{
+    svn_stringbuf_appendcstr(report, apr_psprintf(report->pool, "\r\n%s (%s)\r\n", title, url));
+    reportHistogram(report, "Listings", &stats->listings);
+    reportHistogram(report, "Downloads", &stats->downloads);
+    svn_stringbuf_appendcstr(report, apr_psprintf(report->pool, "  %-10s %10u KB\r\n", "Received", stats->downloadedKB));
+}
+
+/*--------------------------------------------------------------------------*/
+static void record(StatHistogram *histogram, apr_time_t start, int failed)
+{
+    const apr_uint32_t ms = (apr_uint32_t) apr_time_as_msec(apr_time_now() - start);
+    int bucket = 0;
+
+    if (failed)
+    {
+        apr_atomic_inc32(&histogram->failures);
+        return;
+    }
+    while (bucket < STATS_BUCKETS - 1 && ms >> bucket)
+    {
+        ++bucket;
+    }
+    apr_atomic_inc32(&histogram->buckets[bucket]);
+    /* no 64 bit atomics in APR, so carry into the high word by hand */
+    if (apr_atomic_add32(&histogram->totalMs, ms) + ms < ms)
+    {
+        apr_atomic_inc32(&histogram->totalMsHigh);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void reportHistogram(svn_stringbuf_t *report, const char *name, const StatHistogram *histogram)
+{
+    apr_uint32_t count = 0;
+    apr_uint64_t totalMs;
+    int i;
+
+    for (i = 0; i < STATS_BUCKETS; ++i)
+    {
+        count += histogram->buckets[i];
+    }
+    svn_stringbuf_appendcstr(report, apr_psprintf(report->pool, "  %-10s %10u ok %6u failed", name, count, histogram->failures));
+    if (count)
+    {
+        /* percentiles are only known up to their bucket */
+        totalMs = ((apr_uint64_t) histogram->totalMsHigh << 32) | histogram->totalMs;
+        svn_stringbuf_appendcstr(report, apr_psprintf(report->pool, "   avg %u ms   p50 %s   p90 %s   p99 %s",
+                                                      (apr_uint32_t) (totalMs / count),
+                                                      percentile(histogram, count, 0.5, report->pool),
+                                                      percentile(histogram, count, 0.9, report->pool),
+                                                      percentile(histogram, count, 0.99, report->pool)));
+    }
+    svn_stringbuf_appendcstr(report, "\r\n");
+}
+
+/*--------------------------------------------------------------------------*/
+static const char *percentile(const StatHistogram *histogram, apr_uint32_t count, double q, apr_pool_t *pool)
+{
+    const apr_uint32_t rank = (apr_uint32_t) (count * q);
+    apr_uint32_t seen = 0;
+    int i;
+
+    for (i = 0; i < STATS_BUCKETS - 1; ++i)
+    {
+        seen += histogram->buckets[i];
+        if (seen > rank)
+        {
+            return apr_psprintf(pool, "< %u ms", 1u << i);
+        }
+    }
+    /* the last bucket has no upper bound */
+    return apr_psprintf(pool, ">= %u ms", 1u << (STATS_BUCKETS - 2));
+}
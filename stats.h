@@ -0,0 +1,97 @@
+#ifndef SVN_WFX_STATS_H_INCLUDED
+#define SVN_WFX_STATS_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <svn_string.h>
+#include <apr_time.h>
+
+/** Number of latency buckets. Bucket i counts durations below 2^i ms, the
+    last one everything from 2^(STATS_BUCKETS - 2) ms (32.768 s) on. */
+#define STATS_BUCKETS 17
+
+/** Global counters, see stats_add. */
+typedef enum StatCounter
+{
+    STAT_CACHE_HITS,        /* listings served from memory */
+    STAT_CACHE_CONFIRMED,   /* outdated listings the server confirmed as unchanged */
+    STAT_DISK_HITS,         /* listings loaded from the disk cache */
+    STAT_CACHE_MISSES,      /* listings that had to be fetched */
+    STAT_STORE_HITS,        /* files copied from the local file store */
+    STAT_FIELD_LOOKUPS,     /* custom column values requested */
+    STAT_REVISION_LOGS,     /* log requests for the revision details of a listing */
+    STAT_CHECKSUM_REPORTS,  /* status reports for the checksums of a listing */
+    STAT_DELAYED_FIELDS,    /* column values left to TC's background thread */
+    STAT_SNAPSHOTS,         /* snapshots alive */
+    STAT_SNAPSHOT_BYTES,    /* heap bytes of finished snapshots, mapped ones excluded */
+    STAT_MAX
+} StatCounter;
+
+/** Latency distribution of one kind of request. */
+typedef struct StatHistogram
+{
+    volatile apr_uint32_t buckets[STATS_BUCKETS];  /* successful requests by duration */
+    volatile apr_uint32_t failures;                /* failed or cancelled requests */
+    volatile apr_uint32_t totalMs;                 /* duration of all successful requests, low word */
+    volatile apr_uint32_t totalMsHigh;             /* high word, incremented whenever totalMs wraps */
+} StatHistogram;
+
+/** Per-location request statistics. */
+typedef struct LocationStats
+{
+    StatHistogram listings;           /* directory listings */
+    StatHistogram downloads;          /* file downloads */
+    volatile apr_uint32_t downloadedKB;
+} LocationStats;
+
+/** Records the start time reported by stats_report. All counters are
+    updated with atomic operations, so all stats functions are thread-safe
+    and cheap enough for the hot paths. */
+extern void stats_init(void);
+
+/** Adds @a n to a global counter. */
+extern void stats_add(StatCounter counter, apr_uint32_t n);
+
+/** Subtracts @a n from a global counter. */
+extern void stats_sub(StatCounter counter, apr_uint32_t n);
+
+/** Records a directory listing.
+    @param stats The statistics of the listed location.
+    @param start The time the listing was started.
+    @param failed Non-zero if the listing failed. */
+extern void stats_record_listing(LocationStats *stats, apr_time_t start, int failed);
+
+/** Records a file download.
+    @param stats The statistics of the location.
+    @param start The time the download was started.
+    @param bytes The number of bytes received, even if the download failed.
+    @param failed Non-zero if the download failed. */
+extern void stats_record_download(LocationStats *stats, apr_time_t start, apr_int64_t bytes, int failed);
+
+/** Appends the global counters as text to @a report. Lines end with CRLF. */
+extern void stats_report(svn_stringbuf_t *report);
+
+/** Appends the statistics of a location as text to @a report.
+    @param report The report.
+    @param title The zero-terminated title of the location.
+    @param url The zero-terminated URL of the location.
+    @param stats The statistics of the location. */
+extern void stats_report_location(svn_stringbuf_t *report, const char *title, const char *url, const LocationStats *stats);
+
+#endif /* !SVN_WFX_STATS_H_INCLUDED */
@@ -21,6 +21,13 @@
 
 #include <stdlib.h>
 
+/** String with known length */
+typedef struct String
+{
+   char *data;
+   size_t len;
+} String;
+
 /** Zero-terminated string buffer for efficient and safe concatenation into a char array */
 typedef struct strbuf_t
 {
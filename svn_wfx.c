@@ -19,10 +19,30 @@
 #include "svn_wfx.h"
 #include "tproc.h"
 #include "strbuf.h"
+#include "snapshot.h"
+#include "diskcache.h"
+#include "filestore.h"
+#include "nameindex.h"
+#include "location.h"
+#include "stats.h"
+#include "trace.h"
+#include "intern.h"
+#include "revinfo.h"
+#include "diffsum.h"
+#include "worker.h"
+#include "sessionpool.h"
 
 #include <svn_client.h>
 #include <svn_fs.h>
+#include <svn_path.h>
 #include <svn_pools.h>
+#include <svn_props.h>
+#include <svn_ra.h>
+#include <apr_atomic.h>
+#include <apr_md5.h>
+#include <apr_portable.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_proc.h>
 
 #include <Userenv.h>
 
@@ -31,12 +51,6 @@
 /*
 ** Types
 */
-typedef struct String
-{
-   char *data;
-   size_t len;
-} String;
-
 typedef struct Field
 {
     String name;
@@ -45,69 +59,592 @@ typedef struct Field
     SortOrder sortOrder;
 } Field;
 
-typedef struct Location
+typedef struct FindHandle
+{
+    Snapshot *snapshot;
+    size_t current;
+} FindHandle;
+
+typedef struct ListJob
+{
+    WorkerJob job;
+    const Location *location;
+    int refresh;      /* list even if the directory is cached */
+    int subtree;      /* prefetch all subdirectories once listed, see Prefetch.subtree */
+    int running;      /* taken by a worker, flags set from now on may be missed */
+    char *subPath;    /* points into key */
+    size_t subPathLen;
+    size_t keyLen;
+    char key[1];      /* location pointer followed by the sub path, keys Prefetch.pending, allocated past the end of the struct */
+} ListJob;
+
+typedef struct StreamJob
+{
+    WorkerJob job;
+    Snapshot *snapshot;
+} StreamJob;
+
+typedef struct Transfer
+{
+    apr_file_t *file;         /* the local file */
+    svn_stream_t *out;        /* writes to file, see fetchFile */
+    const char *remoteName;   /* shown in TC's progress dialog, NULL for background downloads */
+    const char *localName;
+    apr_int64_t size;         /* expected size, 0 if unknown */
+    apr_int64_t done;         /* bytes written */
+    apr_time_t nextReport;    /* throttles progress reports */
+    svn_revnum_t revision;    /* revision to download, SVN_INVALID_REVNUM for HEAD */
+    svn_revnum_t createdRev;  /* created revision of the downloaded contents, SVN_INVALID_REVNUM if unknown */
+} Transfer;
+
+typedef struct DownloadJob
+{
+    WorkerJob job;
+    const Location *location;
+    apr_pool_t *pool;  /* owns the job, its open local file and its strings */
+    Transfer transfer;
+    char *url;         /* escaped */
+    char *remoteName;  /* without leading backslash, keys Download.jobs */
+    char *localName;   /* temporary file next to the expected target, moved into place by awaitDownload */
+    int finished;      /* guarded by Download.mutex */
+    svn_error_t *err;  /* the error the download failed with, valid once finished */
+} DownloadJob;
+
+typedef struct ColumnJob
+{
+    WorkerJob job;
+    const Location *location;
+    size_t subPathLen;
+    int details;       /* ColumnDetails */
+    char *dirPath;     /* TC path of the directory without leading backslash, keys Columns.pending[details] */
+    size_t dirPathLen;
+    char subPath[1];   /* allocated past the end of the struct, followed by dirPath */
+} ColumnJob;
+
+typedef struct IndexJob
+{
+    WorkerJob job;
+    const Location *location;
+} IndexJob;
+
+typedef struct FoundFiles
 {
-    String title, url;
-    struct Location *next;
-} Location;
+    strbuf_t text;     /* the first matches, one per line */
+    int shown;         /* number of matches in text */
+} FoundFiles;
 
-typedef struct SVNObject
+typedef struct DiffReport
 {
-    char *name;
-    svn_dirent_t dirent;
-    struct SVNObject *next;
-} SVNObject;
+    FoundFiles found;  /* the first differences, one per line */
+    int count;         /* number of differences */
+} DiffReport;
 
-typedef struct Snapshot
+typedef struct RevisionSet
 {
     const Location *location;
-    String subPath;
-    SVNObject *entries;
-    SVNObject *current;
-} Snapshot;
+    svn_revnum_t *revisions;  /* distinct, ascending */
+    size_t count;
+} RevisionSet;
+
+typedef struct ChecksumReport
+{
+    Snapshot *snapshot;
+    unsigned char *checksums;  /* APR_MD5_DIGESTSIZE bytes per entry of snapshot */
+} ChecksumReport;
+
+typedef struct InfoResult
+{
+    svn_revnum_t rev;             /* youngest revision */
+    svn_revnum_t lastChangedRev;
+} InfoResult;
+
+typedef struct Option
+{
+    String name;
+    int *value;
+    int defaultValue;
+} Option;
+
+/* flags for getSnapshot */
+enum SnapshotFlags
+{
+    SF_REVALIDATE = 1,  /* list cached snapshots older than cache_ttl again */
+    SF_STREAM     = 2   /* on a cache miss, return a snapshot that is still being listed */
+};
 
 enum FieldIndices
 {
     FI_REVISION,
     FI_AUTHOR,
+    FI_MESSAGE,
+    FI_DATE,
+    FI_CHANGES,
+    FI_DIFF,
+    FI_CHECKSUM,
     FI_MAX
 };
 
+/* details of a listing that column jobs fetch in bulk */
+enum ColumnDetails
+{
+    CD_REVISIONS,  /* revision details of the entries, see fetchRevisions */
+    CD_CHECKSUMS,  /* checksums of the files, see fetchChecksums */
+    CD_MAX
+};
+
 
 /*
 ** Prototypes
 */
 
-/** @return an escaped representation of @a uri, allocated from @a pool. */
-static char *escapeURI(const char *uri, apr_pool_t *pool);
-
-/** Callback for svn_client_list2 */
-static svn_error_t* list_func(Snapshot *snapshot,
-                              const char *path,
-                              const svn_dirent_t  *dirent,
-                              const svn_lock_t  *lock,
-                              const char *abs_path,
-                              apr_pool_t *pool);
-
-/** Queries the server for a directory listing of @a path and stores the
-    result in @a snapshot. If this function fails, the contents of @a
-    snapshot are undefined.
-    @param snapshot The destination snapshot.
+/** Implements FsFindFirst, which records it as a trace span. */
+static HANDLE findFirst(char *path, WIN32_FIND_DATA *findData);
+
+/** Implements FsFindNext, which records it as a trace span. */
+static BOOL findNext(HANDLE handle, WIN32_FIND_DATA *findData);
+
+/** Implements FsFindClose, which records it as a trace span. */
+static int findClose(HANDLE handle);
+
+/** Implements FsGetFile, which records it as a trace span. */
+static int getFile(char *remoteName, char *localName, int copyFlags, RemoteInfoStruct *ri);
+
+/** Implements FsStatusInfo, which records it as a trace span. */
+static void statusInfo(char *remoteDir, int infoStartEnd, int infoOperation);
+
+/** Implements FsContentGetValue, which records it as a trace span. */
+static int getValue(char *fileName, int fieldIndex, int unitIndex, void *fieldValue, int maxLen, int flags);
+
+/** Implements FsExecuteFile, which records it as a trace span. */
+static ExecResult executeFile(HWND mainWin, char *remoteName, char *verb);
+
+/** Lists the session's directory into the Snapshot @a baton. @see session_func_t */
+static svn_error_t *listDirectory(svn_ra_session_t *session, void *baton, apr_pool_t *pool);
+
+/** Retrieves the youngest revision and the last changed revision of the
+    session's directory into the InfoResult @a baton. @see session_func_t */
+static svn_error_t *statDirectory(svn_ra_session_t *session, void *baton, apr_pool_t *pool);
+
+/** Fetches the log of the repository root for the revisions of a
+    RevisionSet @a baton and stores the details of every revision received.
+    Close revisions share a request, which spans at most MaxRevisionRun
+    revisions. @see session_func_t */
+static svn_error_t *getRevisions(svn_ra_session_t *session, void *baton, apr_pool_t *pool);
+
+/** Stores the details of a log entry, see getRevisions. @see svn_log_entry_receiver_t */
+static svn_error_t *storeRevision(void *baton, svn_log_entry_t *entry, apr_pool_t *pool);
+
+/** Fetches the MD5 checksums of all files of the session's directory into
+    the ChecksumReport @a baton with a single status report, which transfers
+    no contents. Files the server reports without a checksum are left
+    unknown. @see session_func_t */
+static svn_error_t *getChecksums(svn_ra_session_t *session, void *baton, apr_pool_t *pool);
+
+/** @see svn_delta_editor_t.open_root, the root baton being the ChecksumReport. */
+static svn_error_t *openChecksumRoot(void *editBaton, svn_revnum_t baseRevision, apr_pool_t *pool, void **rootBaton);
+
+/** Looks up the entry of a reported file, which becomes the file baton. @see svn_delta_editor_t.add_file */
+static svn_error_t *addChecksumFile(const char *path, void *parentBaton, const char *copyfromPath, svn_revnum_t copyfromRevision, apr_pool_t *pool, void **fileBaton);
+
+/** Stores the checksum of a reported file. @see svn_delta_editor_t.close_file */
+static svn_error_t *closeChecksumFile(void *fileBaton, const char *textChecksum, apr_pool_t *pool);
+
+/** Parses a hexadecimal MD5 checksum.
+    @param digest Receives the APR_MD5_DIGESTSIZE bytes, left untouched unless
+                  @a hex is valid.
+    @param hex The zero-terminated checksum, may be NULL.
+    @return Non-zero if @a hex is a valid checksum. */
+static int parseChecksum(unsigned char *digest, const char *hex);
+
+/** Retrieves the youngest revision into the svn_revnum_t @a baton. @see session_func_t */
+static svn_error_t *getYoungest(svn_ra_session_t *session, void *baton, apr_pool_t *pool);
+
+/** Downloads the session's file through the Transfer @a baton. @see session_func_t */
+static svn_error_t *fetchFile(svn_ra_session_t *session, void *baton, apr_pool_t *pool);
+
+/** Writes downloaded data to the local file of the Transfer @a baton and
+    reports progress. @see svn_write_fn_t */
+static svn_error_t *countTransfer(void *baton, const char *data, apr_size_t *len);
+
+/** Reports the progress of the Transfer @a baton to TC at most every 100 ms.
+    Also polled by cancelForeground during foreground downloads, so the user
+    can abort while waiting for the server.
+    @see svn_cancel_func_t */
+static svn_error_t *reportTransfer(void *baton);
+
+/** Permanent cancel function of Subversion.ctx. Reports the progress of the
+    foreground download running on the calling thread, if any, and does
+    nothing otherwise. Pooled sessions keep the cancel setup they were opened
+    with, so it must neither change nor ever be NULL. @see svn_cancel_func_t */
+static svn_error_t *cancelForeground(void *baton);
+
+/** Fetches the details of all revisions the entries of @a snapshot were
+    last changed in that are not cached yet, see getRevisions. Does nothing
+    if they have been fetched for @a snapshot before.
+    @param snapshot A finished snapshot.
+    @param ctx The client context to fetch with.
+    @param pool The pool for temporary allocations.
+    @return An error message on failure, or NULL on success. */
+static svn_error_t *fetchRevisions(Snapshot *snapshot, svn_client_ctx_t *ctx, apr_pool_t *pool);
+
+/** Fetches the checksums of all files of @a snapshot with a single request
+    and attaches them, see snapshot_checksum. Does nothing if they have been
+    fetched for @a snapshot before.
+    @param snapshot A finished snapshot.
+    @param ctx The client context to fetch with.
+    @param pool The pool for temporary allocations.
+    @return An error message on failure, or NULL on success. */
+static svn_error_t *fetchChecksums(Snapshot *snapshot, svn_client_ctx_t *ctx, apr_pool_t *pool);
+
+/** Calls fetchRevisions or fetchChecksums.
+    @param details The ColumnDetails to fetch. */
+static svn_error_t *fetchDetails(Snapshot *snapshot, int details, svn_client_ctx_t *ctx, apr_pool_t *pool);
+
+/** Reads a column value of an entry of a cached listing. Never blocks.
+    @param snapshot A finished snapshot.
+    @param name The zero-terminated entry name.
+    @param fieldIndex The field, see FieldIndices.
+    @param fieldValue Receives the value.
+    @param maxLen The size of @a fieldValue for string fields.
+    @return The field type, FT_NOSUCHFIELD if there is no such entry,
+            FT_FIELDEMPTY if the value is unknown, or FT_DELAYED if it needs
+            ColumnDetails of @a snapshot which have not been fetched. */
+static int readField(Snapshot *snapshot, const char *name, int fieldIndex, void *fieldValue, int maxLen);
+
+/** Loads the disk cache's listing of a directory into the snapshot cache.
+    @return The snapshot with a reference the caller must release, or NULL
+            if the disk cache holds no listing of the directory. */
+static Snapshot *loadStoredSnapshot(const Location *loc, const char *subPath, size_t subPathLen);
+
+/** Queries the server for a directory listing, finishes @a snapshot and adds
+    it to the snapshot cache. A streamed snapshot is failed on error.
+    @param snapshot An empty snapshot, see snapshot_create.
+    @param ctx The client context to list with.
+    @param pool The parent pool for temporary allocations.
+    @return An error message on failure, or NULL on success. */
+static svn_error_t *listSnapshot(Snapshot *snapshot, svn_client_ctx_t *ctx, apr_pool_t *pool);
+
+/** @return The key of the directory listed by @a snapshot in the disk cache,
+    its unescaped URL with the peg revision of a pinned location, allocated from @a pool. */
+static char *snapshotKey(const Snapshot *snapshot, apr_pool_t *pool);
+
+/** Asks the server whether a snapshot is still current, which is a lot cheaper
+    than listing the directory again. Confirms @a snapshot if it is.
+    @param unchanged Receives TRUE if the directory was not modified since the listing.
+    @param snapshot The snapshot to check.
+    @param ctx The client context to use.
+    @param pool The parent pool for temporary allocations.
+    @return An error message on failure, or NULL on success. */
+static svn_error_t *checkSnapshot(svn_boolean_t *unchanged, Snapshot *snapshot, svn_client_ctx_t *ctx, apr_pool_t *pool);
+
+/** Queries the server for a directory listing and adds the result to the
+    snapshot cache.
+    @param snapshot Receives the new snapshot, which the caller must release.
+    @param loc The location.
+    @param subPath The normalized sub path inside @a loc, zero-terminated.
+    @param subPathLen The length of @a subPath.
+    @param ctx The client context to list with.
+    @param pool The parent pool for temporary allocations.
+    @return An error message on failure, or NULL on success. */
+static svn_error_t *querySnapshot(Snapshot **snapshot, const Location *loc, const char *subPath, size_t subPathLen, svn_client_ctx_t *ctx, apr_pool_t *pool);
+
+/** Retrieves the snapshot of a remote directory, from the cache if possible.
+    @param snapshot Receives the snapshot, which the caller must release.
     @param path The remote path, in TC format, minus the leading backslash.
+                Need not be zero-terminated.
+    @param pathLen The length of @a path.
+    @param flags A combination of SnapshotFlags.
     @return An error message on failure, or NULL on success. */
-static svn_error_t *querySnapshot(Snapshot *snapshot, const char *path);
+static svn_error_t *getSnapshot(Snapshot **snapshot, const char *path, size_t pathLen, int flags);
 
 /** Initializes Subversion.
     @return 0 on success. */
 static int initSvn(void);
 
+/** Creates a client context.
+    @param ctx Receives the new context.
+    @param interactive If TRUE, the user is prompted for credentials through TC.
+                       Otherwise only cached credentials are used.
+    @param pool The pool to allocate the context from. */
+static svn_error_t *createClientContext(svn_client_ctx_t **ctx, svn_boolean_t interactive, apr_pool_t *pool);
+
+/** Queues background listings of the subdirectories of @a snapshot that are
+    not cached yet. While a multi-file copy walks the directories, this covers
+    the whole subtree; cached children are descended by a worker, too.
+    @param snapshot The parent directory's snapshot. */
+static void schedulePrefetch(const Snapshot *snapshot);
+
+/** Allocates a ListJob, the caller fills in the sub path and submits it with submitListJob.
+    @param loc The location.
+    @param subPathLen The length of the sub path. */
+static ListJob *createListJob(const Location *loc, size_t subPathLen);
+
+/** Queues a ListJob unless one for the same directory is queued or running,
+    or a multi-file copy has already queued it. Frees @a job in that case.
+    @return Non-zero if @a job has been queued. */
+static int submitListJob(ListJob *job);
+
+/** Removes a ListJob from the pending ones unless it has been superseded.
+    @return The job's subtree flag, read under the lock. */
+static int finishListJob(ListJob *job);
+
+/** Queues a background listing of a directory whose cached snapshot may be outdated.
+    @param loc The location.
+    @param subPath The normalized sub path inside @a loc.
+    @param subPathLen The length of @a subPath. */
+static void scheduleRefresh(const Location *loc, const char *subPath, size_t subPathLen);
+
+/** (Re-)Starts or stops the prefetch and streaming workers to match the configuration. */
+static void configureWorkers(void);
+
+/** @see worker_thread_init_t */
+static void *initWorkerThread(apr_pool_t *pool);
+
+/** Pool cleanup closing the pooled sessions of the svn_client_ctx_t @a data. */
+static apr_status_t closeContextSessions(void *data);
+
+/** Runs a background listing. @see WorkerJob */
+static void runListJob(WorkerJob *job, void *threadData);
+
+/** Runs a streamed foreground listing. @see WorkerJob */
+static void runStreamJob(WorkerJob *job, void *threadData);
+
+/** Frees a cancelled streamed listing. @see WorkerJob */
+static void discardStreamJob(WorkerJob *job);
+
+/** @see svn_cancel_func_t, @a baton is the Snapshot being streamed. */
+static svn_error_t *cancelStream(void *baton);
+
+/** Frees a cancelled background listing. @see WorkerJob */
+static void discardListJob(WorkerJob *job);
+
+/** @see svn_cancel_func_t, @a baton is a WorkerJob of the prefetch pool. */
+static svn_error_t *cancelPrefetch(void *baton);
+
+/** Copies a file from the local file store if the store holds its current
+    contents, as listed by the snapshot of its parent directory.
+    @param remoteName The remote path, minus the leading backslash.
+    @param url The escaped URL of the file.
+    @param localName The local file name.
+    @return Non-zero if the file was copied. */
+static int fetchStoredFile(const char *remoteName, const char *url, const char *localName);
+
+/** Opens a local file for writing, reporting any error to the user.
+    @param file Receives the open file.
+    @param localName The local file name, in TC format.
+    @param pool The pool to allocate the file from.
+    @return FS_FILE_OK or FS_FILE_WRITEERROR. */
+static int openLocalFile(apr_file_t **file, char *localName, apr_pool_t *pool);
+
+/** Writes @a contents to a local file.
+    @param localName The local file name, in TC format.
+    @param contents The file contents.
+    @return An FsGetFile result. */
+static int writeLocalFile(char *localName, const svn_stringbuf_t *contents);
+
+/** Writes the current statistics report, see stats_report, to a local file.
+    @param localName The local file name, in TC format.
+    @return An FsGetFile result. */
+static int writeStatistics(char *localName);
+
+/** Writes the recorded trace, see trace_dump, to a local file and
+    summarizes it in TC's log if the trace_log option is set.
+    @param localName The local file name, in TC format.
+    @return An FsGetFile result. */
+static int writeTrace(char *localName);
+
+/** Writes a trace summary line to TC's log. @see trace_line_t */
+static void logTraceLine(const char *line, void *baton);
+
+/** Takes the look-ahead download of a file of the current batch out of
+    Download.jobs, or records that the caller downloads it itself.
+    @param remoteName The TC path of the file, without leading backslash.
+    @return The queued or finished download, or NULL if there is none. */
+static DownloadJob *claimDownload(const char *remoteName);
+
+/** Queues the downloads of the files following @a remoteName in its cached
+    parent listing, the order in which TC walks a directory, so that the
+    workers fetch them while TC is busy with this one. Looks ahead one file
+    per download thread.
+    @param remoteName The TC path of the requested file, without leading backslash.
+    @param localName Its local file name, in TC format. The following files
+                     are expected in the same local directory. */
+static void queueLookAhead(const char *remoteName, const char *localName);
+
+/** Queues the download of a file into a temporary file, unless it has been
+    queued or claimed during the current batch already.
+    @param loc The location of the file.
+    @param remoteName The TC path of the file, without leading backslash. Need not be zero-terminated.
+    @param remoteNameLen The length of @a remoteName.
+    @param localDir The local directory to download to, in TC format, including the trailing separator.
+    @param localDirLen The length of @a localDir.
+    @param size The expected file size, 0 if unknown. */
+static void queueDownload(const Location *loc, const char *remoteName, size_t remoteNameLen, const char *localDir, size_t localDirLen, apr_int64_t size);
+
+/** Waits for a claimed download while reporting its progress to TC, then
+    moves the downloaded file into place and frees @a job.
+    @param job The job returned by claimDownload.
+    @param sourceName The name shown in TC's progress dialog.
+    @param localName The local file name, in TC format.
+    @return The FsGetFile result for the file. */
+static int awaitDownload(DownloadJob *job, const char *sourceName, char *localName);
+
+/** Frees a finished download along with its error and temporary file. */
+static void freeDownloadJob(DownloadJob *job);
+
+/** Runs a download of the current batch. @see WorkerJob */
+static void runDownloadJob(WorkerJob *job, void *threadData);
+
+/** Records a download that was cancelled before it started. @see WorkerJob */
+static void discardDownloadJob(WorkerJob *job);
+
+/** Records the result of a batch download and wakes up awaitDownload.
+    @param job The finished download, its file already closed.
+    @param err The error it failed with, or NULL on success. Owned by @a job from now on. */
+static void finishDownload(DownloadJob *job, svn_error_t *err);
+
+/** @see svn_cancel_func_t, @a baton is a WorkerJob of the download pool. */
+static svn_error_t *cancelDownload(void *baton);
+
+/** Cancels the look-ahead downloads TC has not asked for by the end of the
+    current batch, waits for them to stop and frees them. */
+static void finishBatch(void);
+
+/** @return The FsGetFileArg matching the outcome of a download that returned @a err. */
+static int downloadResult(const svn_error_t *err);
+
+/** Makes a worker list a directory and fetch the column details of its
+    entries, see fetchDetails, unless a column job for it is queued or
+    running already.
+    @param details The ColumnDetails to fetch.
+    @param loc The location.
+    @param subPath The normalized sub path. Need not be zero-terminated.
+    @param subPathLen The length of @a subPath.
+    @param dirPath The TC path of the directory, minus the leading backslash.
+                   Need not be zero-terminated.
+    @param dirPathLen The length of @a dirPath. */
+static void scheduleColumns(int details, const Location *loc, const char *subPath, size_t subPathLen, const char *dirPath, size_t dirPathLen);
+
+/** Blocks until no column job fetching @a details for a directory is queued or running.
+    @param details The ColumnDetails.
+    @param dirPath The TC path of the directory, see scheduleColumns.
+    @param dirPathLen The length of @a dirPath. */
+static void waitForColumns(int details, const char *dirPath, size_t dirPathLen);
+
+/** Lists the directory of a ColumnJob unless it is cached and fetches the
+    details of its entries the job is for. @see WorkerJob.run */
+static void runColumnJob(WorkerJob *job, void *threadData);
+
+/** @see WorkerJob.discard */
+static void discardColumnJob(WorkerJob *job);
+
+/** Removes a ColumnJob from the pending ones, wakes up its waiters and frees it. */
+static void finishColumnJob(ColumnJob *job);
+
+/** Cancel function of column jobs, @a baton being the job. @see svn_cancel_func_t */
+static svn_error_t *cancelColumns(void *baton);
+
+/** Queues an update of the filename index of @a loc on the indexer thread,
+    unless one was queued less than index_interval seconds ago.
+    @param force Non-zero to queue it even if index_interval is zero or has
+                 not passed yet, as "find" does for a location without an index. */
+static void scheduleIndexUpdate(const Location *loc, int force);
+
+/** @see WorkerJob */
+static void runIndexJob(WorkerJob *job, void *threadData);
+
+/** @see WorkerJob */
+static void discardIndexJob(WorkerJob *job);
+
+/** Stops a background index update when the indexer is cancelled.
+    @param baton The IndexJob. */
+static svn_error_t *cancelIndexUpdate(void *baton);
+
+/** Implements the "find" command: brings the filename index of the location
+    up to date and lists all files and directories below @a remoteName whose
+    name matches @a pattern, see nameindex_search. A location without an
+    index has it built on the indexer thread instead, since that crawls the
+    whole tree.
+    @param mainWin The parent window for the result.
+    @param remoteName The directory to search, without leading backslash.
+    @param pattern The zero-terminated name pattern.
+    @param pool The pool for temporary allocations. */
+static void findFiles(HWND mainWin, char *remoteName, const char *pattern, apr_pool_t *pool);
+
+/** Adds a match to the FoundFiles @a baton. @see nameindex_match_t */
+static int addFoundFile(const char *path, void *baton);
+
+/** Implements the "diff" command: compares the directory @a remoteName with
+    @a base in a single diff summary request, reports the differences and
+    records them for the "diff" column, see diffsum_status.
+    @param mainWin The parent window for the report.
+    @param remoteName The directory to compare, without leading backslash.
+    @param base The zero-terminated base, either a repository URL compared at
+                HEAD or a directory below the plugin root, which is compared
+                at the peg revision of its location, if any.
+    @param pool The pool for temporary allocations. */
+static void compareTrees(HWND mainWin, char *remoteName, const char *base, apr_pool_t *pool);
+
+/** Records a difference and adds it to the DiffReport @a baton. @see svn_client_diff_summarize_func_t */
+static svn_error_t *addDifference(const svn_client_diff_summarize_t *diff, void *baton, apr_pool_t *pool);
+
+/** Reads the "diff" column of an entry, which takes no listing.
+    @param fileName The entry path without leading backslash.
+    @param baseFileName The entry name inside @a fileName.
+    @param fieldValue Receives the value.
+    @param maxLen The size of @a fieldValue.
+    @return The field type, FT_FIELDEMPTY if the entry was not compared or FT_FILEERROR. */
+static int readDifference(const char *fileName, const char *baseFileName, void *fieldValue, int maxLen);
+
+/** Starts the background poller unless it is running. */
+static void startPoller(void);
+
+/** Stops the background poller and waits for it to exit. */
+static void stopPoller(void);
+
+/** Thread function of the background poller. */
+static void * APR_THREAD_FUNC pollThread(apr_thread_t *thread, void *data);
+
+/** Revalidates all cached snapshots that are about to go stale, listing
+    changed directories again.
+    @param ctx The client context to use.
+    @param pool The parent pool for temporary allocations. */
+static void pollSnapshots(svn_client_ctx_t *ctx, apr_pool_t *pool);
+
+/** @see svn_cancel_func_t, cancels when the poller is stopped. */
+static svn_error_t *cancelPoll(void *baton);
+
+/** qsort comparison of svn_revnum_t values. */
+static int compareRevisions(const void *a, const void *b);
+
+/** qsort comparison of Snapshot pointers by location. */
+static int compareSnapshotLocations(const void *a, const void *b);
+
 /** (Re-)Loads configuration from disk. */
 static void loadConfig(void);
 
-/** Retrieves information about the SVN object.
-    @param val The source value.
-    @param findData The destination find data. */
-static void getSvnNode(SVNObject *obj, WIN32_FIND_DATA *findData);
+/** Reloads the configuration if the configuration file has changed since it
+    was loaded. Runs on TC's thread, which is the only one to look up locations.
+    Deferred while a multi-file copy runs, see statusInfo. */
+static void reloadChangedConfig(void);
+
+/** Replaces the configured locations by @a fresh. Unchanged locations are
+    kept along with their cached listings, only the listings of removed or
+    changed ones are dropped.
+    @param fresh The sorted new locations, emptied by the call. */
+static void updateLocations(Locations *fresh);
+
+/** Sets the option named @a name to @a value. Unknown options are ignored.
+    @param name The option name. Need not be zero-terminated.
+    @param nameLen The length of @a name.
+    @param value The zero-terminated option value. */
+static void setOption(const char *name, size_t nameLen, const char *value);
+
+/** Retrieves information about the SVN object. @see snapshot_reader_t
+    @param snapshot The snapshot containing @a obj.
+    @param obj The source entry.
+    @param findData The destination WIN32_FIND_DATA. */
+static void getSvnNode(const Snapshot *snapshot, const SVNObject *obj, void *findData);
 
 /** Replaces all occurrences of oldVal with newVal in the zero-terminated string @a str.
     @param str The zero-terminated string.
@@ -119,17 +656,13 @@ static void replaceAll(char *str, char oldVal, char newVal);
     @param str The zero-terminated string. */
 static void slashify(char *str);
 
-/** Destroys the given snapshot. */
-static void destroySnapshot(Snapshot *snapshot);
+/** Cancels all background work and waits for it to stop, since it may
+    refer to locations about to be freed. */
+static void stopBackgroundWork(void);
 
 /** Releases all locations and snapshots */
 static void freeLocationsAndSnapshots(void);
 
-/** @return The SVN URI associated with @a remoteName, allocated from @a pool,
-    with @a overAllocate additional bytes allocated past the terminating zero,
-    or NULL if @a remoteName did not match any known locations. */
-static char *remoteNameToSvnURI(char *remoteName, apr_pool_t *pool, size_t overAllocate);
-
 /** Displays an error message box.
     @param msg The message to display. */
 static void displayErrorMessage(const char *msg);
@@ -165,22 +698,74 @@ static svn_error_t *promptSSLTrustAny(svn_auth_cred_ssl_server_trust_t **cred_p,
 */
 static const String ConfigFileName     = { "svn_wfx.ini"   , 11 };
 static const String EditLocationsTitle = { "Edit Locations", 14 };
+static const String StatisticsTitle    = { "Statistics.txt", 14 };
+static const String TraceTitle         = { "Trace.json"    , 10 };
+static const String OptionsSection     = { "[options]"     ,  9 };
+static const String CacheDirName       = { "svn_wfx.cache" , 13 };
+static const String FileStoreDirName   = { "\\files"       ,  6 };
+static const String IndexDirName       = { "\\index"       ,  6 };
+
+static const svn_revnum_t MaxRevisionRun = 16;  /* revisions a single log request of getRevisions may span */
 
 static HINSTANCE hInstance;
 
 static struct
 {
-    Location *locations;
+    Locations locations;
     String configFilePath;
+    String cacheDirPath;   /* directory of the on-disk listing cache, next to the configuration file */
+    String fileStorePath;  /* directory of the local file store, inside cacheDirPath */
+    String indexPath;      /* directory of the filename indexes, inside cacheDirPath */
+    int cacheSize;         /* maximum number of cached directory listings */
+    int revisionCacheSize; /* maximum number of revisions whose commit details are cached */
+    int cacheTTL;          /* seconds before a cached listing is fetched again on FsFindFirst */
+    int prefetchThreads;   /* number of background listing threads, 0 disables prefetching */
+    int prefetchChildren;  /* maximum number of subdirectories prefetched per listing */
+    int streamThreads;     /* number of threads for streamed listings, 0 lists on the calling thread */
+    int diskCacheSize;     /* size limit of the on-disk listing cache in MB, 0 disables it */
+    int pollInterval;      /* seconds between background revalidations, 0 disables polling */
+    int sessionIdleTimeout;  /* seconds before an unused connection is closed, 0 disables reuse */
+    int downloadThreads;   /* number of concurrent downloads of a multi-file copy, 0 copies one by one */
+    int fileStoreSize;     /* size limit of the local file store in MB, 0 disables it */
+    int indexInterval;     /* seconds between background updates of a location's filename index, 0 updates on "find" only */
+    int indexCacheSize;    /* size limit of the stored filename indexes in MB, 0 keeps them in memory only */
+    int columnThreads;     /* threads computing column values TC asks for in the background */
+    int traceEvents;       /* number of trace spans kept, 0 disables tracing */
+    int traceLog;          /* summarize the trace in TC's log whenever it is written */
+    Location **retired;    /* removed or changed locations, which snapshots held by TC may still refer to */
+    size_t retiredCount;
+    HANDLE changes;        /* change notification of the configuration file's directory, NULL if unavailable */
+    FILETIME loadedTime;   /* last write time of the configuration file when it was loaded */
 } Config = { 0 };
 
+static const Option options[] =
+{
+    { { "cache_size",        10 }, &Config.cacheSize,         64 },
+    { { "cache_ttl",          9 }, &Config.cacheTTL,          10 },
+    { { "prefetch_threads",  16 }, &Config.prefetchThreads,    2 },
+    { { "prefetch_children", 17 }, &Config.prefetchChildren,   8 },
+    { { "stream_threads",    14 }, &Config.streamThreads,      2 },
+    { { "disk_cache_size",   15 }, &Config.diskCacheSize,     32 },
+    { { "poll_interval",     13 }, &Config.pollInterval,       0 },
+    { { "session_idle_timeout", 20 }, &Config.sessionIdleTimeout, 300 },
+    { { "download_threads",  16 }, &Config.downloadThreads,    4 },
+    { { "file_store_size",   15 }, &Config.fileStoreSize,    256 },
+    { { "index_interval",    14 }, &Config.indexInterval,      0 },
+    { { "index_cache_size",  16 }, &Config.indexCacheSize,    64 },
+    { { "column_threads",    14 }, &Config.columnThreads,      2 },
+    { { "revision_cache_size", 19 }, &Config.revisionCacheSize, 20000 },
+    { { "trace_events",      12 }, &Config.traceEvents,        0 },
+    { { "trace_log",          9 }, &Config.traceLog,           0 },
+    { { NULL,                 0 }, NULL,                       0 }
+};
+
 static const Field fields[] =
 {
     {
         /* name  */     { "revision", 8 },
-#if (defined WIN64)
+#if (defined WIN64) || (defined __LP64__)
         /* type  */     FT_NUMERIC_64,
-#elif (defined WIN32)
+#elif (defined WIN32) || (defined __unix__)
         /* type  */     FT_NUMERIC_32,
 #else
 #error Unsupported platform!
@@ -193,6 +778,36 @@ static const Field fields[] =
         /* type  */     FT_STRING,
         /* flags */     0,
         /* sortOrder */ SO_ASCENDING
+    },
+    {
+        /* name  */     { "message", 7 },
+        /* type  */     FT_STRING,
+        /* flags */     0,
+        /* sortOrder */ SO_ASCENDING
+    },
+    {
+        /* name  */     { "date", 4 },
+        /* type  */     FT_DATETIME,
+        /* flags */     0,
+        /* sortOrder */ SO_DESCENDING
+    },
+    {
+        /* name  */     { "changes", 7 },
+        /* type  */     FT_NUMERIC_32,
+        /* flags */     0,
+        /* sortOrder */ SO_DESCENDING
+    },
+    {
+        /* name  */     { "diff", 4 },
+        /* type  */     FT_STRING,
+        /* flags */     0,
+        /* sortOrder */ SO_ASCENDING
+    },
+    {
+        /* name  */     { "checksum", 8 },
+        /* type  */     FT_STRING,
+        /* flags */     0,
+        /* sortOrder */ SO_ASCENDING
     }
 };
 
@@ -208,11 +823,62 @@ static struct
 {
     apr_pool_t *pool;
     svn_client_ctx_t *ctx;
+    Transfer *transfer;              /* foreground download, see cancelForeground */
+    apr_os_thread_t transferThread;  /* the thread running it */
 } Subversion = { 0 };
 
-static Location *nextTopLevelLoc;
+static struct
+{
+    WorkerPool *workers;
+    volatile int subtree;        /* a multi-file copy is walking the selected directories, see FsStatusInfo */
+    apr_thread_mutex_t *mutex;   /* guards pending, walked and the flags of pending jobs */
+    apr_hash_t *pending;         /* ListJob key -> queued or running ListJob */
+    apr_pool_t *walkedPool;      /* cleared whenever a multi-file copy starts */
+    apr_hash_t *walked;          /* ListJob keys queued during the current multi-file copy */
+} Prefetch = { 0 };
+
+static struct
+{
+    WorkerPool *workers;
+} Streaming = { 0 };
+
+static struct
+{
+    WorkerPool *workers;
+    apr_thread_mutex_t *mutex;   /* guards pending, jobs and the finished flags of jobs */
+    apr_thread_cond_t *cond;     /* signalled whenever a download finishes */
+    int batch;                   /* between FS_STATUS_START and FS_STATUS_END of a multi-file copy */
+    int warm;                    /* a file of the batch has been downloaded on the calling thread */
+    int pending;                 /* queued or running downloads */
+    apr_pool_t *queuedPool;      /* cleared whenever a multi-file copy starts */
+    apr_hash_t *queued;          /* remote names queued or claimed during the current multi-file copy */
+    apr_hash_t *jobs;            /* remote name -> look-ahead DownloadJob not claimed yet */
+} Download = { 0 };
+
+static struct
+{
+    WorkerPool *workers;   /* a single thread, so updates of different locations do not pile up */
+} Indexer = { 0 };
+
+static struct
+{
+    WorkerPool *workers;         /* NULL if column values are computed on the calling thread */
+    apr_thread_mutex_t *mutex;   /* guards pending, and Config.locations while TC's background thread resolves paths */
+    apr_thread_cond_t *cond;     /* signalled whenever a column job finishes */
+    apr_hash_t *pending[CD_MAX]; /* per ColumnDetails, dirPath -> queued or running ColumnJob */
+} Columns = { 0 };
+
+static struct
+{
+    apr_pool_t *pool;
+    apr_thread_t *thread;
+    apr_thread_mutex_t *mutex;
+    apr_thread_cond_t *cond;
+    volatile int stop;
+} Poller = { 0 };
 
-static Snapshot cachedSnapshot;
+static size_t nextTopLevelLoc;   /* index into Config.locations.sorted of the next location the root listing returns */
+static int reportsListed;   /* number of reports, StatisticsTitle and TraceTitle, the current root listing has returned */
 
 /*
 ** Implementation
@@ -232,13 +898,21 @@ int __stdcall FsInit(int pluginId, f_progress_t fProgress, f_log_t fLog, f_reque
     Plugin.progress = fProgress;
     Plugin.log      = fLog;
     Plugin.request  = fRequest;
-    memset(&cachedSnapshot, 0, sizeof(cachedSnapshot));
     tproc_init(&displayErrorMessage);
     return initSvn();
 }
 
 /*--------------------------------------------------------------------------*/
 HANDLE __stdcall FsFindFirst(char* path, WIN32_FIND_DATA *findData)
+{
+    const apr_time_t start = trace_begin();
+    const HANDLE result = findFirst(path, findData);
+    trace_end(start, "fs", "FsFindFirst", path);
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+static HANDLE findFirst(char *path, WIN32_FIND_DATA *findData)
 {
     const size_t pathLen = strlen(path);
 
@@ -246,12 +920,31 @@ HANDLE __stdcall FsFindFirst(char* path, WIN32_FIND_DATA *findData)
     {
         return INVALID_HANDLE_VALUE;
     }
+    reloadChangedConfig();
     memset(findData, 0, sizeof(*findData));
     if (*path)
     {
         /* nested directory */
-        Snapshot *snapshot = malloc(sizeof(*snapshot));
-        svn_error_t *err = querySnapshot(snapshot, path);
+        Snapshot *snapshot;
+        svn_error_t *err;
+        int found = 0;
+        if (Prefetch.workers && !Prefetch.subtree)
+        {
+            /* the user navigated, pending prefetches are probably useless now */
+            workerpool_cancel(Prefetch.workers);
+        }
+        err = getSnapshot(&snapshot, path, pathLen - 1, SF_REVALIDATE | SF_STREAM);
+        if (!err && !(found = snapshot_read(snapshot, 0, &getSvnNode, findData)) && snapshot->error)
+        {
+            /* The streamed listing failed before delivering anything. Try again
+               on this thread, which may prompt for credentials. */
+            snapshot_release(snapshot);
+            err = getSnapshot(&snapshot, path, pathLen - 1, SF_REVALIDATE);
+            if (!err)
+            {
+                found = snapshot_read(snapshot, 0, &getSvnNode, findData);
+            }
+        }
         if (err)
         {
             displaySvnErrorMessage(err);
@@ -259,23 +952,31 @@ HANDLE __stdcall FsFindFirst(char* path, WIN32_FIND_DATA *findData)
         }
         else
         {
-            if (snapshot->entries)
+            /* streamed listings schedule their prefetch once they are complete */
+            if (snapshot_finished(snapshot))
             {
-                getSvnNode(snapshot->entries, findData);
-                snapshot->current = snapshot->entries->next;
+                schedulePrefetch(snapshot);
+            }
+            scheduleIndexUpdate(snapshot->location, FALSE);
+            if (found)
+            {
+                FindHandle *find = malloc(sizeof(*find));
+                find->snapshot = snapshot;
+                find->current = 1;
 
-                return (HANDLE) snapshot;
+                return (HANDLE) find;
             }
+            snapshot_release(snapshot);
             SetLastError(ERROR_NO_MORE_FILES);
         }
-        free(snapshot);
     }
     else
     {
         /* root directory */
         memcpy(findData->cFileName, EditLocationsTitle.data, EditLocationsTitle.len + 1);
         findData->dwFileAttributes = FILE_ATTRIBUTE_READONLY;
-        nextTopLevelLoc = Config.locations;
+        nextTopLevelLoc = 0;
+        reportsListed = 0;
         return (HANDLE) 0;
     }
     return INVALID_HANDLE_VALUE;
@@ -284,24 +985,47 @@ HANDLE __stdcall FsFindFirst(char* path, WIN32_FIND_DATA *findData)
 /*--------------------------------------------------------------------------*/
 BOOL __stdcall FsFindNext(HANDLE handle, WIN32_FIND_DATA *findData)
 {
-    Snapshot *snapshot = (Snapshot*) handle;
-    if (snapshot)
+    const apr_time_t start = trace_begin();
+    const BOOL result = findNext(handle, findData);
+    trace_end(start, "fs", "FsFindNext", result ? findData->cFileName : NULL);
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+static BOOL findNext(HANDLE handle, WIN32_FIND_DATA *findData)
+{
+    FindHandle *find = (FindHandle*) handle;
+    if (find)
     {
-        if (snapshot->current)
+        if (snapshot_read(find->snapshot, find->current, &getSvnNode, findData))
         {
-            getSvnNode(snapshot->current, findData);
-            snapshot->current = snapshot->current->next;
+            ++find->current;
             return TRUE;
         }
-        snapshot->current = snapshot->entries;
+        if (find->snapshot->error)
+        {
+            /* streamed listing broke off */
+            displayErrorMessage(find->snapshot->error);
+        }
     }
     else
     {
-        if (nextTopLevelLoc)
+        if (!reportsListed || (reportsListed == 1 && trace_enabled()))
+        {
+            /* live reports, written whenever TC copies or views them */
+            const String *title = reportsListed++ ? &TraceTitle : &StatisticsTitle;
+            memcpy(findData->cFileName, title->data, title->len + 1);
+            findData->dwFileAttributes = FILE_ATTRIBUTE_READONLY;
+            findData->nFileSizeLow  = 0;
+            findData->nFileSizeHigh = 0;
+            GetSystemTimeAsFileTime(&findData->ftLastWriteTime);
+            return TRUE;
+        }
+        if (nextTopLevelLoc < Config.locations.count)
         {
-            memcpy(findData->cFileName, nextTopLevelLoc->title.data, nextTopLevelLoc->title.len + 1);
+            const Location *loc = Config.locations.sorted[nextTopLevelLoc++];
+            memcpy(findData->cFileName, loc->title.data, loc->title.len + 1);
             findData->dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_READONLY;
-            nextTopLevelLoc = nextTopLevelLoc->next;
             return TRUE;
         }
     }
@@ -310,19 +1034,25 @@ BOOL __stdcall FsFindNext(HANDLE handle, WIN32_FIND_DATA *findData)
 
 /*--------------------------------------------------------------------------*/
 int __stdcall FsFindClose(HANDLE handle)
+{
+    const apr_time_t start = trace_begin();
+    const int result = findClose(handle);
+    trace_end(start, "fs", "FsFindClose", NULL);
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+static int findClose(HANDLE handle)
 {
     if (handle)
     {
-        Snapshot *snapshot = (Snapshot*) handle;
-        destroySnapshot(&cachedSnapshot);
-        cachedSnapshot.location = snapshot->location;
-        cachedSnapshot.subPath = snapshot->subPath;
-        cachedSnapshot.entries = snapshot->entries;
-        free(handle);
+        FindHandle *find = (FindHandle*) handle;
+        snapshot_release(find->snapshot);
+        free(find);
     }
     else
     {
-        nextTopLevelLoc = Config.locations;
+        nextTopLevelLoc = 0;
     }
     return 0;
 }
@@ -330,66 +1060,172 @@ int __stdcall FsFindClose(HANDLE handle)
 /*--------------------------------------------------------------------------*/
 int __stdcall FsGetFile(char *remoteName, char *localName, int copyFlags, RemoteInfoStruct *ri)
 {
+    const apr_time_t start = trace_begin();
+    const int result = getFile(remoteName, localName, copyFlags, ri);
+    trace_end(start, "fs", "FsGetFile", remoteName);
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+static int getFile(char *remoteName, char *localName, int copyFlags, RemoteInfoStruct *ri)
+{
+    const char *sourceName = remoteName;   /* shown in the progress dialog */
     apr_pool_t *subPool;
-    svn_opt_revision_t revision;
-    apr_file_t *file;
-    svn_stream_t *stream;
-    char *uri;
+    Transfer transfer;
+    const Location *loc;
+    char url[LOCATION_URL_SIZE];
+    size_t urlLen;
+    int result;
 
     if (*remoteName++ != '\\' )
     {
         return FS_FILE_NOTFOUND;
     }
 
-    subPool = svn_pool_create(Subversion.pool);
-    uri = remoteNameToSvnURI(remoteName, subPool, 0);
-    if (!uri)
-    {
-        return svn_pool_destroy(subPool), FS_FILE_NOTFOUND;
-    }
-
     if (!(copyFlags & FS_COPYFLAGS_OVERWRITE))
     {
         HANDLE hFile = CreateFile(localName, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
         if (hFile != INVALID_HANDLE_VALUE)
         {
             CloseHandle(hFile);
-            return svn_pool_destroy(subPool), FS_FILE_EXISTS;
+            return FS_FILE_EXISTS;
         }
     }
 
-    Plugin.progress(Plugin.id, uri, localName, 0);
-    revision.kind = svn_opt_revision_head;
+    if (!strcmp(remoteName, StatisticsTitle.data))
+    {
+        return writeStatistics(localName);
+    }
+    if (!strcmp(remoteName, TraceTitle.data) && trace_enabled())
+    {
+        return writeTrace(localName);
+    }
+
+    urlLen = location_url(&Config.locations, remoteName, strlen(remoteName), url, sizeof(url), &loc);
+    if (!urlLen || urlLen >= sizeof(url))
+    {
+        return FS_FILE_NOTFOUND;
+    }
 
-    slashify(localName);
+    if (Download.batch && Download.warm)
     {
-        apr_status_t apr_status = apr_file_open(&file, localName, APR_WRITE | APR_CREATE | APR_TRUNCATE | APR_BINARY, APR_OS_DEFAULT, Subversion.pool);
-        replaceAll(localName, '/', '\\');
-        if (apr_status)
+        DownloadJob *job = claimDownload(remoteName);
+        queueLookAhead(remoteName, localName);
+        if (job)
         {
-            char buf[1024];
-            apr_strerror(apr_status, buf, sizeof(buf));
-            MessageBox(NULL, buf, "apr_file_open", MB_OK | MB_ICONERROR);
-            return svn_pool_destroy(subPool), FS_FILE_WRITEERROR;
+            return awaitDownload(job, sourceName, localName);
         }
     }
-    stream = svn_stream_from_aprfile2(file, FALSE, Subversion.pool);
+
+    if (fetchStoredFile(remoteName, url, localName))
+    {
+        Plugin.progress(Plugin.id, sourceName, localName, 100);
+        return FS_FILE_OK;
+    }
+
+    if (Plugin.progress(Plugin.id, sourceName, localName, 0))
+    {
+        return FS_FILE_USERABORT;
+    }
+
+    subPool = svn_pool_create(Subversion.pool);
+    if ((result = openLocalFile(&transfer.file, localName, subPool)) != FS_FILE_OK)
+    {
+        return svn_pool_destroy(subPool), result;
+    }
+    transfer.remoteName = sourceName;
+    transfer.localName = localName;
+    transfer.revision = loc->revision;
+    /* TC passes the size we reported in FsFindFirst/FsFindNext */
+    transfer.size = ri ? ((apr_int64_t) ri->SizeHigh << 32) | ri->SizeLow : 0;
+    transfer.done = 0;
+    transfer.nextReport = 0;
     {
-        svn_error_t *svn_error = svn_client_cat(stream, escapeURI(uri, subPool), &revision, Subversion.ctx, Subversion.pool);
+        const apr_time_t start = apr_time_now();
+        svn_error_t *svn_error;
+
+        Subversion.transferThread = apr_os_thread_current();
+        Subversion.transfer = &transfer;
+        svn_error = sessionpool_run(loc, url, Subversion.ctx, &fetchFile, &transfer, subPool);
+        Subversion.transfer = NULL;
+        stats_record_download(loc->stats, start, transfer.done, svn_error != NULL);
+        apr_file_close(transfer.file);
         if (svn_error)
         {
-            displaySvnErrorMessage(svn_error);
-            apr_file_close(file);
-            return svn_pool_destroy(subPool), FS_FILE_READERROR;
+            /* do not leave a truncated copy behind */
+            apr_file_remove(localName, subPool);
+            result = downloadResult(svn_error);
+            if (result != FS_FILE_USERABORT)
+            {
+                displaySvnErrorMessage(svn_error);
+            }
+            svn_error_clear(svn_error);
+            return svn_pool_destroy(subPool), result;
         }
     }
 
-    svn_stream_close(stream);
-    Plugin.progress(Plugin.id, uri, localName, 100);
+    if (SVN_IS_VALID_REVNUM(transfer.createdRev))
+    {
+        filestore_store(url, transfer.createdRev, localName);
+    }
+
+    /* the first file of a batch has dealt with any authentication prompts
+       on this thread, the workers can reuse the cached credentials */
+    Download.warm = Download.batch;
+
+    Plugin.progress(Plugin.id, sourceName, localName, 100);
 
     return svn_pool_destroy(subPool), FS_FILE_OK;
 }
 
+/*--------------------------------------------------------------------------*/
+void __stdcall FsStatusInfo(char *remoteDir, int infoStartEnd, int infoOperation)
+{
+    const apr_time_t start = trace_begin();
+    statusInfo(remoteDir, infoStartEnd, infoOperation);
+    trace_end(start, "fs", infoStartEnd == FS_STATUS_START ? "FsStatusInfo start" : "FsStatusInfo end", remoteDir);
+}
+
+/*--------------------------------------------------------------------------*/
+static void statusInfo(char *remoteDir, int infoStartEnd, int infoOperation)
+{
+    if (infoOperation != FS_STATUS_OP_GET_MULTI)
+    {
+        return;
+    }
+
+    if (infoStartEnd == FS_STATUS_START)
+    {
+        /* TC is about to walk the selected directories one by one */
+        apr_thread_mutex_lock(Prefetch.mutex);
+        svn_pool_clear(Prefetch.walkedPool);
+        Prefetch.walked = apr_hash_make(Prefetch.walkedPool);
+        apr_thread_mutex_unlock(Prefetch.mutex);
+        Prefetch.subtree = TRUE;
+        Download.batch = Download.workers != NULL;
+        Download.warm = FALSE;
+        svn_pool_clear(Download.queuedPool);
+        Download.queued = apr_hash_make(Download.queuedPool);
+        Download.jobs = apr_hash_make(Download.queuedPool);
+    }
+    else
+    {
+        Prefetch.subtree = FALSE;
+        if (Prefetch.workers)
+        {
+            /* whatever has not been walked by now is not going to be */
+            workerpool_cancel(Prefetch.workers);
+        }
+        if (Download.batch)
+        {
+            finishBatch();
+            Download.batch = FALSE;
+        }
+        /* pick up configuration changes deferred during the batch */
+        reloadChangedConfig();
+    }
+}
+
 /*--------------------------------------------------------------------------*/
 BOOL __stdcall FsContentGetDefaultView(char *viewContents, char *viewHeaders, char *viewWidths,char *viewOptions, int maxLen)
 {
@@ -448,9 +1284,22 @@ int __stdcall FsContentGetSupportedFieldFlags(int fieldIndex)
 /*--------------------------------------------------------------------------*/
 int __stdcall FsContentGetValue(char *fileName, int fieldIndex, int unitIndex, void *fieldValue, int maxLen, int flags)
 {
-    const Field *field = fields + fieldIndex;
+    const apr_time_t start = trace_begin();
+    const int result = getValue(fileName, fieldIndex, unitIndex, fieldValue, maxLen, flags);
+    trace_end(start, "fs", "FsContentGetValue", fileName);
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+static int getValue(char *fileName, int fieldIndex, int unitIndex, void *fieldValue, int maxLen, int flags)
+{
     char *baseFileName, *baseFilePath;
-    Snapshot *snapshot = &cachedSnapshot;
+    char subPath[MAX_PATH];
+    size_t subPathLen;
+    const Location *loc;
+    Snapshot *snapshot;
+    const int details = fieldIndex == FI_CHECKSUM ? CD_CHECKSUMS : CD_REVISIONS;
+    int result;
 
     if ((fieldIndex < 0) || (fieldIndex >= FI_MAX) || *fileName++ != '\\')
     {
@@ -466,34 +1315,86 @@ int __stdcall FsContentGetValue(char *fileName, int fieldIndex, int unitIndex, v
         return FT_NOSUCHFIELD;
     }
 
-    slashify(fileName);
-
-    if (   !snapshot->entries
-        || !snapshot->subPath.data
-        || strncmp(fileName, snapshot->location->title.data, snapshot->location->title.len)
-        || strncmp(snapshot->subPath.data, baseFilePath, snapshot->subPath.len))
+    stats_add(STAT_FIELD_LOOKUPS, 1);
+    if (fieldIndex == FI_DIFF)
     {
-        const char tmp = *baseFileName;
-        svn_error_t *err;
-        destroySnapshot(snapshot);
-        *baseFileName = '\0';
-        err = querySnapshot(snapshot, fileName);
-        *baseFileName = tmp;
+        return readDifference(fileName, baseFileName, fieldValue, maxLen);
+    }
+    if (!Columns.workers)
+    {
+        /* no column threads, query the server on the calling thread */
+        svn_error_t *err = getSnapshot(&snapshot, fileName, baseFileName - fileName, 0);
         if (err)
         {
             displayErrorMessage(err->message);
             svn_error_clear(err);
             return FT_FILEERROR;
         }
+        result = readField(snapshot, baseFileName, fieldIndex, fieldValue, maxLen);
+        if (result == FT_DELAYED)
+        {
+            apr_pool_t *subPool = svn_pool_create(Subversion.pool);
+            err = fetchDetails(snapshot, details, Subversion.ctx, subPool);
+            svn_pool_destroy(subPool);
+            if (err)
+            {
+                /* not worth a message box per column value, the listing shows what is wrong */
+                trace_mark("columns", "failed", err->message);
+                svn_error_clear(err);
+            }
+            result = readField(snapshot, baseFileName, fieldIndex, fieldValue, maxLen);
+        }
+        snapshot_release(snapshot);
+        return result == FT_DELAYED ? FT_FIELDEMPTY : result;
     }
 
-    for (snapshot->current = snapshot->entries; snapshot->current; snapshot->current = snapshot->current->next)
+    /* TC's background thread may get here while the main thread reloads the configuration */
+    apr_thread_mutex_lock(Columns.mutex);
+    loc = location_resolve(&Config.locations, fileName, baseFileName - fileName, subPath, sizeof(subPath), &subPathLen);
+    apr_thread_mutex_unlock(Columns.mutex);
+    if (!loc)
     {
-        if (!strcmp(baseFileName, snapshot->current->name))
-            break;
+        return FT_FILEERROR;
+    }
+
+    snapshot = snapcache_lookup(loc, subPath, subPathLen);
+    result = snapshot ? readField(snapshot, baseFileName, fieldIndex, fieldValue, maxLen) : FT_DELAYED;
+    snapshot_release(snapshot);
+    if (result != FT_DELAYED)
+    {
+        return result;
     }
 
-    if (!snapshot->current)
+    /* a worker lists the directory and fetches the details for all entries at once */
+    scheduleColumns(details, loc, subPath, subPathLen, fileName, baseFileName - 1 - fileName);
+    if (flags & CONTENT_DELAYIFSLOW)
+    {
+        stats_add(STAT_DELAYED_FIELDS, 1);
+        return FT_DELAYED;
+    }
+    waitForColumns(details, fileName, baseFileName - 1 - fileName);
+    snapshot = snapcache_lookup(loc, subPath, subPathLen);
+    result = snapshot ? readField(snapshot, baseFileName, fieldIndex, fieldValue, maxLen) : FT_FIELDEMPTY;
+    snapshot_release(snapshot);
+    return result == FT_DELAYED ? FT_FIELDEMPTY : result;
+}
+
+/*--------------------------------------------------------------------------*/
+void __stdcall FsContentStopGetValue(char *fileName)
+{
+    if (Columns.workers)
+    {
+        /* wakes up TC's background thread if it waits for a column job */
+        workerpool_cancel(Columns.workers);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static int readField(Snapshot *snapshot, const char *name, int fieldIndex, void *fieldValue, int maxLen)
+{
+    const SVNObject *obj = snapshot_find(snapshot, name);
+
+    if (!obj)
     {
         return FT_NOSUCHFIELD;
     }
@@ -501,33 +1402,128 @@ int __stdcall FsContentGetValue(char *fileName, int fieldIndex, int unitIndex, v
     switch (fieldIndex)
     {
         case FI_REVISION:
-            *((long*)fieldValue) = snapshot->current->dirent.created_rev;
+            *((long*)fieldValue) = obj->createdRev;
             break;
         case FI_AUTHOR:
-            if (snapshot->current->dirent.last_author)
+        {
+            const char *author = snapshot_author(snapshot, obj);
+            if (author)
             {
                 strbuf_t s = { (char*) fieldValue, maxLen };
-                strbuf_cat(&s, snapshot->current->dirent.last_author, strlen(snapshot->current->dirent.last_author));
+                strbuf_cat(&s, author, strlen(author));
             }
             break;
-    }
+        }
+        case FI_MESSAGE:
+        case FI_CHANGES:
+        {
+            apr_uint32_t changedPaths;
+            char *message = (char*) fieldValue;
+
+            /* copied under revinfo's lock, updateLocations may drop the details meanwhile */
+            if (!revinfo_lookup(snapshot->location, obj->createdRev, &changedPaths, fieldIndex == FI_MESSAGE ? message : NULL, maxLen))
+            {
+                return apr_atomic_read32(&snapshot->revisionsFetched) ? FT_FIELDEMPTY : FT_DELAYED;
+            }
+            if (fieldIndex == FI_CHANGES)
+            {
+                *(int*)fieldValue = (int) changedPaths;
+            }
+            else if (!*message)
+            {
+                return FT_FIELDEMPTY;
+            }
+            break;
+        }
+        case FI_CHECKSUM:
+        {
+            static const char Hex[] = "0123456789abcdef";
+            const unsigned char *digest;
+            char *out = (char*) fieldValue;
+            int i;
 
-    return field->type;
+            if (obj->kind != svn_node_file || maxLen <= 2 * APR_MD5_DIGESTSIZE)
+            {
+                return FT_FIELDEMPTY;
+            }
+            if (!(digest = snapshot_checksum(snapshot, obj)))
+            {
+                return apr_atomic_read32(&snapshot->checksumsFetched) ? FT_FIELDEMPTY : FT_DELAYED;
+            }
+            for (i = 0; i < APR_MD5_DIGESTSIZE; ++i)
+            {
+                *out++ = Hex[digest[i] >> 4];
+                *out++ = Hex[digest[i] & 0xF];
+            }
+            *out = '\0';
+            break;
+        }
+        case FI_DATE:
+        {
+            /* the entry time is the date of its created revision */
+            const LONGLONG tmpLL = (obj->time + APR_TIME_C(11644473600000000)) * 10;
+            ((FILETIME*)fieldValue)->dwLowDateTime  = (DWORD) tmpLL;
+            ((FILETIME*)fieldValue)->dwHighDateTime = (DWORD) (tmpLL >> 32ll);
+            break;
+        }
+    }
+    return fields[fieldIndex].type;
 }
 
 /*--------------------------------------------------------------------------*/
-ExecResult __stdcall FsExecuteFile(HWND mainWin, char *remoteName, char *verb)
+static int readDifference(const char *fileName, const char *baseFileName, void *fieldValue, int maxLen)
 {
-    apr_pool_t *subPool;
-
-    if (!remoteName || *remoteName++ != '\\' )
+    static const char * const names[DIFF_MAX] =
     {
-        return FS_EXEC_ERROR;
+        NULL, "equal", "added", "deleted", "modified", "properties", "changed inside"
+    };
+    char subPath[MAX_PATH];
+    size_t subPathLen;
+    const Location *loc;
+    DiffStatus status;
+
+    apr_thread_mutex_lock(Columns.mutex);
+    loc = location_resolve(&Config.locations, fileName, baseFileName - fileName, subPath, sizeof(subPath), &subPathLen);
+    apr_thread_mutex_unlock(Columns.mutex);
+    if (!loc)
+    {
+        return FT_FILEERROR;
     }
 
-    subPool = svn_pool_create(Subversion.pool);
-
-    if (!strnicmp(verb, "open", 4))
+    status = diffsum_status(loc, subPath, subPathLen, baseFileName);
+    if (status == DIFF_UNCOMPARED)
+    {
+        return FT_FIELDEMPTY;
+    }
+    {
+        strbuf_t s = { (char*) fieldValue, maxLen };
+        strbuf_cat(&s, names[status], strlen(names[status]));
+    }
+    return fields[FI_DIFF].type;
+}
+
+/*--------------------------------------------------------------------------*/
+ExecResult __stdcall FsExecuteFile(HWND mainWin, char *remoteName, char *verb)
+{
+    const apr_time_t start = trace_begin();
+    const ExecResult result = executeFile(mainWin, remoteName, verb);
+    trace_end(start, "fs", "FsExecuteFile", verb);
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+static ExecResult executeFile(HWND mainWin, char *remoteName, char *verb)
+{
+    apr_pool_t *subPool;
+
+    if (!remoteName || *remoteName++ != '\\' )
+    {
+        return FS_EXEC_ERROR;
+    }
+
+    subPool = svn_pool_create(Subversion.pool);
+
+    if (!strnicmp(verb, "open", 4))
     {
         if (!strcmp(remoteName, EditLocationsTitle.data))
         {
@@ -551,11 +1547,14 @@ ExecResult __stdcall FsExecuteFile(HWND mainWin, char *remoteName, char *verb)
             strbuf_cat(&s, Config.configFilePath.data, Config.configFilePath.len);
             strbuf_cat(&s, "\"", 1);
 
-            CreateProcess(NULL, buf, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+            if (!CreateProcess(NULL, buf, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi))
+            {
+                displayErrorMessage("Unable to start the editor!");
+                return svn_pool_destroy(subPool), FS_EXEC_ERROR;
+            }
+            /* don't wait for the editor, the configuration is reloaded once it has been saved */
             CloseHandle(pi.hThread);
-            WaitForSingleObject(pi.hProcess, INFINITE);
             CloseHandle(pi.hProcess);
-            loadConfig();
 
             return svn_pool_destroy(subPool), FS_EXEC_OK;
         }
@@ -581,24 +1580,58 @@ ExecResult __stdcall FsExecuteFile(HWND mainWin, char *remoteName, char *verb)
         char *buf;
 
         verb += 6; /* skip "quote " */
+        if (!strnicmp(verb, "find", 4) && (!verb[4] || isspace(verb[4])))
+        {
+            char *pattern, *end;
+            verb += 4;
+            while (isspace(*verb) || *verb == '"') ++verb;
+            pattern = apr_pstrdup(subPool, verb);
+            end = pattern + strlen(pattern);
+            while (end > pattern && (isspace(end[-1]) || end[-1] == '"')) *--end = '\0';
+            findFiles(mainWin, remoteName, pattern, subPool);
+            return svn_pool_destroy(subPool), FS_EXEC_OK;
+        }
+        if (!strnicmp(verb, "diff", 4) && (!verb[4] || isspace(verb[4])))
+        {
+            char *base, *end;
+            verb += 4;
+            while (isspace(*verb) || *verb == '"') ++verb;
+            base = apr_pstrdup(subPool, verb);
+            end = base + strlen(base);
+            while (end > base && (isspace(end[-1]) || end[-1] == '"')) *--end = '\0';
+            if (*base)
+            {
+                compareTrees(mainWin, remoteName, base, subPool);
+            }
+            else
+            {
+                diffsum_clear(NULL);
+            }
+            return svn_pool_destroy(subPool), FS_EXEC_OK;
+        }
         while (command->cmd.data)
         {
             if (!strnicmp(verb, command->cmd.data, command->cmd.len))
             {
-                size_t argLen;
+                size_t argLen, len;
                 verb += command->cmd.len;
-                while (isspace(*verb) || *verb == '"') ++verb;
+                while (isspace(*verb) || *verb == '"' || *verb == '\\' || *verb == '/') ++verb;
                 argLen = strlen(verb);
-                buf = remoteNameToSvnURI(remoteName, subPool, argLen);
+                while (argLen && (isspace(verb[argLen - 1]) || verb[argLen - 1] == '"')) --argLen;
 
-                if (*verb)
+                buf = apr_palloc(subPool, LOCATION_URL_SIZE);
+                len = location_url(&Config.locations, remoteName, strlen(remoteName), buf, LOCATION_URL_SIZE, NULL);
+                if (len && argLen && len < LOCATION_URL_SIZE - 1)
+                {
+                    /* the parameter is relative to the current directory */
+                    buf[len++] = '/';
+                    len += location_escape(verb, argLen, buf + len, LOCATION_URL_SIZE - len);
+                }
+                if (!len || len >= LOCATION_URL_SIZE)
                 {
-                    strbuf_t s = { buf + strlen(buf), argLen + 1 };
-                    strbuf_cat(&s, verb, argLen);
-                    verb = s.data - 1;
-                    while (isspace(*verb) || *verb == '"') *verb-- = '\0';
+                    return svn_pool_destroy(subPool), FS_EXEC_ERROR;
                 }
-                command->proc(escapeURI(buf, subPool));
+                command->proc(buf);
                 return svn_pool_destroy(subPool), FS_EXEC_OK;
             }
             ++command;
@@ -621,6 +1654,8 @@ ExecResult __stdcall FsExecuteFile(HWND mainWin, char *remoteName, char *verb)
                 strbuf_cat(&s, "\n", 1);
                 ++command;
             }
+            strbuf_cat(&s, "find\t<pattern>\tList files by name, * and ? are wildcards\n", 57);
+            strbuf_cat(&s, "diff\t[base]\tCompare with a URL or plugin path, none ends it\n", 60);
             strbuf_cat(&s, "\n\nIf the parameter is omitted, the current directory is assumed.", 64);
             MessageBox(mainWin, buf, "Subversion Plugin", MB_OK | MB_ICONINFORMATION);
         }
@@ -645,7 +1680,22 @@ int __stdcall FsExtractCustomIcon(char *remoteName, int extractFlags, HICON *ico
 /*--------------------------------------------------------------------------*/
 void __stdcall FsContentPluginUnloading(void)
 {
+    workerpool_destroy(Prefetch.workers);
+    Prefetch.workers = NULL;
+    workerpool_destroy(Streaming.workers);
+    Streaming.workers = NULL;
+    workerpool_destroy(Download.workers);
+    Download.workers = NULL;
+    workerpool_destroy(Indexer.workers);
+    Indexer.workers = NULL;
+    workerpool_destroy(Columns.workers);
+    Columns.workers = NULL;
     freeLocationsAndSnapshots();
+    if (Config.changes)
+    {
+        FindCloseChangeNotification(Config.changes);
+        Config.changes = NULL;
+    }
     if (Subversion.pool)
     {
         svn_pool_destroy(Subversion.pool);
@@ -663,6 +1713,28 @@ void __stdcall FsSetDefaultParams(FsDefaultParamStruct *dps)
     Config.configFilePath.data = apr_palloc(Subversion.pool, Config.configFilePath.len);
     memcpy(Config.configFilePath.data, dps->DefaultIniName, p - dps->DefaultIniName);
     memcpy(Config.configFilePath.data + (p - dps->DefaultIniName), ConfigFileName.data, ConfigFileName.len + 1);
+    Config.cacheDirPath.len = p - dps->DefaultIniName + CacheDirName.len;
+    Config.cacheDirPath.data = apr_palloc(Subversion.pool, Config.cacheDirPath.len + 1);
+    memcpy(Config.cacheDirPath.data, dps->DefaultIniName, p - dps->DefaultIniName);
+    memcpy(Config.cacheDirPath.data + (p - dps->DefaultIniName), CacheDirName.data, CacheDirName.len + 1);
+    Config.fileStorePath.len = Config.cacheDirPath.len + FileStoreDirName.len;
+    Config.fileStorePath.data = apr_palloc(Subversion.pool, Config.fileStorePath.len + 1);
+    memcpy(Config.fileStorePath.data, Config.cacheDirPath.data, Config.cacheDirPath.len);
+    memcpy(Config.fileStorePath.data + Config.cacheDirPath.len, FileStoreDirName.data, FileStoreDirName.len + 1);
+    Config.indexPath.len = Config.cacheDirPath.len + IndexDirName.len;
+    Config.indexPath.data = apr_palloc(Subversion.pool, Config.indexPath.len + 1);
+    memcpy(Config.indexPath.data, Config.cacheDirPath.data, Config.cacheDirPath.len);
+    memcpy(Config.indexPath.data + Config.cacheDirPath.len, IndexDirName.data, IndexDirName.len + 1);
+    if (!Config.changes)
+    {
+        /* editors may replace the file rather than write to it */
+        char *dir = apr_pstrndup(Subversion.pool, dps->DefaultIniName, p - dps->DefaultIniName);
+        Config.changes = FindFirstChangeNotification(dir, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+        if (Config.changes == INVALID_HANDLE_VALUE)
+        {
+            Config.changes = NULL;
+        }
+    }
     loadConfig();
 }
 
@@ -677,351 +1749,2150 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
 }
 
 /*--------------------------------------------------------------------------*/
-static char *escapeURI(const char *uri, apr_pool_t *pool)
+static svn_error_t *listDirectory(svn_ra_session_t *session, void *baton, apr_pool_t *pool)
 {
-   const size_t uriLen = strlen(uri);
-
-   if (uriLen)
-   {
-      const char *s = uri;
-      char *dst = apr_palloc(pool, uriLen * 3 + 1);
-      char *d = dst;
+    Snapshot *snapshot = baton;
+    const svn_revnum_t peg = snapshot->location->revision;
+    apr_hash_t *dirents, *props;
+    apr_hash_index_t *hi;
+    svn_revnum_t fetchedRev;
+    const svn_string_t *createdRev;
+
+    TRACE_SVN_ERR("ra", "svn_ra_get_dir2",
+                  svn_ra_get_dir2(session, &dirents, &fetchedRev, &props, "", peg, SVN_DIRENT_CREATED_REV | SVN_DIRENT_KIND | SVN_DIRENT_LAST_AUTHOR | SVN_DIRENT_SIZE | SVN_DIRENT_TIME, pool));
+
+    /* the entry props of the directory itself carry its created revision */
+    createdRev = apr_hash_get(props, SVN_PROP_ENTRY_COMMITTED_REV, APR_HASH_KEY_STRING);
+    snapshot->createdRev = createdRev ? atoi(createdRev->data) : -1;
+    for (hi = apr_hash_first(pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+        const void *name;
+        void *dirent;
+        apr_hash_this(hi, &name, NULL, &dirent);
+        snapshot_add(snapshot, name, dirent);
+    }
+    snapshot_confirm(snapshot, fetchedRev);
+    /* a revision never changes */
+    snapshot->pinned = SVN_IS_VALID_REVNUM(peg);
+    return SVN_NO_ERROR;
+}
 
-      while (*s)
-      {
-         if (!strchr(" %<>\"{}|\\^`#;?[]", *s))
-         {
-            *d++ = *s;
-         }
-         else
-         {
-            static const char *hexchars  = "0123456789ABCDEF";
-            *d++ = '%';
-            *d++ = hexchars[*s >> 4];
-            *d++ = hexchars[*s & 0xf];
-         }
+/*--------------------------------------------------------------------------*/
+static svn_error_t *statDirectory(svn_ra_session_t *session, void *baton, apr_pool_t *pool)
+{
+    InfoResult *result = baton;
+    svn_dirent_t *dirent;
 
-         ++s;
-      }
-      *d = '\0';
-      return dst;
-   }
-   return NULL;
+    TRACE_SVN_ERR("ra", "svn_ra_get_latest_revnum", svn_ra_get_latest_revnum(session, &result->rev, pool));
+    TRACE_SVN_ERR("ra", "svn_ra_stat", svn_ra_stat(session, "", result->rev, &dirent, pool));
+    result->lastChangedRev = dirent ? dirent->created_rev : SVN_INVALID_REVNUM;
+    return SVN_NO_ERROR;
 }
 
 /*--------------------------------------------------------------------------*/
-static svn_error_t* list_func(Snapshot *snapshot,
-                              const char *path,
-                              const svn_dirent_t  *dirent,
-                              const svn_lock_t  *lock,
-                              const char *abs_path,
-                              apr_pool_t *pool)
+static svn_error_t *getRevisions(svn_ra_session_t *session, void *baton, apr_pool_t *pool)
 {
-    if (*path)
+    const RevisionSet *set = baton;
+    apr_array_header_t *paths = apr_array_make(pool, 1, sizeof(const char*));
+    apr_array_header_t *revprops = apr_array_make(pool, 1, sizeof(const char*));
+    apr_pool_t *iterpool = svn_pool_create(pool);
+    const char *root;
+    size_t first, last;
+
+    /* Every revision exists at the root, while the directory may have been
+       created after some entries were last changed, e.g. by copying a tag. */
+    SVN_ERR(svn_ra_get_repos_root2(session, &root, pool));
+    SVN_ERR(svn_ra_reparent(session, root, pool));
+    APR_ARRAY_PUSH(paths, const char*) = "";
+    APR_ARRAY_PUSH(revprops, const char*) = SVN_PROP_REVISION_LOG;
+    for (first = 0; first < set->count; first = last + 1)
     {
-        SVNObject *obj = malloc(sizeof(*obj));
-        memcpy(&obj->dirent, dirent, sizeof(*dirent));
-        obj->dirent.last_author = strdup(obj->dirent.last_author);
-        obj->name = strdup(path);
-        obj->next = snapshot->entries;
-        snapshot->entries = obj;
+        for (last = first; last + 1 < set->count && set->revisions[last + 1] - set->revisions[first] < MaxRevisionRun; ++last);
+        svn_pool_clear(iterpool);
+        stats_add(STAT_REVISION_LOGS, 1);
+        TRACE_SVN_ERR("ra", "svn_ra_get_log2",
+                      svn_ra_get_log2(session, paths, set->revisions[last], set->revisions[first], 0, TRUE, FALSE, FALSE,
+                                      revprops, &storeRevision, baton, iterpool));
     }
+    svn_pool_destroy(iterpool);
+    return SVN_NO_ERROR;
+}
 
-    return 0;
+/*--------------------------------------------------------------------------*/
+static svn_error_t *storeRevision(void *baton, svn_log_entry_t *entry, apr_pool_t *pool)
+{
+    const RevisionSet *set = baton;
+    const svn_string_t *message = entry->revprops ? apr_hash_get(entry->revprops, SVN_PROP_REVISION_LOG, APR_HASH_KEY_STRING) : NULL;
+
+    /* every revision received is kept, the subdirectories are likely to need them */
+    revinfo_store(set->location, entry->revision,
+                  entry->changed_paths ? apr_hash_count(entry->changed_paths) : 0,
+                  message ? message->data : NULL);
+    return SVN_NO_ERROR;
 }
 
 /*--------------------------------------------------------------------------*/
-static svn_error_t *querySnapshot(Snapshot *snapshot, const char *path)
+static svn_error_t *getChecksums(svn_ra_session_t *session, void *baton, apr_pool_t *pool)
 {
-    const size_t pathLen = strlen(path);
-    Location *loc = Config.locations;
-    while (loc)
+    ChecksumReport *report = baton;
+    svn_delta_editor_t *editor = svn_delta_default_editor(pool);
+    const svn_ra_reporter3_t *reporter;
+    void *reportBaton;
+    svn_revnum_t revision = (svn_revnum_t) apr_atomic_read32(&report->snapshot->revision);
+    svn_error_t *err;
+
+    /* the files as listed, which is the peg revision of a pinned location */
+    if (!SVN_IS_VALID_REVNUM(revision))
     {
-        const int minLen = min(loc->title.len, pathLen);
-        if (!strncmp(path, loc->title.data, minLen))
-        {
-            /* found it, fetch data from SVN */
-            apr_pool_t *subPool = svn_pool_create(Subversion.pool);
-            svn_error_t *err;
-            svn_opt_revision_t revision;
-            size_t subPathLen = strlen(path + minLen);
-            char *buf = apr_palloc(subPool, loc->url.len + subPathLen + 1);
-            strbuf_t s = { buf, loc->url.len + subPathLen + 1 };
-
-            snapshot->location = loc;
-            snapshot->entries = NULL;
-            revision.kind = svn_opt_revision_head;
-            strbuf_cat(&s, loc->url.data, loc->url.len);
-            if (subPathLen)
-            {
-                /* nested location */
-                strbuf_cat(&s, path  + minLen, subPathLen);
-                slashify(buf + loc->url.len);
-                /* trim trailing slashes, SVN doesn't like those */
-                while (s.data[-1] == '/')
-                {
-                    *(--s.data) = '\0';
-                    ++s.size;
-                    --subPathLen;
-                }
-            }
-            err = svn_client_list2(escapeURI(buf, subPool), &revision, &revision, svn_depth_immediates, SVN_DIRENT_CREATED_REV | SVN_DIRENT_KIND | SVN_DIRENT_LAST_AUTHOR | SVN_DIRENT_SIZE | SVN_DIRENT_TIME, FALSE, (svn_client_list_func_t) list_func, snapshot, Subversion.ctx, subPool);
-            svn_pool_destroy(subPool);
-            if (!err)
-            {
-                snapshot->subPath.data = malloc(subPathLen + 1);
-                snapshot->subPath.len = subPathLen;
-                memcpy(snapshot->subPath.data, path + minLen, snapshot->subPath.len + 1);
+        TRACE_SVN_ERR("ra", "svn_ra_get_latest_revnum", svn_ra_get_latest_revnum(session, &revision, pool));
+    }
+    editor->open_root = &openChecksumRoot;
+    editor->add_file = &addChecksumFile;
+    editor->close_file = &closeChecksumFile;
+    SVN_ERR(svn_ra_do_status2(session, &reporter, &reportBaton, "", revision, svn_depth_files, editor, report, pool));
 
-                snapshot->current = snapshot->entries;
-            }
-            return err;
-        }
-        loc = loc->next;
+    /* claim an empty directory, so that the server reports every file as added, checksum included */
+    if ((err = reporter->set_path(reportBaton, "", revision, svn_depth_files, TRUE, NULL, pool)))
+    {
+        svn_error_clear(reporter->abort_report(reportBaton, pool));
+        return err;
     }
+    TRACE_SVN_ERR("ra", "svn_ra_do_status2", reporter->finish_report(reportBaton, pool));
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *openChecksumRoot(void *editBaton, svn_revnum_t baseRevision, apr_pool_t *pool, void **rootBaton)
+{
+    *rootBaton = editBaton;
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *addChecksumFile(const char *path, void *parentBaton, const char *copyfromPath, svn_revnum_t copyfromRevision, apr_pool_t *pool, void **fileBaton)
+{
+    ChecksumReport *report = parentBaton;
+    const SVNObject *obj = snapshot_find(report->snapshot, svn_path_basename(path, pool));
 
-    return svn_error_create(SVN_ERR_BAD_URL, NULL, "Unknown Location");
+    /* files added since the listing have no entry */
+    *fileBaton = obj ? report->checksums + (obj - report->snapshot->entries) * APR_MD5_DIGESTSIZE : NULL;
+    return SVN_NO_ERROR;
 }
 
 /*--------------------------------------------------------------------------*/
-static int initSvn(void)
+static svn_error_t *closeChecksumFile(void *fileBaton, const char *textChecksum, apr_pool_t *pool)
 {
-    svn_error_t *err;
+    unsigned char *digest = fileBaton;
 
-    if (apr_initialize() != APR_SUCCESS)
+    if (digest)
     {
-        MessageBox(NULL, "apr_initialize failed!", NULL, MB_OK | MB_ICONERROR);
-        return -1;
+        /* an invalid checksum leaves it unknown */
+        parseChecksum(digest, textChecksum);
     }
-    Subversion.pool = svn_pool_create(NULL);
-    do {
-        if ((err = svn_fs_initialize(Subversion.pool)))
-            break;
-        if ((err = svn_client_create_context(&Subversion.ctx, Subversion.pool)))
-            break;
-        if ((err = svn_config_get_config(&(Subversion.ctx->config), NULL, Subversion.pool)))
-            break;
+    return SVN_NO_ERROR;
+}
 
-        /* Make the client_ctx capable of authenticating users */
-        {
-            svn_auth_provider_object_t *provider;
-            apr_array_header_t *providers = apr_array_make(Subversion.pool, 4, sizeof(provider));
+/*--------------------------------------------------------------------------*/
+static int parseChecksum(unsigned char *digest, const char *hex)
+{
+    unsigned char parsed[APR_MD5_DIGESTSIZE];
+    int i;
 
-            svn_auth_get_simple_prompt_provider(&provider, promptCallback, NULL, /* baton */ 2, /* retry limit */ Subversion.pool);
-            APR_ARRAY_PUSH (providers, svn_auth_provider_object_t *) = provider;
+    if (!hex || strlen(hex) != 2 * APR_MD5_DIGESTSIZE)
+    {
+        return FALSE;
+    }
+    for (i = 0; i < 2 * APR_MD5_DIGESTSIZE; ++i)
+    {
+        const int c = tolower((unsigned char) hex[i]);
+        const int nibble = isdigit(c) ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+        if (nibble < 0)
+        {
+            return FALSE;
+        }
+        parsed[i / 2] = (unsigned char) ((i & 1) ? parsed[i / 2] | nibble : nibble << 4);
+    }
+    memcpy(digest, parsed, APR_MD5_DIGESTSIZE);
+    return TRUE;
+}
 
-            svn_auth_get_username_prompt_provider(&provider, promptCallbackUsername, NULL, /* baton */ 2, /* retry limit */ Subversion.pool);
-            APR_ARRAY_PUSH (providers, svn_auth_provider_object_t *) = provider;
+/*--------------------------------------------------------------------------*/
+static svn_error_t *getYoungest(svn_ra_session_t *session, void *baton, apr_pool_t *pool)
+{
+    TRACE_SVN_ERR("ra", "svn_ra_get_latest_revnum", svn_ra_get_latest_revnum(session, baton, pool));
+    return SVN_NO_ERROR;
+}
 
-            svn_auth_get_ssl_server_trust_prompt_provider(&provider, promptSSLTrustAny, NULL, Subversion.pool);
-            APR_ARRAY_PUSH(providers, svn_auth_provider_object_t *) = provider;
+/*--------------------------------------------------------------------------*/
+static svn_error_t *fetchFile(svn_ra_session_t *session, void *baton, apr_pool_t *pool)
+{
+    Transfer *transfer = baton;
+    svn_stream_t *stream = svn_stream_create(transfer, pool);
+    apr_off_t offset = 0;
+    apr_hash_t *props;
+    const svn_string_t *createdRev;
+
+    /* start over if a stale session failed halfway through */
+    apr_file_seek(transfer->file, APR_SET, &offset);
+    apr_file_trunc(transfer->file, 0);
+    transfer->done = 0;
+    transfer->out = svn_stream_from_aprfile2(transfer->file, TRUE, pool);
+    svn_stream_set_write(stream, &countTransfer);
+    TRACE_SVN_ERR("ra", "svn_ra_get_file", svn_ra_get_file(session, "", transfer->revision, stream, NULL, &props, pool));
+
+    /* the entry props tell which revision the contents were committed in */
+    createdRev = apr_hash_get(props, SVN_PROP_ENTRY_COMMITTED_REV, APR_HASH_KEY_STRING);
+    transfer->createdRev = createdRev ? atol(createdRev->data) : SVN_INVALID_REVNUM;
+    return SVN_NO_ERROR;
+}
 
-            /* Register the auth-providers into the context's auth_baton. */
-            svn_auth_open (&Subversion.ctx->auth_baton, providers, Subversion.pool);
-        }
+/*--------------------------------------------------------------------------*/
+static svn_error_t *countTransfer(void *baton, const char *data, apr_size_t *len)
+{
+    Transfer *transfer = baton;
 
-        return 0;
-    } while (0);
-    displaySvnErrorMessage(err);
-    svn_pool_destroy(Subversion.pool);
-    return -1;
+    SVN_ERR(svn_stream_write(transfer->out, data, len));
+    transfer->done += *len;
+    return reportTransfer(transfer);
 }
 
 /*--------------------------------------------------------------------------*/
-static void loadConfig(void)
+static svn_error_t *cancelForeground(void *baton)
 {
-    FILE *f;
+    Transfer *transfer = Subversion.transfer;
 
-    if ((f = fopen(Config.configFilePath.data, "r")))
+    /* without column threads, TC's background thread uses the context as well */
+    if (transfer && apr_os_thread_equal(Subversion.transferThread, apr_os_thread_current()))
     {
-        char buf[1024];
+        return reportTransfer(transfer);
+    }
+    return SVN_NO_ERROR;
+}
 
-        freeLocationsAndSnapshots();
+/*--------------------------------------------------------------------------*/
+static svn_error_t *reportTransfer(void *baton)
+{
+    Transfer *transfer = baton;
+    apr_time_t now;
 
-        while (fgets(buf, sizeof(buf), f))
+    if (!transfer->remoteName)
+    {
+        return SVN_NO_ERROR;
+    }
+    now = apr_time_now();
+    if (now >= transfer->nextReport)
+    {
+        const int percent = transfer->size > 0 ? (int) (min(transfer->done, transfer->size) * 100 / transfer->size) : 0;
+        transfer->nextReport = now + apr_time_from_msec(100);
+        if (Plugin.progress(Plugin.id, transfer->remoteName, transfer->localName, percent))
         {
-            const char *p = buf, *left;
-
-            while (isspace(*p)) ++p;
-            if (*p == '#')
-            {
-                continue;
-            }
-            left = p;
-            while (*p && *p != '\\' && *p != '=') ++p;
-            if (*p == '\\')
-            {
-                /* Backslashes are disallowed */
-                continue;
-            }
-            if (*p == '=')
-            {
-                const char *equals = p;
-                Location *loc = malloc(sizeof(*loc));
+            return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+        }
+    }
+    return SVN_NO_ERROR;
+}
 
-                while ((p > left) && isspace(p[-1])) --p;
-                if (p > left)
-                {
-                    loc->title.data = malloc(p - left + 1);
-                    memcpy(loc->title.data, left, p - left);
-                    loc->title.data[p - left] = '\0';
-                    loc->title.len = p - left;
-                }
-                else
-                {
-                    loc->title.data = NULL;
-                    loc->title.len = 0;
-                }
+/*--------------------------------------------------------------------------*/
+static svn_error_t *fetchRevisions(Snapshot *snapshot, svn_client_ctx_t *ctx, apr_pool_t *pool)
+{
+    RevisionSet set;
+    char url[LOCATION_URL_SIZE];
+    svn_error_t *err;
+    size_t i, distinct;
 
-                p = equals + 1;
-                while (*p && isspace(*p)) ++p;
-                left = p;
-                while (*p && *p != '\n') ++p;
-                if (p > left)
-                {
-                    loc->url.data = malloc(p - left + 1);
-                    memcpy(loc->url.data, left, p - left);
-                    loc->url.data[p - left] = '\0';
-                    loc->url.len = p - left;
-                }
-                else
-                {
-                    /* malformed */
-                    free(loc->title.data);
-                    free(loc);
-                    continue;
-                }
+    if (apr_atomic_read32(&snapshot->revisionsFetched))
+    {
+        return SVN_NO_ERROR;
+    }
 
-                loc->next = Config.locations;
-                Config.locations = loc;
-            }
+    set.location = snapshot->location;
+    set.revisions = apr_palloc(pool, snapshot->count * sizeof(*set.revisions));
+    set.count = 0;
+    for (i = 0; i < snapshot->count; ++i)
+    {
+        const svn_revnum_t rev = snapshot->entries[i].createdRev;
+        if (SVN_IS_VALID_REVNUM(rev) && !revinfo_lookup(set.location, rev, NULL, NULL, 0))
+        {
+            set.revisions[set.count++] = rev;
         }
-
-        fclose(f);
     }
-    else if (f = fopen(Config.configFilePath.data, "w"))
+    if (!set.count)
     {
-        static const char *defaultIniContents = "# svn_wfx configuration file. Layout:\n"
-                                                "# title = svn_url\n"
-                                                "# title may contain any character except Backslash (\\)\n"
-                                                "# Lines starting with # or malformed lines are ignored.\n"
-                                                "# Awesome Repository = svn://localhost/awesome\n\n";
-        fprintf(f, defaultIniContents);
-        fclose(f);
+        apr_atomic_set32(&snapshot->revisionsFetched, TRUE);
+        return SVN_NO_ERROR;
     }
-    else
+    qsort(set.revisions, set.count, sizeof(*set.revisions), &compareRevisions);
+    for (i = 1, distinct = 1; i < set.count; ++i)
     {
-        MessageBox(NULL, "Unable to access configuration file!", NULL, MB_OK | MB_ICONERROR);
+        if (set.revisions[i] != set.revisions[distinct - 1])
+        {
+            set.revisions[distinct++] = set.revisions[i];
+        }
     }
+    set.count = distinct;
+
+    /* the entries were last changed at or before the listed revision, so the log never reaches beyond it */
+    location_node_url(set.location, snapshot->subPath.data, snapshot->subPath.len, url, sizeof(url));
+    err = sessionpool_run(set.location, url, ctx, &getRevisions, &set, pool);
+    /* a failed log is not retried until the directory is listed again */
+    apr_atomic_set32(&snapshot->revisionsFetched, TRUE);
+    return err;
 }
 
 /*--------------------------------------------------------------------------*/
-static void getSvnNode(SVNObject *obj, WIN32_FIND_DATA *findData)
+static svn_error_t *fetchChecksums(Snapshot *snapshot, svn_client_ctx_t *ctx, apr_pool_t *pool)
 {
+    ChecksumReport report;
+    char url[LOCATION_URL_SIZE];
+    svn_error_t *err;
+    size_t i;
+
+    if (apr_atomic_read32(&snapshot->checksumsFetched))
     {
-        strbuf_t s = { findData->cFileName, sizeof(findData->cFileName) };
-        strbuf_cat(&s, obj->name, strlen(obj->name));
+        return SVN_NO_ERROR;
     }
 
-    findData->dwFileAttributes = FILE_ATTRIBUTE_READONLY;
-
+    for (i = 0; i < snapshot->count && snapshot->entries[i].kind != svn_node_file; ++i);
+    if (i == snapshot->count)
     {
-        const LONGLONG tmpLL = (obj->dirent.time + APR_TIME_C(11644473600000000)) * 10;
-        findData->ftLastWriteTime.dwLowDateTime  = (DWORD) tmpLL;
-        findData->ftLastWriteTime.dwHighDateTime = (DWORD) (tmpLL >> 32ll);
+        apr_atomic_set32(&snapshot->checksumsFetched, TRUE);
+        return SVN_NO_ERROR;
     }
 
-    if (obj->dirent.kind == svn_node_dir)
+    /* the repository keeps the checksum of every file, a status report tells them without the contents */
+    stats_add(STAT_CHECKSUM_REPORTS, 1);
+    report.snapshot = snapshot;
+    report.checksums = calloc(snapshot->count, APR_MD5_DIGESTSIZE);
+    location_node_url(snapshot->location, snapshot->subPath.data, snapshot->subPath.len, url, sizeof(url));
+    err = sessionpool_run(snapshot->location, url, ctx, &getChecksums, &report, pool);
+    if (err)
     {
-        findData->dwFileAttributes |= FILE_ATTRIBUTE_DIRECTORY;
-        findData->nFileSizeLow  = 0;
-        findData->nFileSizeHigh = 0;
+        free(report.checksums);
     }
     else
     {
-        findData->nFileSizeLow  = (DWORD) obj->dirent.size;
-        findData->nFileSizeHigh = (DWORD) (obj->dirent.size >> 32ll);
+        snapshot_set_checksums(snapshot, report.checksums);
     }
+    /* a failed report is not retried until the directory is listed again */
+    apr_atomic_set32(&snapshot->checksumsFetched, TRUE);
+    return err;
 }
 
 /*--------------------------------------------------------------------------*/
-static void replaceAll(char *str, char oldVal, char newVal)
+static svn_error_t *fetchDetails(Snapshot *snapshot, int details, svn_client_ctx_t *ctx, apr_pool_t *pool)
 {
-    while (*str)
-    {
-        if (*str == oldVal) *str = newVal;
-        ++str;
-    }
+    return details == CD_CHECKSUMS ? fetchChecksums(snapshot, ctx, pool) : fetchRevisions(snapshot, ctx, pool);
 }
 
 /*--------------------------------------------------------------------------*/
-static __inline void slashify(char *str)
+static Snapshot *loadStoredSnapshot(const Location *loc, const char *subPath, size_t subPathLen)
 {
-    replaceAll(str, '\\', '/');
+    const size_t keySize = loc->key.len + subPathLen + 1;
+    char *key = malloc(keySize);
+    strbuf_t k = { key, keySize };
+    Snapshot *snapshot;
+
+    /* see snapshotKey */
+    strbuf_cat(&k, loc->key.data, loc->key.len);
+    strbuf_cat(&k, subPath, subPathLen);
+    snapshot = diskcache_load(loc, subPath, subPathLen, key);
+    free(key);
+    if (snapshot)
+    {
+        snapshot->pinned = SVN_IS_VALID_REVNUM(loc->revision);
+        stats_add(STAT_DISK_HITS, 1);
+        trace_mark("cache", "disk hit", subPath);
+        snapcache_insert(snapshot);
+    }
+    return snapshot;
 }
 
 /*--------------------------------------------------------------------------*/
-static void destroySnapshot(Snapshot *snapshot)
+static svn_error_t *listSnapshot(Snapshot *snapshot, svn_client_ctx_t *ctx, apr_pool_t *pool)
 {
-    if (snapshot)
+    const Location *loc = snapshot->location;
+    apr_pool_t *subPool = svn_pool_create(pool);
+    svn_error_t *err;
+    char url[LOCATION_URL_SIZE];
+    const apr_time_t start = apr_time_now();
+
+    location_node_url(loc, snapshot->subPath.data, snapshot->subPath.len, url, sizeof(url));
+    err = sessionpool_run(loc, url, ctx, &listDirectory, snapshot, subPool);
+    stats_record_listing(loc->stats, start, err != NULL);
+    if (err)
     {
-        SVNObject *obj = snapshot->entries;
-        SVNObject *oldObj;
-        free(snapshot->subPath.data);
-        snapshot->subPath.data = NULL;
-        snapshot->entries = NULL;
-        while (obj)
+        if (snapshot->streamMutex)
         {
-            free(obj->name);
-            free((char*) obj->dirent.last_author);
-            oldObj = obj;
-            obj = obj->next;
-            free(oldObj);
+            snapshot_fail(snapshot, err->message ? err->message : "Listing failed");
         }
     }
+    else
+    {
+        snapshot_finish(snapshot);
+        snapcache_insert(snapshot);
+        diskcache_store(snapshot, snapshotKey(snapshot, subPool));
+    }
+    svn_pool_destroy(subPool);
+    return err;
 }
 
 /*--------------------------------------------------------------------------*/
-static void freeLocationsAndSnapshots(void)
+static char *snapshotKey(const Snapshot *snapshot, apr_pool_t *pool)
+{
+    const Location *loc = snapshot->location;
+    char *buf = apr_palloc(pool, loc->key.len + snapshot->subPath.len + 1);
+    strbuf_t s = { buf, loc->key.len + snapshot->subPath.len + 1 };
+    strbuf_cat(&s, loc->key.data, loc->key.len);
+    strbuf_cat(&s, snapshot->subPath.data, snapshot->subPath.len);
+    return buf;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *checkSnapshot(svn_boolean_t *unchanged, Snapshot *snapshot, svn_client_ctx_t *ctx, apr_pool_t *pool)
+{
+    apr_pool_t *subPool = svn_pool_create(pool);
+    InfoResult result = { SVN_INVALID_REVNUM, SVN_INVALID_REVNUM };
+    char url[LOCATION_URL_SIZE];
+    svn_error_t *err;
+
+    *unchanged = FALSE;
+    location_node_url(snapshot->location, snapshot->subPath.data, snapshot->subPath.len, url, sizeof(url));
+    err = sessionpool_run(snapshot->location, url, ctx, &statDirectory, &result, subPool);
+    if (!err && SVN_IS_VALID_REVNUM(result.lastChangedRev) && result.lastChangedRev == snapshot->createdRev)
+    {
+        /* any change below a directory gives it a new created revision */
+        snapshot_confirm(snapshot, result.rev);
+        *unchanged = TRUE;
+    }
+    svn_pool_destroy(subPool);
+    return err;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *querySnapshot(Snapshot **snapshot, const Location *loc, const char *subPath, size_t subPathLen, svn_client_ctx_t *ctx, apr_pool_t *pool)
 {
-    Location *loc = Config.locations;
-    Location *oldLoc;
-    while (loc)
+    svn_error_t *err;
+    *snapshot = snapshot_create(loc, subPath, subPathLen);
+    err = listSnapshot(*snapshot, ctx, pool);
+    if (err)
     {
-        free(loc->title.data);
-        free(loc->url.data);
-        oldLoc = loc;
-        loc = loc->next;
-        free(oldLoc);
+        snapshot_release(*snapshot);
+        *snapshot = NULL;
     }
-    Config.locations = NULL;
-    destroySnapshot(&cachedSnapshot);
+    return err;
 }
 
 /*--------------------------------------------------------------------------*/
-static char *remoteNameToSvnURI(char *remoteName, apr_pool_t *pool, size_t overAllocate)
+static svn_error_t *getSnapshot(Snapshot **snapshot, const char *path, size_t pathLen, int flags)
 {
-    const Location *loc = Config.locations;
-    size_t remoteNameLen = strlen(remoteName);
-    while (loc)
+    char subPath[MAX_PATH];
+    size_t subPathLen;
+    const Location *loc = location_resolve(&Config.locations, path, pathLen, subPath, sizeof(subPath), &subPathLen);
+
+    if (!loc)
     {
-        if (!memcmp(remoteName, loc->title.data, min(remoteNameLen, loc->title.len)))
+        return svn_error_create(SVN_ERR_BAD_URL, NULL, "Unknown Location");
+    }
+
+    *snapshot = snapcache_lookup(loc, subPath, subPathLen);
+    if (*snapshot)
+    {
+        svn_boolean_t unchanged = FALSE;
+        if (!(flags & SF_REVALIDATE) || snapshot_fresh(*snapshot, Config.cacheTTL))
+        {
+            stats_add(STAT_CACHE_HITS, 1);
+            trace_mark("cache", "memory hit", subPath);
+            return SVN_NO_ERROR;
+        }
+        if ((*snapshot)->createdRev >= 0)
+        {
+            /* a failed check is reported by the listing below */
+            svn_error_clear(checkSnapshot(&unchanged, *snapshot, Subversion.ctx, Subversion.pool));
+            if (unchanged)
+            {
+                stats_add(STAT_CACHE_CONFIRMED, 1);
+                trace_mark("cache", "confirmed", subPath);
+                return SVN_NO_ERROR;
+            }
+        }
+        trace_mark("cache", "outdated", subPath);
+        snapshot_release(*snapshot);
+    }
+    else
+    {
+        /* Not listed since the plugin was loaded, or evicted since.
+           Show what was there last time right away and refresh it in
+           the background unless it is recent. */
+        *snapshot = loadStoredSnapshot(loc, subPath, subPathLen);
+        if (*snapshot)
         {
-            char *result;
-            remoteName += loc->title.len;
-            remoteNameLen -= loc->title.len;
-            result = apr_palloc(pool, remoteNameLen + loc->url.len + 1 + overAllocate);
-            slashify(remoteName);
-            memcpy(result, loc->url.data, loc->url.len);
-            memcpy(result + loc->url.len, remoteName, remoteNameLen + 1);
-            return result;
+            if ((flags & SF_REVALIDATE) && !snapshot_fresh(*snapshot, Config.cacheTTL))
+            {
+                scheduleRefresh(loc, subPath, subPathLen);
+            }
+            return SVN_NO_ERROR;
         }
+    }
 
-        loc = loc->next;
+    stats_add(STAT_CACHE_MISSES, 1);
+    trace_mark("cache", "miss", subPath);
+    if ((flags & SF_STREAM) && Streaming.workers)
+    {
+        /* list on a worker thread, the caller reads entries as they arrive */
+        StreamJob *job = malloc(sizeof(*job));
+        *snapshot = snapshot_create(loc, subPath, subPathLen);
+        snapshot_begin_stream(*snapshot);
+        job->job.run = &runStreamJob;
+        job->job.discard = &discardStreamJob;
+        job->snapshot = snapshot_acquire(*snapshot);
+        workerpool_submit(Streaming.workers, &job->job);
+        return SVN_NO_ERROR;
     }
+    return querySnapshot(snapshot, loc, subPath, subPathLen, Subversion.ctx, Subversion.pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static int initSvn(void)
+{
+    svn_error_t *err;
+
+    if (apr_initialize() != APR_SUCCESS)
+    {
+        MessageBox(NULL, "apr_initialize failed!", NULL, MB_OK | MB_ICONERROR);
+        return -1;
+    }
+    Subversion.pool = svn_pool_create(NULL);
+    do {
+        if ((err = svn_fs_initialize(Subversion.pool)))
+            break;
+        if ((err = createClientContext(&Subversion.ctx, TRUE, Subversion.pool)))
+            break;
+        Subversion.ctx->cancel_func = &cancelForeground;
+
+        snapcache_init(Subversion.pool);
+        sessionpool_init(Subversion.pool);
+        diskcache_init(Subversion.pool);
+        filestore_init(Subversion.pool);
+        nameindex_init(Subversion.pool);
+        intern_init(Subversion.pool);
+        revinfo_init(Subversion.pool);
+        diffsum_init(Subversion.pool);
+        stats_init();
+        apr_thread_mutex_create(&Prefetch.mutex, APR_THREAD_MUTEX_DEFAULT, Subversion.pool);
+        Prefetch.pending = apr_hash_make(Subversion.pool);
+        Prefetch.walkedPool = svn_pool_create(Subversion.pool);
+        Prefetch.walked = apr_hash_make(Prefetch.walkedPool);
+        apr_thread_mutex_create(&Download.mutex, APR_THREAD_MUTEX_DEFAULT, Subversion.pool);
+        Download.queuedPool = svn_pool_create(Subversion.pool);
+        Download.queued = apr_hash_make(Download.queuedPool);
+        Download.jobs = apr_hash_make(Download.queuedPool);
+        apr_thread_mutex_create(&Columns.mutex, APR_THREAD_MUTEX_DEFAULT, Subversion.pool);
+        apr_thread_cond_create(&Columns.cond, Subversion.pool);
+        Columns.pending[CD_REVISIONS] = apr_hash_make(Subversion.pool);
+        Columns.pending[CD_CHECKSUMS] = apr_hash_make(Subversion.pool);
+        apr_thread_cond_create(&Download.cond, Subversion.pool);
+        return 0;
+    } while (0);
+    displaySvnErrorMessage(err);
+    svn_pool_destroy(Subversion.pool);
+    return -1;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *createClientContext(svn_client_ctx_t **ctx, svn_boolean_t interactive, apr_pool_t *pool)
+{
+    SVN_ERR(svn_client_create_context(ctx, pool));
+    SVN_ERR(svn_config_get_config(&((*ctx)->config), NULL, pool));
+
+    /* Make the client_ctx capable of authenticating users */
+    {
+        svn_auth_provider_object_t *provider;
+        apr_array_header_t *providers = apr_array_make(pool, 4, sizeof(provider));
+
+        if (interactive)
+        {
+            svn_auth_get_simple_prompt_provider(&provider, promptCallback, NULL, /* baton */ 2, /* retry limit */ pool);
+            APR_ARRAY_PUSH (providers, svn_auth_provider_object_t *) = provider;
+
+            svn_auth_get_username_prompt_provider(&provider, promptCallbackUsername, NULL, /* baton */ 2, /* retry limit */ pool);
+            APR_ARRAY_PUSH (providers, svn_auth_provider_object_t *) = provider;
+        }
+        else
+        {
+            /* background threads must never prompt, use the credentials cached on disk */
+            svn_auth_get_windows_simple_provider(&provider, pool);
+            APR_ARRAY_PUSH (providers, svn_auth_provider_object_t *) = provider;
+
+            svn_auth_get_simple_provider(&provider, pool);
+            APR_ARRAY_PUSH (providers, svn_auth_provider_object_t *) = provider;
+
+            svn_auth_get_username_provider(&provider, pool);
+            APR_ARRAY_PUSH (providers, svn_auth_provider_object_t *) = provider;
+        }
+
+        svn_auth_get_ssl_server_trust_prompt_provider(&provider, promptSSLTrustAny, NULL, pool);
+        APR_ARRAY_PUSH(providers, svn_auth_provider_object_t *) = provider;
+
+        /* Register the auth-providers into the context's auth_baton. */
+        svn_auth_open (&(*ctx)->auth_baton, providers, pool);
+    }
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static void schedulePrefetch(const Snapshot *snapshot)
+{
+    size_t i;
+    int scheduled = 0;
+    const int subtree = Prefetch.subtree;
+
+    if (!Prefetch.workers)
+    {
+        return;
+    }
+
+    for (i = 0; i < snapshot->count && (subtree || scheduled < Config.prefetchChildren); ++i)
+    {
+        const SVNObject *obj = snapshot->entries + i;
+        if (obj->kind == svn_node_dir)
+        {
+            const char *name = snapshot_name(snapshot, obj);
+            const size_t nameLen = strlen(name);
+            const size_t subPathLen = snapshot->subPath.len + 1 + nameLen;
+            ListJob *job = createListJob(snapshot->location, subPathLen);
+            strbuf_t s = { job->subPath, subPathLen + 1 };
+
+            strbuf_cat(&s, snapshot->subPath.data, snapshot->subPath.len);
+            strbuf_cat(&s, "/", 1);
+            strbuf_cat(&s, name, nameLen);
+            if (!subtree && snapcache_contains(snapshot->location, job->subPath, subPathLen))
+            {
+                free(job);
+                continue;
+            }
+            /* cached children are only descended, which runListJob does off TC's thread */
+            job->subtree = subtree;
+            if (submitListJob(job))
+            {
+                ++scheduled;
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void scheduleRefresh(const Location *loc, const char *subPath, size_t subPathLen)
+{
+    ListJob *job;
+    if (!Prefetch.workers)
+    {
+        /* the snapshot's age makes the next FsFindFirst list it again */
+        return;
+    }
+    job = createListJob(loc, subPathLen);
+    memcpy(job->subPath, subPath, subPathLen);
+    job->subPath[subPathLen] = '\0';
+    job->refresh = TRUE;
+    submitListJob(job);
+}
+
+/*--------------------------------------------------------------------------*/
+static ListJob *createListJob(const Location *loc, size_t subPathLen)
+{
+    ListJob *job = malloc(sizeof(*job) + sizeof(loc) + subPathLen);
+    job->job.run = &runListJob;
+    job->job.discard = &discardListJob;
+    job->location = loc;
+    job->refresh = FALSE;
+    job->subtree = FALSE;
+    job->running = FALSE;
+    memcpy(job->key, &loc, sizeof(loc));
+    job->subPath = job->key + sizeof(loc);
+    job->subPath[0] = '\0';
+    job->subPathLen = subPathLen;
+    job->keyLen = sizeof(loc) + subPathLen;
+    return job;
+}
+
+/*--------------------------------------------------------------------------*/
+static int submitListJob(ListJob *job)
+{
+    ListJob *queued;
+
+    apr_thread_mutex_lock(Prefetch.mutex);
+    if (Prefetch.subtree && !job->refresh && apr_hash_get(Prefetch.walked, job->key, job->keyLen))
+    {
+        /* TC's walk reaches each directory from its parent, list or descend it once per copy */
+        apr_thread_mutex_unlock(Prefetch.mutex);
+        free(job);
+        return FALSE;
+    }
+    queued = apr_hash_get(Prefetch.pending, job->key, job->keyLen);
+    if (queued && (!job->refresh || !queued->running))
+    {
+        queued->refresh |= job->refresh;
+        queued->subtree |= job->subtree;
+        apr_thread_mutex_unlock(Prefetch.mutex);
+        free(job);
+        return FALSE;
+    }
+    /* a refresh of a directory being listed right now supersedes that job */
+    apr_hash_set(Prefetch.pending, job->key, job->keyLen, job);
+    if (Prefetch.subtree)
+    {
+        apr_hash_set(Prefetch.walked, apr_pmemdup(Prefetch.walkedPool, job->key, job->keyLen), job->keyLen, "");
+    }
+    apr_thread_mutex_unlock(Prefetch.mutex);
+    workerpool_submit(Prefetch.workers, &job->job);
+    return TRUE;
+}
+
+/*--------------------------------------------------------------------------*/
+static int finishListJob(ListJob *job)
+{
+    int subtree;
+    apr_thread_mutex_lock(Prefetch.mutex);
+    subtree = job->subtree;
+    if (apr_hash_get(Prefetch.pending, job->key, job->keyLen) == job)
+    {
+        apr_hash_set(Prefetch.pending, job->key, job->keyLen, NULL);
+    }
+    apr_thread_mutex_unlock(Prefetch.mutex);
+    return subtree;
+}
+
+/*--------------------------------------------------------------------------*/
+static void configureWorkers(void)
+{
+    if (Prefetch.workers && (workerpool_size(Prefetch.workers) != Config.prefetchThreads || Config.prefetchChildren <= 0))
+    {
+        workerpool_destroy(Prefetch.workers);
+        Prefetch.workers = NULL;
+    }
+    if (!Prefetch.workers && Config.prefetchThreads > 0 && Config.prefetchChildren > 0)
+    {
+        Prefetch.workers = workerpool_create(Config.prefetchThreads, &initWorkerThread, Subversion.pool);
+    }
+
+    if (Streaming.workers && workerpool_size(Streaming.workers) != Config.streamThreads)
+    {
+        workerpool_destroy(Streaming.workers);
+        Streaming.workers = NULL;
+    }
+    if (!Streaming.workers && Config.streamThreads > 0)
+    {
+        Streaming.workers = workerpool_create(Config.streamThreads, &initWorkerThread, Subversion.pool);
+    }
+
+    if (Download.workers && workerpool_size(Download.workers) != Config.downloadThreads)
+    {
+        workerpool_destroy(Download.workers);
+        Download.workers = NULL;
+    }
+    if (!Download.workers && Config.downloadThreads > 0)
+    {
+        Download.workers = workerpool_create(Config.downloadThreads, &initWorkerThread, Subversion.pool);
+    }
+
+    /* also builds the first index of a location for "find" */
+    if (!Indexer.workers)
+    {
+        Indexer.workers = workerpool_create(1, &initWorkerThread, Subversion.pool);
+    }
+
+    if (Columns.workers && workerpool_size(Columns.workers) != Config.columnThreads)
+    {
+        workerpool_destroy(Columns.workers);
+        Columns.workers = NULL;
+    }
+    if (!Columns.workers && Config.columnThreads > 0)
+    {
+        Columns.workers = workerpool_create(Config.columnThreads, &initWorkerThread, Subversion.pool);
+    }
+
+    if (Config.pollInterval > 0)
+    {
+        startPoller();
+    }
+    else
+    {
+        stopPoller();
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void *initWorkerThread(apr_pool_t *pool)
+{
+    svn_client_ctx_t *ctx;
+    svn_error_t *err = createClientContext(&ctx, FALSE, pool);
+    if (err)
+    {
+        svn_error_clear(err);
+        return NULL;
+    }
+    /* the sessions use the context's auth baton, which goes away with the pool */
+    apr_pool_cleanup_register(pool, ctx, &closeContextSessions, &apr_pool_cleanup_null);
+    return ctx;
+}
+
+/*--------------------------------------------------------------------------*/
+static apr_status_t closeContextSessions(void *data)
+{
+    sessionpool_clear(data);
+    return APR_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------*/
+static void runListJob(WorkerJob *job, void *threadData)
+{
+    ListJob *listJob = (ListJob*) job;
+    svn_client_ctx_t *ctx = threadData;
+    Snapshot *snapshot = NULL;
+    int refresh;
+
+    apr_thread_mutex_lock(Prefetch.mutex);
+    listJob->running = TRUE;
+    refresh = listJob->refresh;
+    apr_thread_mutex_unlock(Prefetch.mutex);
+
+    if (ctx && !workerpool_cancelled(Prefetch.workers, job) && (refresh || !(snapshot = snapcache_lookup(listJob->location, listJob->subPath, listJob->subPathLen))))
+    {
+        svn_error_t *err = SVN_NO_ERROR;
+        svn_boolean_t unchanged = FALSE;
+        apr_pool_t *pool = svn_pool_create(NULL);
+
+        ctx->cancel_func = &cancelPrefetch;
+        ctx->cancel_baton = job;
+        if (refresh && (snapshot = snapcache_lookup(listJob->location, listJob->subPath, listJob->subPathLen)))
+        {
+            if (snapshot->createdRev >= 0)
+            {
+                svn_error_clear(checkSnapshot(&unchanged, snapshot, ctx, pool));
+            }
+            snapshot_release(snapshot);
+        }
+        snapshot = NULL;
+        if (!unchanged)
+        {
+            err = querySnapshot(&snapshot, listJob->location, listJob->subPath, listJob->subPathLen, ctx, pool);
+        }
+        ctx->cancel_func = NULL;
+        ctx->cancel_baton = NULL;
+        if (err)
+        {
+            /* prefetching is opportunistic, the foreground listing will report any errors */
+            svn_error_clear(err);
+        }
+        svn_pool_destroy(pool);
+    }
+    if (finishListJob(listJob) && snapshot && Prefetch.subtree)
+    {
+        /* keep ahead of TC's walk through the copied directories, a cached
+           directory is descended here rather than on TC's thread */
+        schedulePrefetch(snapshot);
+    }
+    snapshot_release(snapshot);
+    free(job);
+}
+
+/*--------------------------------------------------------------------------*/
+static void discardListJob(WorkerJob *job)
+{
+    finishListJob((ListJob*) job);
+    free(job);
+}
+
+/*--------------------------------------------------------------------------*/
+static void runStreamJob(WorkerJob *job, void *threadData)
+{
+    StreamJob *streamJob = (StreamJob*) job;
+    svn_client_ctx_t *ctx = threadData;
+    Snapshot *snapshot = streamJob->snapshot;
+
+    if (ctx)
+    {
+        apr_pool_t *pool = svn_pool_create(NULL);
+        svn_error_t *err;
+
+        ctx->cancel_func = &cancelStream;
+        ctx->cancel_baton = snapshot;
+        err = listSnapshot(snapshot, ctx, pool);
+        ctx->cancel_func = NULL;
+        ctx->cancel_baton = NULL;
+        if (err)
+        {
+            svn_error_clear(err);
+        }
+        else
+        {
+            schedulePrefetch(snapshot);
+        }
+        svn_pool_destroy(pool);
+    }
+    else
+    {
+        snapshot_fail(snapshot, "Unable to create client context");
+    }
+    snapshot_release(snapshot);
+    free(job);
+}
+
+/*--------------------------------------------------------------------------*/
+static void discardStreamJob(WorkerJob *job)
+{
+    StreamJob *streamJob = (StreamJob*) job;
+    snapshot_fail(streamJob->snapshot, "Listing cancelled");
+    snapshot_release(streamJob->snapshot);
+    free(job);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *cancelStream(void *baton)
+{
+    Snapshot *snapshot = baton;
+    /* if only the listing job itself still holds a reference, the find
+       handle has been closed and nobody waits for the rest */
+    if (apr_atomic_read32(&snapshot->refCount) == 1)
+    {
+        return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+    }
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *cancelPrefetch(void *baton)
+{
+    if (baton && workerpool_cancelled(Prefetch.workers, (const WorkerJob*) baton))
+    {
+        return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+    }
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static int fetchStoredFile(const char *remoteName, const char *url, const char *localName)
+{
+    const char *name = strrchr(remoteName, '\\');
+    Snapshot *snapshot;
+    const SVNObject *obj;
+    svn_error_t *err;
+    int copied = FALSE;
+
+    if (Config.fileStoreSize <= 0 || !name)
+    {
+        return FALSE;
+    }
+    /* revalidates the parent's listing, which tells the current revision of the file */
+    if ((err = getSnapshot(&snapshot, remoteName, name - remoteName, SF_REVALIDATE)))
+    {
+        /* the download will report the error */
+        svn_error_clear(err);
+        return FALSE;
+    }
+    /* a listing loaded from the disk cache may be outdated until it has been refreshed */
+    if (snapshot_fresh(snapshot, max(Config.cacheTTL, 1)) && (obj = snapshot_find(snapshot, name + 1))
+        && obj->kind == svn_node_file && obj->createdRev >= 0)
+    {
+        if ((copied = filestore_fetch(url, obj->createdRev, obj->size, snapshot_checksum(snapshot, obj), localName)))
+        {
+            stats_add(STAT_STORE_HITS, 1);
+        }
+        trace_mark("cache", copied ? "file store hit" : "file store miss", remoteName);
+    }
+    snapshot_release(snapshot);
+    return copied;
+}
+
+/*--------------------------------------------------------------------------*/
+static int openLocalFile(apr_file_t **file, char *localName, apr_pool_t *pool)
+{
+    apr_status_t apr_status;
+
+    slashify(localName);
+    apr_status = apr_file_open(file, localName, APR_WRITE | APR_CREATE | APR_TRUNCATE | APR_BINARY, APR_OS_DEFAULT, pool);
+    replaceAll(localName, '/', '\\');
+    if (apr_status)
+    {
+        char buf[1024];
+        apr_strerror(apr_status, buf, sizeof(buf));
+        MessageBox(NULL, buf, "apr_file_open", MB_OK | MB_ICONERROR);
+        return FS_FILE_WRITEERROR;
+    }
+    return FS_FILE_OK;
+}
+
+/*--------------------------------------------------------------------------*/
+static int writeLocalFile(char *localName, const svn_stringbuf_t *contents)
+{
+    apr_pool_t *subPool = svn_pool_create(Subversion.pool);
+    apr_file_t *file;
+    int result;
+
+    if ((result = openLocalFile(&file, localName, subPool)) == FS_FILE_OK)
+    {
+        if (apr_file_write_full(file, contents->data, contents->len, NULL) != APR_SUCCESS)
+        {
+            result = FS_FILE_WRITEERROR;
+        }
+        apr_file_close(file);
+    }
+    return svn_pool_destroy(subPool), result;
+}
+
+/*--------------------------------------------------------------------------*/
+static int writeStatistics(char *localName)
+{
+    apr_pool_t *subPool = svn_pool_create(Subversion.pool);
+    svn_stringbuf_t *report = svn_stringbuf_create("", subPool);
+    size_t i;
+    int result;
+
+    stats_report(report);
+    for (i = 0; i < Config.locations.count; ++i)
+    {
+        const Location *loc = Config.locations.sorted[i];
+        stats_report_location(report, loc->title.data, loc->key.data, loc->stats);
+    }
+    result = writeLocalFile(localName, report);
+    return svn_pool_destroy(subPool), result;
+}
+
+/*--------------------------------------------------------------------------*/
+static int writeTrace(char *localName)
+{
+    apr_pool_t *subPool = svn_pool_create(Subversion.pool);
+    svn_stringbuf_t *json = svn_stringbuf_create("", subPool);
+    int result;
+
+    trace_dump(json);
+    result = writeLocalFile(localName, json);
+    if (Config.traceLog)
+    {
+        trace_summarize(&logTraceLine, NULL);
+    }
+    return svn_pool_destroy(subPool), result;
+}
+
+/*--------------------------------------------------------------------------*/
+static void logTraceLine(const char *line, void *baton)
+{
+    Plugin.log(Plugin.id, MSGTYPE_DETAILS, line);
+}
+
+/*--------------------------------------------------------------------------*/
+static DownloadJob *claimDownload(const char *remoteName)
+{
+    const size_t remoteNameLen = strlen(remoteName);
+    DownloadJob *job;
+
+    apr_thread_mutex_lock(Download.mutex);
+    job = apr_hash_get(Download.jobs, remoteName, remoteNameLen);
+    if (job)
+    {
+        apr_hash_set(Download.jobs, remoteName, remoteNameLen, NULL);
+    }
+    else if (!apr_hash_get(Download.queued, remoteName, remoteNameLen))
+    {
+        /* the caller downloads it, the look-ahead must not */
+        apr_hash_set(Download.queued, apr_pstrmemdup(Download.queuedPool, remoteName, remoteNameLen), remoteNameLen, "");
+    }
+    apr_thread_mutex_unlock(Download.mutex);
+    return job;
+}
+
+/*--------------------------------------------------------------------------*/
+static void queueLookAhead(const char *remoteName, const char *localName)
+{
+    const char *name = strrchr(remoteName, '\\');
+    const char *localDirEnd = NULL;
+    const char *p;
+    const Location *loc;
+    Snapshot *snapshot;
+    const SVNObject *obj;
+    char subPath[MAX_PATH];
+    size_t subPathLen;
+
+    for (p = localName; *p; ++p)
+    {
+        if (*p == '\\' || *p == '/')
+        {
+            localDirEnd = p + 1;
+        }
+    }
+    if (!name || !localDirEnd)
+    {
+        return;
+    }
+    loc = location_resolve(&Config.locations, remoteName, name - remoteName, subPath, sizeof(subPath), &subPathLen);
+    if (!loc || !(snapshot = snapcache_lookup(loc, subPath, subPathLen)))
+    {
+        return;
+    }
+    if (snapshot_finished(snapshot) && (obj = snapshot_find(snapshot, name + 1)))
+    {
+        const size_t dirLen = name + 1 - remoteName;
+        const int ahead = workerpool_size(Download.workers);
+        size_t i = obj - snapshot->entries;
+        int files = 0;
+
+        while (++i < snapshot->count && files < ahead)
+        {
+            const SVNObject *next = snapshot->entries + i;
+            if (next->kind == svn_node_file)
+            {
+                const char *nextName = snapshot_name(snapshot, next);
+                const size_t nextNameLen = strlen(nextName);
+                char nextRemoteName[MAX_PATH];
+                strbuf_t s = { nextRemoteName, sizeof(nextRemoteName) };
+
+                strbuf_cat(&s, remoteName, dirLen);
+                strbuf_cat(&s, nextName, nextNameLen);
+                if (dirLen + nextNameLen < sizeof(nextRemoteName))
+                {
+                    queueDownload(loc, nextRemoteName, dirLen + nextNameLen, localName, localDirEnd - localName, next->size);
+                }
+                ++files;
+            }
+        }
+    }
+    snapshot_release(snapshot);
+}
+
+/*--------------------------------------------------------------------------*/
+static void queueDownload(const Location *loc, const char *remoteName, size_t remoteNameLen, const char *localDir, size_t localDirLen, apr_int64_t size)
+{
+    char url[LOCATION_URL_SIZE];
+    const size_t urlLen = location_url(&Config.locations, remoteName, remoteNameLen, url, sizeof(url), NULL);
+    apr_pool_t *pool;
+    DownloadJob *job;
+
+    apr_thread_mutex_lock(Download.mutex);
+    if (apr_hash_get(Download.queued, remoteName, remoteNameLen)
+        || apr_hash_count(Download.jobs) >= (unsigned int) (2 * workerpool_size(Download.workers)))
+    {
+        /* TC copies in a different order than the listing, or does not keep up */
+        apr_thread_mutex_unlock(Download.mutex);
+        return;
+    }
+    apr_hash_set(Download.queued, apr_pstrmemdup(Download.queuedPool, remoteName, remoteNameLen), remoteNameLen, "");
+    apr_thread_mutex_unlock(Download.mutex);
+
+    if (!urlLen || urlLen >= sizeof(url))
+    {
+        return;
+    }
+
+    pool = svn_pool_create(NULL);
+    job = apr_pcalloc(pool, sizeof(*job));
+    /* next to the expected target, so that awaitDownload can rename it */
+    job->localName = apr_pstrcat(pool, apr_pstrmemdup(pool, localDir, localDirLen), "~svn_wfxXXXXXX", NULL);
+    slashify(job->localName);
+    if (apr_file_mktemp(&job->transfer.file, job->localName, APR_CREATE | APR_READ | APR_WRITE | APR_EXCL | APR_BINARY, pool))
+    {
+        /* FsGetFile downloads the file itself and reports the error */
+        svn_pool_destroy(pool);
+        return;
+    }
+    replaceAll(job->localName, '/', '\\');
+
+    job->job.run = &runDownloadJob;
+    job->job.discard = &discardDownloadJob;
+    job->location = loc;
+    job->pool = pool;
+    job->url = apr_pstrmemdup(pool, url, urlLen);
+    job->remoteName = apr_pstrmemdup(pool, remoteName, remoteNameLen);
+    /* progress is reported by awaitDownload */
+    job->transfer.remoteName = NULL;
+    job->transfer.localName = job->localName;
+    job->transfer.revision = loc->revision;
+    job->transfer.size = size;
+    job->transfer.done = 0;
+
+    apr_thread_mutex_lock(Download.mutex);
+    ++Download.pending;
+    apr_hash_set(Download.jobs, job->remoteName, remoteNameLen, job);
+    apr_thread_mutex_unlock(Download.mutex);
+
+    workerpool_submit(Download.workers, &job->job);
+}
+
+/*--------------------------------------------------------------------------*/
+static int awaitDownload(DownloadJob *job, const char *sourceName, char *localName)
+{
+    int aborted = FALSE;
+    int result;
+
+    apr_thread_mutex_lock(Download.mutex);
+    while (!job->finished)
+    {
+        /* a torn read of the byte count only affects the progress bar */
+        const apr_int64_t size = job->transfer.size;
+        const apr_int64_t done = job->transfer.done;
+        const int percent = size > 0 && done < size ? (int) (done * 100 / size) : 0;
+
+        apr_thread_mutex_unlock(Download.mutex);
+        if (!aborted && Plugin.progress(Plugin.id, sourceName, localName, percent))
+        {
+            /* the copy ends, so the look-ahead is of no use either */
+            aborted = TRUE;
+            workerpool_cancel(Download.workers);
+        }
+        apr_thread_mutex_lock(Download.mutex);
+        if (!job->finished)
+        {
+            apr_thread_cond_timedwait(Download.cond, Download.mutex, apr_time_from_msec(100));
+        }
+    }
+    apr_thread_mutex_unlock(Download.mutex);
+
+    if (job->err)
+    {
+        result = downloadResult(job->err);
+        if (result != FS_FILE_USERABORT)
+        {
+            displaySvnErrorMessage(job->err);
+        }
+    }
+    else
+    {
+        apr_status_t apr_status;
+
+        slashify(job->localName);
+        slashify(localName);
+        if ((apr_status = apr_file_rename(job->localName, localName, job->pool)))
+        {
+            /* TC may copy a file to a different name or drive than its siblings */
+            apr_status = apr_file_copy(job->localName, localName, APR_FILE_SOURCE_PERMS, job->pool);
+        }
+        replaceAll(localName, '/', '\\');
+        if (apr_status)
+        {
+            char buf[1024];
+            apr_strerror(apr_status, buf, sizeof(buf));
+            MessageBox(NULL, buf, "apr_file_rename", MB_OK | MB_ICONERROR);
+        }
+        result = apr_status ? FS_FILE_WRITEERROR : FS_FILE_OK;
+    }
+    freeDownloadJob(job);
+
+    if (result == FS_FILE_OK)
+    {
+        Plugin.progress(Plugin.id, sourceName, localName, 100);
+    }
+    return result;
+}
+
+/*--------------------------------------------------------------------------*/
+static void freeDownloadJob(DownloadJob *job)
+{
+    /* gone already if it has been moved into place */
+    apr_file_remove(job->localName, job->pool);
+    svn_error_clear(job->err);
+    svn_pool_destroy(job->pool);
+}
+
+/*--------------------------------------------------------------------------*/
+static void runDownloadJob(WorkerJob *job, void *threadData)
+{
+    DownloadJob *downloadJob = (DownloadJob*) job;
+    svn_client_ctx_t *ctx = threadData;
+    svn_error_t *err;
+
+    if (ctx)
+    {
+        const apr_time_t start = apr_time_now();
+        ctx->cancel_func = &cancelDownload;
+        ctx->cancel_baton = job;
+        err = sessionpool_run(downloadJob->location, downloadJob->url, ctx, &fetchFile, &downloadJob->transfer, downloadJob->pool);
+        ctx->cancel_func = NULL;
+        ctx->cancel_baton = NULL;
+        stats_record_download(downloadJob->location->stats, start, downloadJob->transfer.done, err != NULL);
+    }
+    else
+    {
+        err = svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL, "Unable to create client context");
+    }
+    apr_file_close(downloadJob->transfer.file);
+    if (!err && SVN_IS_VALID_REVNUM(downloadJob->transfer.createdRev))
+    {
+        filestore_store(downloadJob->url, downloadJob->transfer.createdRev, downloadJob->localName);
+    }
+    finishDownload(downloadJob, err);
+}
+
+/*--------------------------------------------------------------------------*/
+static void discardDownloadJob(WorkerJob *job)
+{
+    DownloadJob *downloadJob = (DownloadJob*) job;
+    apr_file_close(downloadJob->transfer.file);
+    finishDownload(downloadJob, svn_error_create(SVN_ERR_CANCELLED, NULL, NULL));
+}
+
+/*--------------------------------------------------------------------------*/
+static void finishDownload(DownloadJob *job, svn_error_t *err)
+{
+    apr_thread_mutex_lock(Download.mutex);
+    job->err = err;
+    job->finished = TRUE;
+    --Download.pending;
+    apr_thread_cond_broadcast(Download.cond);
+    apr_thread_mutex_unlock(Download.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *cancelDownload(void *baton)
+{
+    if (workerpool_cancelled(Download.workers, (const WorkerJob*) baton))
+    {
+        return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+    }
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static void finishBatch(void)
+{
+    apr_hash_index_t *hi;
+
+    /* TC skipped these files or the copy was aborted */
+    workerpool_cancel(Download.workers);
+    apr_thread_mutex_lock(Download.mutex);
+    while (Download.pending)
+    {
+        apr_thread_cond_wait(Download.cond, Download.mutex);
+    }
+    for (hi = apr_hash_first(NULL, Download.jobs); hi; hi = apr_hash_next(hi))
+    {
+        void *job;
+        apr_hash_this(hi, NULL, NULL, &job);
+        freeDownloadJob(job);
+    }
+    apr_hash_clear(Download.jobs);
+    apr_thread_mutex_unlock(Download.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+static int downloadResult(const svn_error_t *err)
+{
+    if (!err)
+    {
+        return FS_FILE_OK;
+    }
+    switch (err->apr_err)
+    {
+    case SVN_ERR_CANCELLED:
+        return FS_FILE_USERABORT;
+    case SVN_ERR_FS_NOT_FOUND:
+    case SVN_ERR_RA_DAV_PATH_NOT_FOUND:
+        return FS_FILE_NOTFOUND;
+    }
+    /* Subversion wraps all network failures, a plain APR error comes from writing the local file */
+    return err->apr_err < APR_OS_START_USERERR ? FS_FILE_WRITEERROR : FS_FILE_READERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static void scheduleColumns(int details, const Location *loc, const char *subPath, size_t subPathLen, const char *dirPath, size_t dirPathLen)
+{
+    apr_thread_mutex_lock(Columns.mutex);
+    if (!apr_hash_get(Columns.pending[details], dirPath, dirPathLen))
+    {
+        ColumnJob *job = malloc(sizeof(*job) + subPathLen + 1 + dirPathLen);
+        memcpy(job->subPath, subPath, subPathLen);
+        job->subPath[subPathLen] = '\0';
+        job->dirPath = job->subPath + subPathLen + 1;
+        memcpy(job->dirPath, dirPath, dirPathLen);
+        job->dirPath[dirPathLen] = '\0';
+        job->job.run = &runColumnJob;
+        job->job.discard = &discardColumnJob;
+        job->location = loc;
+        job->details = details;
+        job->subPathLen = subPathLen;
+        job->dirPathLen = dirPathLen;
+        apr_hash_set(Columns.pending[details], job->dirPath, dirPathLen, job);
+        workerpool_submit(Columns.workers, &job->job);
+    }
+    apr_thread_mutex_unlock(Columns.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+static void waitForColumns(int details, const char *dirPath, size_t dirPathLen)
+{
+    apr_thread_mutex_lock(Columns.mutex);
+    while (apr_hash_get(Columns.pending[details], dirPath, dirPathLen))
+    {
+        apr_thread_cond_wait(Columns.cond, Columns.mutex);
+    }
+    apr_thread_mutex_unlock(Columns.mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+static void runColumnJob(WorkerJob *job, void *threadData)
+{
+    ColumnJob *columnJob = (ColumnJob*) job;
+    svn_client_ctx_t *ctx = threadData;
+
+    if (ctx && !workerpool_cancelled(Columns.workers, job))
+    {
+        apr_pool_t *pool = svn_pool_create(NULL);
+        svn_error_t *err = SVN_NO_ERROR;
+        Snapshot *snapshot = snapcache_lookup(columnJob->location, columnJob->subPath, columnJob->subPathLen);
+
+        ctx->cancel_func = &cancelColumns;
+        ctx->cancel_baton = job;
+        if (!snapshot && !(snapshot = loadStoredSnapshot(columnJob->location, columnJob->subPath, columnJob->subPathLen)))
+        {
+            err = querySnapshot(&snapshot, columnJob->location, columnJob->subPath, columnJob->subPathLen, ctx, pool);
+        }
+        if (!err)
+        {
+            err = fetchDetails(snapshot, columnJob->details, ctx, pool);
+        }
+        ctx->cancel_func = NULL;
+        ctx->cancel_baton = NULL;
+        if (err)
+        {
+            /* TC shows the column empty, the listing reports any errors */
+            trace_mark("columns", "failed", err->message);
+            svn_error_clear(err);
+        }
+        snapshot_release(snapshot);
+        svn_pool_destroy(pool);
+    }
+    finishColumnJob(columnJob);
+}
+
+/*--------------------------------------------------------------------------*/
+static void discardColumnJob(WorkerJob *job)
+{
+    finishColumnJob((ColumnJob*) job);
+}
+
+/*--------------------------------------------------------------------------*/
+static void finishColumnJob(ColumnJob *job)
+{
+    apr_thread_mutex_lock(Columns.mutex);
+    apr_hash_set(Columns.pending[job->details], job->dirPath, job->dirPathLen, NULL);
+    apr_thread_cond_broadcast(Columns.cond);
+    apr_thread_mutex_unlock(Columns.mutex);
+    free(job);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *cancelColumns(void *baton)
+{
+    if (baton && workerpool_cancelled(Columns.workers, (const WorkerJob*) baton))
+    {
+        return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+    }
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static void scheduleIndexUpdate(const Location *loc, int force)
+{
+    /* the schedule is the only part of a location that changes after loading */
+    volatile apr_uint32_t *scheduled = &((Location*) loc)->indexScheduled;
+    const apr_uint32_t now = (apr_uint32_t) apr_time_sec(apr_time_now());
+    const apr_uint32_t last = apr_atomic_read32(scheduled);
+    IndexJob *job;
+
+    if (!Indexer.workers || (!force && (Config.indexInterval <= 0 || (last && now - last < (apr_uint32_t) Config.indexInterval)))
+        || apr_atomic_cas32(scheduled, now, last) != last)
+    {
+        return;
+    }
+    job = malloc(sizeof(*job));
+    job->job.run = &runIndexJob;
+    job->job.discard = &discardIndexJob;
+    job->location = loc;
+    workerpool_submit(Indexer.workers, &job->job);
+}
+
+/*--------------------------------------------------------------------------*/
+static void runIndexJob(WorkerJob *job, void *threadData)
+{
+    const Location *loc = ((IndexJob*) job)->location;
+    svn_client_ctx_t *ctx = threadData;
+
+    if (ctx && !workerpool_cancelled(Indexer.workers, job))
+    {
+        apr_pool_t *pool = svn_pool_create(NULL);
+        char url[LOCATION_URL_SIZE];
+        NameIndexTarget target;
+        target.url = loc->key.data;
+        target.revision = loc->revision;
+        target.nowait = FALSE;
+        location_node_url(loc, "", 0, url, sizeof(url));
+        ctx->cancel_func = &cancelIndexUpdate;
+        ctx->cancel_baton = job;
+        /* a failed update is retried after the next interval */
+        svn_error_clear(sessionpool_run(loc, url, ctx, &nameindex_update, &target, pool));
+        ctx->cancel_func = NULL;
+        ctx->cancel_baton = NULL;
+        svn_pool_destroy(pool);
+    }
+    free(job);
+}
+
+/*--------------------------------------------------------------------------*/
+static void discardIndexJob(WorkerJob *job)
+{
+    free(job);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *cancelIndexUpdate(void *baton)
+{
+    if (workerpool_cancelled(Indexer.workers, (const WorkerJob*) baton))
+    {
+        return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+    }
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static void findFiles(HWND mainWin, char *remoteName, const char *pattern, apr_pool_t *pool)
+{
+    char subPath[MAX_PATH];
+    size_t subPathLen;
+    const Location *loc = location_resolve(&Config.locations, remoteName, strlen(remoteName), subPath, sizeof(subPath), &subPathLen);
+    char url[LOCATION_URL_SIZE];
+    char buf[4096];
+    const char *title;
+    FoundFiles found;
+    NameIndexTarget target;
+    Transfer progress;
+    svn_error_t *err;
+    int count;
+
+    if (!loc)
+    {
+        return;
+    }
+    title = apr_psprintf(pool, "Find \"%s\"", pattern);
+
+    if (nameindex_age(loc->key.data) < 0)
+    {
+        scheduleIndexUpdate(loc, TRUE);
+        MessageBox(mainWin, "The filename index of this location is being built in the background.\n"
+                            "Search again once it is ready.", title, MB_OK | MB_ICONINFORMATION);
+        return;
+    }
+
+    /* a current index costs a single request for the youngest revision, none if
+       pinned; while the log of changes is read, the progress dialog can abort */
+    memset(&progress, 0, sizeof(progress));
+    progress.remoteName = remoteName;
+    progress.localName = "";
+    target.url = loc->key.data;
+    target.revision = loc->revision;
+    /* while the indexer updates it, the current index is searched */
+    target.nowait = TRUE;
+    location_node_url(loc, "", 0, url, sizeof(url));
+    Subversion.transferThread = apr_os_thread_current();
+    Subversion.transfer = &progress;
+    err = sessionpool_run(loc, url, Subversion.ctx, &nameindex_update, &target, pool);
+    Subversion.transfer = NULL;
+    if (err)
+    {
+        if (err->apr_err == SVN_ERR_CANCELLED)
+        {
+            svn_error_clear(err);
+            return;
+        }
+        /* an index of an older revision is still worth searching */
+        displaySvnErrorMessage(err);
+        svn_error_clear(err);
+    }
+
+    strbuf_init(&found.text, buf, sizeof(buf));
+    found.shown = 0;
+    if ((count = nameindex_search(loc->key.data, subPath + (*subPath == '/'), pattern, &addFoundFile, &found)) < 0)
+    {
+        return;
+    }
+    if (!count)
+    {
+        strbuf_cat(&found.text, "No matches.", 11);
+    }
+    else if (count > found.shown)
+    {
+        const char *more = apr_psprintf(pool, "\n\n%d of %d matches shown.", found.shown, count);
+        strbuf_cat(&found.text, more, strlen(more));
+    }
+    MessageBox(mainWin, buf, title, MB_OK | MB_ICONINFORMATION);
+}
+
+/*--------------------------------------------------------------------------*/
+static int addFoundFile(const char *path, void *baton)
+{
+    FoundFiles *found = baton;
+    if (found->shown < 40)
+    {
+        if (found->shown++)
+        {
+            strbuf_cat(&found->text, "\n", 1);
+        }
+        for (; *path; ++path)
+        {
+            strbuf_cat(&found->text, *path == '/' ? "\\" : path, 1);
+        }
+    }
+    /* keep going, all matches are counted */
     return 0;
 }
 
+/*--------------------------------------------------------------------------*/
+static void compareTrees(HWND mainWin, char *remoteName, const char *base, apr_pool_t *pool)
+{
+    char subPath[MAX_PATH];
+    size_t subPathLen;
+    const Location *loc = location_resolve(&Config.locations, remoteName, strlen(remoteName), subPath, sizeof(subPath), &subPathLen);
+    const Location *baseLoc = NULL;
+    char url[LOCATION_URL_SIZE];
+    char baseUrl[LOCATION_URL_SIZE];
+    svn_opt_revision_t rev, baseRev;
+    char buf[4096];
+    DiffReport report;
+    apr_time_t start;
+    svn_error_t *err;
+
+    if (!loc || location_node_url(loc, subPath, subPathLen, url, sizeof(url)) >= sizeof(url))
+    {
+        return;
+    }
+    if (strstr(base, "://"))
+    {
+        /* typed URLs may contain spaces or non-ASCII characters, while existing escapes are kept */
+        const char *escaped = svn_path_uri_autoescape(svn_path_uri_from_iri(base, pool), pool);
+        apr_cpystrn(baseUrl, svn_path_canonicalize(escaped, pool), sizeof(baseUrl));
+    }
+    else
+    {
+        size_t len;
+        while (*base == '\\' || *base == '/') ++base;
+        len = location_url(&Config.locations, base, strlen(base), baseUrl, sizeof(baseUrl), &baseLoc);
+        if (!len || len >= sizeof(baseUrl))
+        {
+            MessageBox(mainWin, apr_psprintf(pool, "\"%s\" is neither a URL nor a directory of a location.", base), "Subversion Plugin", MB_OK | MB_ICONERROR);
+            return;
+        }
+    }
+    rev.kind = SVN_IS_VALID_REVNUM(loc->revision) ? svn_opt_revision_number : svn_opt_revision_head;
+    rev.value.number = loc->revision;
+    baseRev.kind = baseLoc && SVN_IS_VALID_REVNUM(baseLoc->revision) ? svn_opt_revision_number : svn_opt_revision_head;
+    baseRev.value.number = baseLoc ? baseLoc->revision : SVN_INVALID_REVNUM;
+
+    /* one streamed request instead of listing and comparing both trees directory by directory */
+    diffsum_begin(loc, subPath, subPathLen);
+    strbuf_init(&report.found.text, buf, sizeof(buf));
+    report.found.shown = 0;
+    report.count = 0;
+    start = trace_begin();
+    err = svn_client_diff_summarize2(baseUrl, &baseRev, url, &rev, svn_depth_infinity, TRUE, NULL,
+                                     &addDifference, &report, Subversion.ctx, pool);
+    trace_end(start, "ra", "svn_client_diff_summarize2", url);
+    if (err)
+    {
+        diffsum_clear(NULL);
+        displaySvnErrorMessage(err);
+        svn_error_clear(err);
+        return;
+    }
+
+    if (!report.count)
+    {
+        strbuf_cat(&report.found.text, "No differences.", 15);
+    }
+    else if (report.count > report.found.shown)
+    {
+        const char *more = apr_psprintf(pool, "\n\n%d of %d differences shown.", report.found.shown, report.count);
+        strbuf_cat(&report.found.text, more, strlen(more));
+    }
+    MessageBox(mainWin, buf, apr_psprintf(pool, "Compare with \"%s\"", base), MB_OK | MB_ICONINFORMATION);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *addDifference(const svn_client_diff_summarize_t *diff, void *baton, apr_pool_t *pool)
+{
+    DiffReport *report = baton;
+    const char *code;
+    DiffStatus status;
+
+    switch (diff->summarize_kind)
+    {
+        case svn_client_diff_summarize_kind_added:
+            status = DIFF_ADDED;
+            code = "A  ";
+            break;
+        case svn_client_diff_summarize_kind_deleted:
+            status = DIFF_DELETED;
+            code = "D  ";
+            break;
+        case svn_client_diff_summarize_kind_modified:
+            status = DIFF_MODIFIED;
+            code = diff->prop_changed ? "MM " : "M  ";
+            break;
+        default:
+            if (!diff->prop_changed)
+            {
+                return SVN_NO_ERROR;
+            }
+            status = DIFF_PROPS;
+            code = " M ";
+            break;
+    }
+    diffsum_add(diff->path, status);
+    ++report->count;
+    addFoundFile(apr_pstrcat(pool, code, *diff->path ? diff->path : ".", NULL), &report->found);
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static void startPoller(void)
+{
+    if (Poller.thread)
+    {
+        return;
+    }
+    apr_pool_create(&Poller.pool, NULL);
+    apr_thread_mutex_create(&Poller.mutex, APR_THREAD_MUTEX_DEFAULT, Poller.pool);
+    apr_thread_cond_create(&Poller.cond, Poller.pool);
+    Poller.stop = FALSE;
+    if (apr_thread_create(&Poller.thread, NULL, &pollThread, NULL, Poller.pool) != APR_SUCCESS)
+    {
+        Poller.thread = NULL;
+        apr_pool_destroy(Poller.pool);
+        Poller.pool = NULL;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void stopPoller(void)
+{
+    apr_status_t status;
+    if (!Poller.thread)
+    {
+        return;
+    }
+    apr_thread_mutex_lock(Poller.mutex);
+    Poller.stop = TRUE;
+    apr_thread_cond_signal(Poller.cond);
+    apr_thread_mutex_unlock(Poller.mutex);
+    apr_thread_join(&status, Poller.thread);
+    Poller.thread = NULL;
+    apr_pool_destroy(Poller.pool);
+    Poller.pool = NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+static void * APR_THREAD_FUNC pollThread(apr_thread_t *thread, void *data)
+{
+    apr_pool_t *pool = svn_pool_create(NULL);
+    svn_client_ctx_t *ctx = initWorkerThread(pool);
+
+    apr_thread_mutex_lock(Poller.mutex);
+    while (ctx && !Poller.stop)
+    {
+        apr_thread_cond_timedwait(Poller.cond, Poller.mutex, apr_time_from_sec(Config.pollInterval));
+        if (!Poller.stop)
+        {
+            apr_thread_mutex_unlock(Poller.mutex);
+            ctx->cancel_func = &cancelPoll;
+            pollSnapshots(ctx, pool);
+            apr_thread_mutex_lock(Poller.mutex);
+        }
+    }
+    apr_thread_mutex_unlock(Poller.mutex);
+
+    svn_pool_destroy(pool);
+    apr_thread_exit(thread, APR_SUCCESS);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+static void pollSnapshots(svn_client_ctx_t *ctx, apr_pool_t *pool)
+{
+    size_t count, i;
+    Snapshot **snapshots = snapcache_acquire_all(&count);
+    const Location *loc = NULL;
+    svn_revnum_t youngest = SVN_INVALID_REVNUM;
+    apr_pool_t *iterPool = svn_pool_create(pool);
+
+    /* one youngest revision check per location confirms all of its
+       snapshots if nothing was committed since the last poll */
+    qsort(snapshots, count, sizeof(*snapshots), &compareSnapshotLocations);
+    for (i = 0; i < count; ++i)
+    {
+        Snapshot *snapshot = snapshots[i];
+        svn_pool_clear(iterPool);
+        if (!Poller.stop && !snapshot_fresh(snapshot, Config.cacheTTL))
+        {
+            svn_boolean_t unchanged = FALSE;
+            svn_error_t *err;
+            if (snapshot->location != loc)
+            {
+                char url[LOCATION_URL_SIZE];
+                loc = snapshot->location;
+                location_node_url(loc, "", 0, url, sizeof(url));
+                err = sessionpool_run(loc, url, ctx, &getYoungest, &youngest, iterPool);
+                if (err)
+                {
+                    svn_error_clear(err);
+                    youngest = SVN_INVALID_REVNUM;
+                }
+            }
+
+            if (SVN_IS_VALID_REVNUM(youngest) && (svn_revnum_t) snapshot->revision == youngest)
+            {
+                snapshot_confirm(snapshot, youngest);
+            }
+            else
+            {
+                if (snapshot->createdRev >= 0)
+                {
+                    svn_error_clear(checkSnapshot(&unchanged, snapshot, ctx, iterPool));
+                }
+                if (!unchanged && !Poller.stop)
+                {
+                    /* replaces the outdated snapshot in the cache */
+                    Snapshot *fresh;
+                    err = querySnapshot(&fresh, snapshot->location, snapshot->subPath.data, snapshot->subPath.len, ctx, iterPool);
+                    if (err)
+                    {
+                        svn_error_clear(err);
+                    }
+                    else
+                    {
+                        snapshot_release(fresh);
+                    }
+                }
+            }
+        }
+        snapshot_release(snapshot);
+    }
+    svn_pool_destroy(iterPool);
+    free(snapshots);
+}
+
+/*--------------------------------------------------------------------------*/
+static svn_error_t *cancelPoll(void *baton)
+{
+    if (Poller.stop)
+    {
+        return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+    }
+    return SVN_NO_ERROR;
+}
+
+/*--------------------------------------------------------------------------*/
+static int compareRevisions(const void *a, const void *b)
+{
+    const svn_revnum_t x = *(const svn_revnum_t*) a;
+    const svn_revnum_t y = *(const svn_revnum_t*) b;
+    return x < y ? -1 : x > y;
+}
+
+/*--------------------------------------------------------------------------*/
+static int compareSnapshotLocations(const void *a, const void *b)
+{
+    const Location *x = (*(const Snapshot* const*) a)->location;
+    const Location *y = (*(const Snapshot* const*) b)->location;
+    return x < y ? -1 : x > y;
+}
+
+/*--------------------------------------------------------------------------*/
+static void loadConfig(void)
+{
+    FILE *f;
+    const Option *option;
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+    for (option = options; option->name.data; ++option)
+    {
+        *option->value = option->defaultValue;
+    }
+
+    if (GetFileAttributesEx(Config.configFilePath.data, GetFileExInfoStandard, &attributes))
+    {
+        Config.loadedTime = attributes.ftLastWriteTime;
+    }
+    if ((f = fopen(Config.configFilePath.data, "r")))
+    {
+        char buf[1024];
+        BOOL inOptions = FALSE;
+        Locations fresh = { 0 };
+
+        while (fgets(buf, sizeof(buf), f))
+        {
+            const char *p = buf, *left;
+
+            while (isspace(*p)) ++p;
+            if (*p == '#')
+            {
+                continue;
+            }
+            if (*p == '[')
+            {
+                /* section header, everything below [options] is an option */
+                inOptions = !strnicmp(p, OptionsSection.data, OptionsSection.len);
+                continue;
+            }
+            left = p;
+            while (*p && *p != '\\' && *p != '=') ++p;
+            if (*p == '\\')
+            {
+                /* Backslashes are disallowed */
+                continue;
+            }
+            if (*p == '=' && inOptions)
+            {
+                const char *equals = p;
+                while ((p > left) && isspace(p[-1])) --p;
+                setOption(left, p - left, equals + 1);
+            }
+            else if (*p == '=')
+            {
+                const char *equals = p, *title = left;
+                size_t titleLen;
+
+                while ((p > left) && isspace(p[-1])) --p;
+                titleLen = p - left;
+
+                p = equals + 1;
+                while (*p && isspace(*p)) ++p;
+                left = p;
+                while (*p && *p != '\n') ++p;
+                if (p == left || !titleLen)
+                {
+                    /* malformed */
+                    continue;
+                }
+
+                location_add(&fresh, title, titleLen, left, p - left);
+            }
+        }
+
+        fclose(f);
+        location_sort(&fresh);
+        updateLocations(&fresh);
+    }
+    else if (f = fopen(Config.configFilePath.data, "w"))
+    {
+        static const char *defaultIniContents = "# svn_wfx configuration file. Layout:\n"
+                                                "# title = svn_url\n"
+                                                "# title may contain any character except Backslash (\\)\n"
+                                                "# Lines starting with # or malformed lines are ignored.\n"
+                                                "# Awesome Repository = svn://localhost/awesome\n"
+                                                "# Append @revision to browse a location at a fixed revision:\n"
+                                                "# Awesome 1.0 = svn://localhost/awesome/tags/1.0@1234\n\n"
+                                                "# Lines below an [options] header set plugin options:\n"
+                                                "# cache_size = 64  (number of cached directory listings)\n"
+                                                "# cache_ttl = 10   (seconds before an open directory is listed again)\n"
+                                                "# prefetch_threads = 2    (background listing threads, 0 disables prefetching)\n"
+                                                "# prefetch_children = 8   (subdirectories listed ahead per directory)\n"
+                                                "# stream_threads = 2      (threads showing listings while they arrive, 0 disables)\n"
+                                                "# disk_cache_size = 32    (MB of listings kept on disk across restarts, 0 disables)\n"
+                                                "# poll_interval = 0       (seconds between background checks for changes, 0 disables)\n"
+                                                "# session_idle_timeout = 300  (seconds an unused server connection is kept open, 0 disables reuse)\n"
+                                                "# download_threads = 4    (files of a multi-file copy downloaded at once, 0 copies one by one)\n"
+                                                "# file_store_size = 256   (MB of downloaded files kept to be copied again without downloading, 0 disables)\n"
+                                                "# index_interval = 0      (seconds between background updates of the filename index for \"quote find\", 0 disables)\n"
+                                                "# column_threads = 2      (threads computing custom column values while TC shows the panel, 0 blocks TC instead)\n"
+                                                "# trace_events = 0        (plugin calls and server round-trips kept for Trace.json, 0 disables tracing)\n"
+                                                "# trace_log = 0           (1 summarizes the trace in TC's log whenever Trace.json is copied)\n\n";
+        fprintf(f, defaultIniContents);
+        fclose(f);
+    }
+    else
+    {
+        MessageBox(NULL, "Unable to access configuration file!", NULL, MB_OK | MB_ICONERROR);
+    }
+
+    snapcache_set_capacity(Config.cacheSize);
+    revinfo_set_capacity(Config.revisionCacheSize > 0 ? (size_t) Config.revisionCacheSize : 0);
+    sessionpool_set_idle_timeout(Config.sessionIdleTimeout);
+    diskcache_configure(Config.cacheDirPath.data, (apr_off_t) Config.diskCacheSize << 20);
+    filestore_configure(Config.fileStorePath.data, (apr_off_t) Config.fileStoreSize << 20);
+    nameindex_configure(Config.indexPath.data, (apr_off_t) Config.indexCacheSize << 20);
+    trace_configure(Config.traceEvents);
+    configureWorkers();
+}
+
+/*--------------------------------------------------------------------------*/
+static void reloadChangedConfig(void)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+    if (Prefetch.subtree)
+    {
+        /* Reloading would cancel the batch's look-ahead downloads and might
+           replace the worker pools. The change notification stays signalled
+           until the batch ends. */
+        return;
+    }
+    if (Config.changes)
+    {
+        if (WaitForSingleObject(Config.changes, 0) != WAIT_OBJECT_0)
+        {
+            return;
+        }
+        FindNextChangeNotification(Config.changes);
+    }
+    /* the directory holds other files as well, TC's own configuration for one */
+    if (GetFileAttributesEx(Config.configFilePath.data, GetFileExInfoStandard, &attributes)
+        && CompareFileTime(&attributes.ftLastWriteTime, &Config.loadedTime))
+    {
+        loadConfig();
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void updateLocations(Locations *fresh)
+{
+    size_t staleCount, i;
+    Location **stale;
+
+    /* stale locations stay allocated, but the tables of the set are replaced */
+    apr_thread_mutex_lock(Columns.mutex);
+    stale = location_merge(fresh, &Config.locations, &staleCount);
+    Config.locations = *fresh;
+    apr_thread_mutex_unlock(Columns.mutex);
+    memset(fresh, 0, sizeof(*fresh));
+
+    if (staleCount)
+    {
+        stopBackgroundWork();
+        for (i = 0; i < staleCount; ++i)
+        {
+            snapcache_clear(stale[i]);
+            revinfo_clear(stale[i]);
+            diffsum_clear(stale[i]);
+        }
+        sessionpool_clear(NULL);
+        Config.retired = realloc(Config.retired, (Config.retiredCount + staleCount) * sizeof(*Config.retired));
+        memcpy(Config.retired + Config.retiredCount, stale, staleCount * sizeof(*stale));
+        Config.retiredCount += staleCount;
+    }
+    free(stale);
+}
+
+/*--------------------------------------------------------------------------*/
+static void setOption(const char *name, size_t nameLen, const char *value)
+{
+    const Option *option;
+    for (option = options; option->name.data; ++option)
+    {
+        if (option->name.len == nameLen && !strnicmp(name, option->name.data, nameLen))
+        {
+            *option->value = atoi(value);
+            return;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void getSvnNode(const Snapshot *snapshot, const SVNObject *obj, void *baton)
+{
+    WIN32_FIND_DATA *findData = baton;
+    {
+        const char *name = snapshot_name(snapshot, obj);
+        strbuf_t s = { findData->cFileName, sizeof(findData->cFileName) };
+        strbuf_cat(&s, name, strlen(name));
+    }
+
+    findData->dwFileAttributes = FILE_ATTRIBUTE_READONLY;
+
+    {
+        const LONGLONG tmpLL = (obj->time + APR_TIME_C(11644473600000000)) * 10;
+        findData->ftLastWriteTime.dwLowDateTime  = (DWORD) tmpLL;
+        findData->ftLastWriteTime.dwHighDateTime = (DWORD) (tmpLL >> 32ll);
+    }
+
+    if (obj->kind == svn_node_dir)
+    {
+        findData->dwFileAttributes |= FILE_ATTRIBUTE_DIRECTORY;
+        findData->nFileSizeLow  = 0;
+        findData->nFileSizeHigh = 0;
+    }
+    else
+    {
+        findData->nFileSizeLow  = (DWORD) obj->size;
+        findData->nFileSizeHigh = (DWORD) (obj->size >> 32ll);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void replaceAll(char *str, char oldVal, char newVal)
+{
+    while (*str)
+    {
+        if (*str == oldVal) *str = newVal;
+        ++str;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static __inline void slashify(char *str)
+{
+    replaceAll(str, '\\', '/');
+}
+
+/*--------------------------------------------------------------------------*/
+static void stopBackgroundWork(void)
+{
+    stopPoller();
+    if (Prefetch.workers)
+    {
+        workerpool_cancel(Prefetch.workers);
+        workerpool_wait(Prefetch.workers);
+    }
+    if (Streaming.workers)
+    {
+        workerpool_cancel(Streaming.workers);
+        workerpool_wait(Streaming.workers);
+    }
+    if (Download.workers)
+    {
+        workerpool_cancel(Download.workers);
+        workerpool_wait(Download.workers);
+    }
+    if (Indexer.workers)
+    {
+        workerpool_cancel(Indexer.workers);
+        workerpool_wait(Indexer.workers);
+    }
+    if (Columns.workers)
+    {
+        workerpool_cancel(Columns.workers);
+        workerpool_wait(Columns.workers);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void freeLocationsAndSnapshots(void)
+{
+    size_t i;
+
+    /* background listings refer to the locations */
+    stopBackgroundWork();
+    snapcache_clear(NULL);
+    revinfo_clear(NULL);
+    diffsum_clear(NULL);
+    apr_thread_mutex_lock(Columns.mutex);
+    location_clear(&Config.locations);
+    apr_thread_mutex_unlock(Columns.mutex);
+    for (i = 0; i < Config.retiredCount; ++i)
+    {
+        location_free(Config.retired[i]);
+    }
+    free(Config.retired);
+    Config.retired = NULL;
+    Config.retiredCount = 0;
+    nameindex_clear();
+    sessionpool_clear(NULL);
+}
+
 /*--------------------------------------------------------------------------*/
 static void displayErrorMessage(const char *msg)
 {
@@ -69,6 +69,37 @@ typedef enum
     FS_COPYFLAGS_EXISTS_DIFFERENTCASE = 16
 } FsGetFileArg;
 
+/* for FsStatusInfo */
+typedef enum
+{
+    FS_STATUS_START = 0,
+    FS_STATUS_END   = 1
+} StatusInfo;
+
+typedef enum
+{
+    FS_STATUS_OP_LIST             =  1,
+    FS_STATUS_OP_GET_SINGLE       =  2,
+    FS_STATUS_OP_GET_MULTI        =  3,
+    FS_STATUS_OP_PUT_SINGLE       =  4,
+    FS_STATUS_OP_PUT_MULTI        =  5,
+    FS_STATUS_OP_RENMOV_SINGLE    =  6,
+    FS_STATUS_OP_RENMOV_MULTI     =  7,
+    FS_STATUS_OP_DELETE           =  8,
+    FS_STATUS_OP_ATTRIB           =  9,
+    FS_STATUS_OP_MKDIR            = 10,
+    FS_STATUS_OP_EXEC             = 11,
+    FS_STATUS_OP_CALCSIZE         = 12,
+    FS_STATUS_OP_SEARCH           = 13,
+    FS_STATUS_OP_SEARCH_TEXT      = 14,
+    FS_STATUS_OP_SYNC_SEARCH      = 15,
+    FS_STATUS_OP_SYNC_GET         = 16,
+    FS_STATUS_OP_SYNC_PUT         = 17,
+    FS_STATUS_OP_SYNC_DELETE      = 18,
+    FS_STATUS_OP_GET_MULTI_THREAD = 19,
+    FS_STATUS_OP_PUT_MULTI_THREAD = 20
+} StatusOperation;
+
 /* for FsContentGetSupportedFieldFlags */
 typedef enum
 {
@@ -100,11 +131,19 @@ typedef enum
    FT_STRINGW          = 11, /* Should only be returned by Unicode function */
 
    /* for FsContentGetValue */
+   FT_DELAYED          =  0, /* field takes a long time to extract, try again in background */
    FT_NOSUCHFIELD      = -1, /* error, invalid field number given */
    FT_FILEERROR        = -2, /* file i/o error */
    FT_FIELDEMPTY       = -3  /* field valid, but empty */
 } FieldType;
 
+/* flags for FsContentGetValue */
+typedef enum
+{
+   CONTENT_DELAYIFSLOW = 1,  /* return FT_DELAYED for slow fields, TC asks again from a background thread */
+   CONTENT_PASSTHROUGH = 2
+} ContentFlags;
+
 typedef enum
 {
     SO_DESCENDING = -1,
@@ -165,6 +204,8 @@ int        __stdcall FsFindClose(HANDLE handle);
 
 int        __stdcall FsGetFile(char *remoteName, char *localName, int copyFlags, RemoteInfoStruct *ri);
 
+void       __stdcall FsStatusInfo(char *remoteDir, int infoStartEnd, int infoOperation);
+
 BOOL       __stdcall FsContentGetDefaultView(char *viewContents, char *viewHeaders, char *viewWidths,char *viewOptions, int maxLen);
 
 SortOrder  __stdcall FsContentGetDefaultSortOrder(int fieldIndex);
@@ -175,6 +216,8 @@ int        __stdcall FsContentGetSupportedFieldFlags(int fieldIndex);
 
 int        __stdcall FsContentGetValue(char *fileName, int fieldIndex, int unitIndex, void *fieldValue, int maxLen, int flags);
 
+void       __stdcall FsContentStopGetValue(char *fileName);
+
 ExecResult __stdcall FsExecuteFile(HWND mainWin, char *remoteName, char *verb);
 
 int        __stdcall FsExtractCustomIcon(char *remoteName, int extractFlags, HICON *icon);
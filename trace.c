@@ -0,0 +1,292 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trace.h"
+
+#include <apr_atomic.h>
+#include <apr_portable.h>
+#include <apr_strings.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+** Types
+*/
+
+/** A recorded span or instant event. */
+typedef struct TraceEvent
+{
+    volatile apr_uint32_t seq;  /* ticket + 1 once written, 0 while a writer fills the slot */
+    apr_uint32_t thread;
+    const char *category;
+    const char *name;
+    apr_time_t start;
+    apr_time_t duration;        /* -1 for instant events */
+    char detail[TRACE_DETAIL_SIZE];
+} TraceEvent;
+
+/** Per-name totals of trace_summarize. */
+typedef struct TraceTotal
+{
+    const char *category;
+    const char *name;
+    apr_uint32_t count;
+    apr_time_t total;
+    apr_time_t max;
+} TraceTotal;
+
+/*
+** Prototypes
+*/
+
+/** Claims the next slot of the ring buffer and fills it. */
+static void record(const char *category, const char *name, const char *detail, apr_time_t start, apr_time_t duration);
+
+/** Copies the event with @a ticket out of the ring buffer.
+    @return Non-zero if the slot still held that event and no writer touched
+            it during the copy. */
+static int readEvent(apr_uint32_t ticket, TraceEvent *event);
+
+/** Appends @a str to @a json as the contents of a JSON string. Bytes outside
+    of printable ASCII are escaped, so that paths in the ANSI code page do not
+    make the file invalid UTF-8. */
+static void appendEscaped(svn_stringbuf_t *json, const char *str);
+
+/*
+** Globals
+*/
+static struct
+{
+    volatile apr_uint32_t enabled;
+    volatile apr_uint32_t next;   /* ticket of the next event */
+    TraceEvent *events;           /* ring buffer, never freed once allocated */
+    apr_uint32_t mask;            /* ring buffer size - 1 */
+    apr_time_t origin;            /* time stamps are written relative to this */
+} Global = { 0 };
+
+/*--------------------------------------------------------------------------*/
+void trace_configure(int events)
+{
+    if (events > 0 && !Global.events)
+    {
+        apr_uint32_t size = 256;
+        while (size < (apr_uint32_t) events && size < 0x100000)
+        {
+            size <<= 1;
+        }
+        Global.events = calloc(size, sizeof(*Global.events));
+        Global.mask = size - 1;
+        Global.origin = apr_time_now();
+    }
+    apr_atomic_set32(&Global.enabled, events > 0 && Global.events);
+}
+
+/*--------------------------------------------------------------------------*/
+apr_time_t trace_begin(void)
+{
+    return Global.enabled ? apr_time_now() : 0;
+}
+
+/*--------------------------------------------------------------------------*/
+void trace_end(apr_time_t start, const char *category, const char *name, const char *detail)
+{
+    if (start)
+    {
+        record(category, name, detail, start, apr_time_now() - start);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+void trace_mark(const char *category, const char *name, const char *detail)
+{
+    if (Global.enabled)
+    {
+        record(category, name, detail, apr_time_now(), -1);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+int trace_enabled(void)
+{
+    return Global.enabled;
+}
+
+/*--------------------------------------------------------------------------*/
+void trace_dump(svn_stringbuf_t *json)
+{
+    const apr_uint32_t next = apr_atomic_read32(&Global.next);
+    const apr_uint32_t count = next < Global.mask + 1 ? next : Global.mask + 1;
+    const char *separator = "\n";
+    apr_uint32_t ticket;
+    TraceEvent event;
+
+    svn_stringbuf_appendcstr(json, "{\"traceEvents\":[");
+    for (ticket = next - count; Global.events && ticket != next; ++ticket)
+    {
+        if (!readEvent(ticket, &event))
+        {
+            continue;
+        }
+        svn_stringbuf_appendcstr(json, separator);
+        svn_stringbuf_appendcstr(json, "{\"name\":\"");
+        appendEscaped(json, event.name);
+        svn_stringbuf_appendcstr(json, "\",\"cat\":\"");
+        appendEscaped(json, event.category);
+        if (event.duration < 0)
+        {
+            svn_stringbuf_appendcstr(json, apr_psprintf(json->pool, "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%" APR_INT64_T_FMT,
+                                                        event.start - Global.origin));
+        }
+        else
+        {
+            svn_stringbuf_appendcstr(json, apr_psprintf(json->pool, "\",\"ph\":\"X\",\"ts\":%" APR_INT64_T_FMT ",\"dur\":%" APR_INT64_T_FMT,
+                                                        event.start - Global.origin, event.duration));
+        }
+        svn_stringbuf_appendcstr(json, apr_psprintf(json->pool, ",\"pid\":1,\"tid\":%u", event.thread));
+        if (*event.detail)
+        {
+            svn_stringbuf_appendcstr(json, ",\"args\":{\"detail\":\"");
+            appendEscaped(json, event.detail);
+            svn_stringbuf_appendcstr(json, "\"}");
+        }
+        svn_stringbuf_appendcstr(json, "}");
+        separator = ",\n";
+    }
+    svn_stringbuf_appendcstr(json, "\n],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+/*--------------------------------------------------------------------------*/
+void trace_summarize(trace_line_t line, void *baton)
+{
+    enum { MaxNames = 64 };
+    const apr_uint32_t next = apr_atomic_read32(&Global.next);
+    const apr_uint32_t count = next < Global.mask + 1 ? next : Global.mask + 1;
+    TraceTotal totals[MaxNames];
+    int names = 0, i;
+    apr_uint32_t ticket;
+    TraceEvent event;
+
+    for (ticket = next - count; Global.events && ticket != next; ++ticket)
+    {
+        TraceTotal *total;
+        if (!readEvent(ticket, &event))
+        {
+            continue;
+        }
+        for (i = 0; i < names && (strcmp(totals[i].name, event.name) || strcmp(totals[i].category, event.category)); ++i);
+        if (i == names)
+        {
+            if (names == MaxNames)
+            {
+                continue;
+            }
+            totals[names].category = event.category;
+            totals[names].name = event.name;
+            totals[names].count = 0;
+            totals[names].total = 0;
+            totals[names].max = -1;
+            ++names;
+        }
+        total = totals + i;
+        ++total->count;
+        if (event.duration >= 0)
+        {
+            total->total += event.duration;
+            total->max = event.duration > total->max ? event.duration : total->max;
+        }
+    }
+
+    for (i = 0; i < names; ++i)
+    {
+        char buf[256];
+        if (totals[i].max < 0)
+        {
+            apr_snprintf(buf, sizeof(buf), "trace %s %s: %u times", totals[i].category, totals[i].name, totals[i].count);
+        }
+        else
+        {
+            apr_snprintf(buf, sizeof(buf), "trace %s %s: %u calls, %" APR_INT64_T_FMT " ms total, %" APR_INT64_T_FMT " ms max",
+                         totals[i].category, totals[i].name, totals[i].count, apr_time_as_msec(totals[i].total), apr_time_as_msec(totals[i].max));
+        }
+        line(buf, baton);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void record(const char *category, const char *name, const char *detail, apr_time_t start, apr_time_t duration)
+{
+    const apr_uint32_t ticket = apr_atomic_inc32(&Global.next);
+    TraceEvent *event = Global.events + (ticket & Global.mask);
+
+    /* A writer that lags a full round behind may share the slot with this
+       one. The trace is diagnostic, so readEvent merely drops what it
+       catches in between. */
+    apr_atomic_set32(&event->seq, 0);
+    event->thread = (apr_uint32_t) (apr_size_t) apr_os_thread_current();
+    event->category = category;
+    event->name = name;
+    event->start = start;
+    event->duration = duration;
+    if (detail)
+    {
+        apr_cpystrn(event->detail, detail, sizeof(event->detail));
+    }
+    else
+    {
+        *event->detail = '\0';
+    }
+    apr_atomic_set32(&event->seq, ticket + 1);
+}
+
+/*--------------------------------------------------------------------------*/
+static int readEvent(apr_uint32_t ticket, TraceEvent *event)
+{
+    TraceEvent *slot = Global.events + (ticket & Global.mask);
+    if (apr_atomic_read32(&slot->seq) != ticket + 1)
+    {
+        return 0;
+    }
+    memcpy(event, slot, sizeof(*event));
+    event->detail[sizeof(event->detail) - 1] = '\0';
+    return event->seq == ticket + 1 && apr_atomic_read32(&slot->seq) == ticket + 1;
+}
+
+/*--------------------------------------------------------------------------*/
+static void appendEscaped(svn_stringbuf_t *json, const char *str)
+{
+    static const char Hex[] = "0123456789abcdef";
+    const unsigned char *s = (const unsigned char*) str;
+    while (*s)
+    {
+        const unsigned char *plain = s;
+        while (*s >= 0x20 && *s < 0x7F && *s != '"' && *s != '\\')
+        {
+            ++s;
+        }
+        svn_stringbuf_appendbytes(json, (const char*) plain, s - plain);
+        if (*s)
+        {
+            char escaped[6] = { '\\', 'u', '0', '0' };
+            escaped[4] = Hex[*s >> 4];
+            escaped[5] = Hex[*s & 0xF];
+            svn_stringbuf_appendbytes(json, escaped, sizeof(escaped));
+            ++s;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef SVN_WFX_TRACE_H_INCLUDED
+#define SVN_WFX_TRACE_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <svn_error.h>
+#include <svn_string.h>
+#include <apr_time.h>
+
+/** Maximum number of bytes of a span's detail kept in the trace, including the terminator. */
+#define TRACE_DETAIL_SIZE 120
+
+/** Like SVN_ERR, but records the evaluation of @a expr as a span.
+    @param category The zero-terminated category, a string literal.
+    @param name The zero-terminated span name, a string literal. */
+#define TRACE_SVN_ERR(category, name, expr)                 \
+    do                                                      \
+    {                                                       \
+        const apr_time_t trace_start__ = trace_begin();     \
+        svn_error_t *trace_err__ = (expr);                  \
+        trace_end(trace_start__, category, name, NULL);     \
+        SVN_ERR(trace_err__);                               \
+    } while (0)
+
+/** Callback for trace_summarize.
+    @param line A zero-terminated summary line without line break.
+    @param baton The baton passed to trace_summarize. */
+typedef void (*trace_line_t)(const char *line, void *baton);
+
+/** Enables or disables tracing. The ring buffer is allocated when tracing
+    is first enabled and keeps its size until the plugin is unloaded.
+    @param events The number of spans kept, rounded up to a power of two.
+                  Zero or less disables tracing. */
+extern void trace_configure(int events);
+
+/** Starts a span. All trace functions are lock-free and thread-safe; with
+    tracing disabled, they return after reading a single flag.
+    @return The start time to pass to trace_end, zero if tracing is disabled. */
+extern apr_time_t trace_begin(void);
+
+/** Records a span that began with trace_begin.
+    @param start The result of trace_begin. Nothing is recorded if it is zero.
+    @param category The zero-terminated category. Must stay valid until the plugin is unloaded.
+    @param name The zero-terminated span name. Must stay valid until the plugin is unloaded.
+    @param detail Zero-terminated details like a path, copied and truncated to
+                  TRACE_DETAIL_SIZE - 1 bytes. May be NULL. */
+extern void trace_end(apr_time_t start, const char *category, const char *name, const char *detail);
+
+/** Records an instant event like a cache decision. Parameters as for trace_end. */
+extern void trace_mark(const char *category, const char *name, const char *detail);
+
+/** @return Non-zero if tracing is enabled. */
+extern int trace_enabled(void);
+
+/** Appends the recorded spans, oldest first, to @a json in the Chrome
+    trace event format, which chrome://tracing and Perfetto open. */
+extern void trace_dump(svn_stringbuf_t *json);
+
+/** Summarizes the recorded spans by name, one line per name.
+    @param line Called for each line.
+    @param baton Passed to @a line. */
+extern void trace_summarize(trace_line_t line, void *baton);
+
+#endif /* !SVN_WFX_TRACE_H_INCLUDED */
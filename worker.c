@@ -0,0 +1,217 @@
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "worker.h"
+
+#include <apr_atomic.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+
+/*
+** Types
+*/
+struct WorkerPool
+{
+    apr_pool_t *pool;
+    apr_thread_mutex_t *mutex;
+    apr_thread_cond_t *wake;  /* signalled when jobs are queued or on shutdown */
+    apr_thread_cond_t *idle;  /* signalled when a job has finished */
+    WorkerJob *head, *tail;
+    volatile apr_uint32_t generation;
+    int busy;
+    int shutdown;
+    int threadCount;
+    apr_thread_t **threads;
+    worker_thread_init_t initThread;
+};
+
+/*
+** Prototypes
+*/
+static void * APR_THREAD_FUNC worker_main(apr_thread_t *thread, void *data);
+static WorkerJob *workerpool_detach(WorkerPool *wp);
+static void workerpool_discard(WorkerJob *job);
+
+/*--------------------------------------------------------------------------*/
+WorkerPool *workerpool_create(int threads, worker_thread_init_t initThread, apr_pool_t *pool)
+{
+    WorkerPool *wp;
+    apr_pool_t *subPool;
+    int i;
+
+    apr_pool_create(&subPool, pool);
+    wp = apr_pcalloc(subPool, sizeof(*wp));
+    wp->pool = subPool;
+    wp->initThread = initThread;
+    apr_thread_mutex_create(&wp->mutex, APR_THREAD_MUTEX_DEFAULT, subPool);
+    apr_thread_cond_create(&wp->wake, subPool);
+    apr_thread_cond_create(&wp->idle, subPool);
+
+    wp->threads = apr_pcalloc(subPool, threads * sizeof(*wp->threads));
+    for (i = 0; i < threads; ++i)
+    {
+        if (apr_thread_create(&wp->threads[wp->threadCount], NULL, &worker_main, wp, subPool) == APR_SUCCESS)
+        {
+            ++wp->threadCount;
+        }
+    }
+    return wp;
+}
+
+/*--------------------------------------------------------------------------*/
+int workerpool_size(const WorkerPool *wp)
+{
+    return wp->threadCount;
+}
+
+/*--------------------------------------------------------------------------*/
+void workerpool_submit(WorkerPool *wp, WorkerJob *job)
+{
+    apr_thread_mutex_lock(wp->mutex);
+    job->generation = wp->generation;
+    job->next = NULL;
+    if (wp->tail)
+        wp->tail->next = job;
+    else
+        wp->head = job;
+    wp->tail = job;
+    apr_thread_cond_signal(wp->wake);
+    apr_thread_mutex_unlock(wp->mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+void workerpool_cancel(WorkerPool *wp)
+{
+    WorkerJob *job;
+    apr_thread_mutex_lock(wp->mutex);
+    apr_atomic_inc32(&wp->generation);
+    job = workerpool_detach(wp);
+    apr_thread_cond_broadcast(wp->idle);
+    apr_thread_mutex_unlock(wp->mutex);
+    workerpool_discard(job);
+}
+
+/*--------------------------------------------------------------------------*/
+int workerpool_cancelled(const WorkerPool *wp, const WorkerJob *job)
+{
+    return job->generation != apr_atomic_read32((volatile apr_uint32_t*) &wp->generation);
+}
+
+/*--------------------------------------------------------------------------*/
+void workerpool_wait(WorkerPool *wp)
+{
+    apr_thread_mutex_lock(wp->mutex);
+    while (wp->head || wp->busy)
+    {
+        apr_thread_cond_wait(wp->idle, wp->mutex);
+    }
+    apr_thread_mutex_unlock(wp->mutex);
+}
+
+/*--------------------------------------------------------------------------*/
+void workerpool_destroy(WorkerPool *wp)
+{
+    if (wp)
+    {
+        int i;
+        apr_status_t status;
+        WorkerJob *job;
+
+        apr_thread_mutex_lock(wp->mutex);
+        apr_atomic_inc32(&wp->generation);
+        job = workerpool_detach(wp);
+        wp->shutdown = 1;
+        apr_thread_cond_broadcast(wp->wake);
+        apr_thread_mutex_unlock(wp->mutex);
+        workerpool_discard(job);
+
+        for (i = 0; i < wp->threadCount; ++i)
+        {
+            apr_thread_join(&status, wp->threads[i]);
+        }
+        apr_thread_cond_destroy(wp->idle);
+        apr_thread_cond_destroy(wp->wake);
+        apr_thread_mutex_destroy(wp->mutex);
+        apr_pool_destroy(wp->pool);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void * APR_THREAD_FUNC worker_main(apr_thread_t *thread, void *data)
+{
+    WorkerPool *wp = data;
+    apr_pool_t *pool;
+    void *threadData;
+
+    /* pools are not thread-safe, give each thread its own root pool */
+    apr_pool_create(&pool, NULL);
+    threadData = wp->initThread ? wp->initThread(pool) : NULL;
+
+    apr_thread_mutex_lock(wp->mutex);
+    for (;;)
+    {
+        WorkerJob *job;
+        while (!wp->head && !wp->shutdown)
+        {
+            apr_thread_cond_wait(wp->wake, wp->mutex);
+        }
+        if (wp->shutdown)
+        {
+            break;
+        }
+
+        job = wp->head;
+        wp->head = job->next;
+        if (!wp->head)
+        {
+            wp->tail = NULL;
+        }
+
+        ++wp->busy;
+        apr_thread_mutex_unlock(wp->mutex);
+        job->run(job, threadData);
+        apr_thread_mutex_lock(wp->mutex);
+        --wp->busy;
+        apr_thread_cond_broadcast(wp->idle);
+    }
+    apr_thread_mutex_unlock(wp->mutex);
+
+    apr_pool_destroy(pool);
+    apr_thread_exit(thread, APR_SUCCESS);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+static WorkerJob *workerpool_detach(WorkerPool *wp)
+{
+    WorkerJob *job = wp->head;
+    wp->head = wp->tail = NULL;
+    return job;
+}
+
+/*--------------------------------------------------------------------------*/
+static void workerpool_discard(WorkerJob *job)
+{
+    while (job)
+    {
+        WorkerJob *next = job->next;
+        job->discard(job);
+        job = next;
+    }
+}
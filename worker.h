@@ -0,0 +1,77 @@
+#ifndef SVN_WFX_WORKER_H_INCLUDED
+#define SVN_WFX_WORKER_H_INCLUDED
+
+/*
+** svn_wfx - Subversion File System Plugin for Total Commander
+** Copyright (C) 2010 Matthias von Faber
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <apr_pools.h>
+
+/** Background job. Embed this as the first member of your own job struct. */
+typedef struct WorkerJob
+{
+    /** Executes the job on a worker thread and frees it.
+        @param job The job.
+        @param threadData The value returned by the pool's thread init function. */
+    void (*run)(struct WorkerJob *job, void *threadData);
+
+    /** Frees a job that was cancelled before it started. */
+    void (*discard)(struct WorkerJob *job);
+
+    unsigned int generation;  /* set by workerpool_submit */
+    struct WorkerJob *next;
+} WorkerJob;
+
+typedef struct WorkerPool WorkerPool;
+
+/** Per-thread initializer, called once on each worker thread.
+    @param pool A pool owned by the calling thread, valid until the thread exits.
+    @return Data passed to every job run on this thread. */
+typedef void *(*worker_thread_init_t)(apr_pool_t *pool);
+
+/** Starts a pool of worker threads.
+    @param threads The number of threads.
+    @param initThread Per-thread initializer, may be NULL.
+    @param pool The pool to allocate the worker pool from.
+    @return The new worker pool. */
+extern WorkerPool *workerpool_create(int threads, worker_thread_init_t initThread, apr_pool_t *pool);
+
+/** @return The number of threads in @a wp. */
+extern int workerpool_size(const WorkerPool *wp);
+
+/** Queues @a job for execution. Jobs run in submission order.
+    @param wp The worker pool.
+    @param job The job. Ownership passes to the pool. */
+extern void workerpool_submit(WorkerPool *wp, WorkerJob *job);
+
+/** Discards all queued jobs and flags running ones as cancelled. Running
+    jobs notice this through workerpool_cancelled.
+    @param wp The worker pool. */
+extern void workerpool_cancel(WorkerPool *wp);
+
+/** @return Non-zero if @a job has been cancelled by workerpool_cancel. */
+extern int workerpool_cancelled(const WorkerPool *wp, const WorkerJob *job);
+
+/** Blocks until no jobs are queued or running.
+    @param wp The worker pool. */
+extern void workerpool_wait(WorkerPool *wp);
+
+/** Cancels all jobs, stops and joins all threads.
+    @param wp The worker pool, may be NULL. */
+extern void workerpool_destroy(WorkerPool *wp);
+
+#endif /* !SVN_WFX_WORKER_H_INCLUDED */